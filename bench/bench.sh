@@ -0,0 +1,52 @@
+#!/bin/sh
+##########################################################################
+#
+# http://cdetect.sourceforge.net/
+#
+# Permission to use, copy, modify, and distribute this software for any
+# purpose with or without fee is hereby granted, provided that the above
+# copyright notice and this permission notice appear in all copies.
+#
+# THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES OF
+# MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS AND
+# CONTRIBUTORS ACCEPT NO RESPONSIBILITY IN ANY CONCEIVABLE MANNER.
+#
+##########################################################################
+#
+# Build and run the benchmarks
+#
+#   bench.sh configure [--sizes=N,...] [--compiler=CC] [--directory=DIR]
+#   bench.sh micro [--filter=PATTERN] [--scale=N]
+#
+# The benchmark is built and run in the current directory, and all
+# remaining arguments are passed on to it.
+#
+##########################################################################
+
+# FIXME: fails if $0 does not contain /
+MYDIR="`echo $0 | sed -e 's/\(.*\)\/bench\.sh/\1/'`"
+if [ "x${MYDIR}" = "x" ]; then
+    MYDIR="."
+fi
+TOPDIR="`cd ${MYDIR}/.. && pwd`"
+
+if [ "x${CC}" = "x" ]; then
+    CC="cc"
+fi
+
+BENCHMARK=$1
+if [ "x${BENCHMARK}" = "x" ]; then
+    echo "Usage: $0 configure|micro [arguments]"
+    exit 1
+fi
+shift
+
+COMMAND="bench_${BENCHMARK}"
+
+${CC} -O2 -I${TOPDIR} ${CFLAGS} ${MYDIR}/${BENCHMARK}.c -o ${COMMAND}
+if [ $? -ne 0 ]; then
+    exit 1
+fi
+
+./${COMMAND} --include=${TOPDIR} $*
@@ -0,0 +1,463 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*************************************************************************
+ *
+ * http://cdetect.sourceforge.net/
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES OF
+ * MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS AND
+ * CONTRIBUTORS ACCEPT NO RESPONSIBILITY IN ANY CONCEIVABLE MANNER.
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ *
+ * Synthetic configure benchmark
+ *
+ * Generates configure programs with a given number of header, function,
+ * library, type, and tool checks each, and runs them against the local
+ * compiler with a cold cache, a warm cache, and with --refresh.
+ *
+ * Build and run from the top directory (POSIX only):
+ *
+ *   cc -I. -o bench_configure bench/configure.c
+ *   ./bench_configure --sizes=10,100,1000
+ *
+ * Options:
+ *
+ *   --sizes=N,...      Number of checks of each kind (default 10,100)
+ *   --compiler=CC      Compiler to use (default $CC or cc)
+ *   --directory=DIR    Work directory below the current one (default cdbench)
+ *   --include=DIR      Directory containing cdetect/cdetect.c (default .)
+ *
+ * One comma-separated line is written per run:
+ *
+ *   checks,mode,wall_ms,user_ms,system_ms,compiler_invocations,peak_rss,status
+ *
+ * The compiler is called through a counting wrapper named gcc, which is
+ * placed first in PATH, so compiler detection is part of the measurement.
+ * CPU time and peak resident set size include all child processes. The
+ * unit of peak_rss is given by getrusage() (kilobytes on most systems).
+ *
+ ************************************************************************/
+
+#include "cdetect/cdetect.c"
+
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+# include <sys/time.h>
+# include <sys/resource.h>
+#endif
+
+/*
+ * Known checks
+ *
+ * These are used first, and synthetic checks that fail are generated once
+ * they are exhausted.
+ */
+
+static const char *bench_headers[] = {
+    "stdio.h", "stdlib.h", "string.h", "stddef.h", "limits.h", "ctype.h",
+    "errno.h", "math.h", "time.h", "signal.h", "setjmp.h", "locale.h",
+    "float.h", "assert.h", "stdarg.h", "unistd.h", "fcntl.h", "sys/types.h",
+    "sys/stat.h", "sys/time.h", "sys/wait.h", "dirent.h", "pwd.h", "poll.h",
+    0
+};
+
+static const char *bench_functions[] = {
+    "printf", "malloc", "free", "memcpy", "strlen", "strchr", "qsort",
+    "fopen", "fclose", "atoi", "getenv", "time", "signal", "abort", "sprintf",
+    "strtol", "realloc", "memmove", "fflush", "setvbuf",
+    0
+};
+
+static const char *bench_libraries[][2] = {
+    {"cos", "m"}, {"sin", "m"}, {"sqrt", "m"}, {"floor", "m"},
+    {"pthread_create", "pthread"}, {"dlopen", "dl"}, {"clock_gettime", "rt"},
+    {0, 0}
+};
+
+static const char *bench_types[][2] = {
+    {"size_t", "stddef.h"}, {"ptrdiff_t", "stddef.h"}, {"wchar_t", "stddef.h"},
+    {"time_t", "time.h"}, {"clock_t", "time.h"}, {"pid_t", "sys/types.h"},
+    {"off_t", "sys/types.h"}, {"sig_atomic_t", "signal.h"}, {"FILE", "stdio.h"},
+    {"fpos_t", "stdio.h"}, {"div_t", "stdlib.h"}, {"va_list", "stdarg.h"},
+    {0, 0}
+};
+
+static const char *bench_tools[] = {
+    "sh", "ls", "cat", "sed", "awk", "grep", "make", "ar", "ranlib",
+    "install", "cp", "mv", "rm", "tar",
+    0
+};
+
+/*************************************************************************
+ *
+ * Generation
+ *
+ ************************************************************************/
+
+/*
+ * Write a configure program with count checks of each kind
+ */
+
+cdetect_bool_t
+bench_generate(const char *filename,
+               unsigned long count)
+{
+    FILE *file;
+    unsigned long i;
+    unsigned long known;
+
+    file = fopen(filename, "w");
+    if (file == 0)
+        return CDETECT_FALSE;
+
+    fprintf(file, "#include \"cdetect/cdetect.c\"\n\n");
+    fprintf(file, "int main(int argc, char *argv[])\n{\n");
+    fprintf(file, "    config_begin();\n");
+    fprintf(file, "    if (config_options(argc, argv)) {\n");
+
+    for (known = 0; bench_headers[known] != 0; ++known)
+        continue;
+    for (i = 0; i < count; ++i) {
+        if (i < known) {
+            fprintf(file, "        config_header_check(\"%s\");\n", bench_headers[i]);
+        } else {
+            fprintf(file, "        config_header_check(\"cdbench%lu.h\");\n", i);
+        }
+    }
+
+    for (known = 0; bench_functions[known] != 0; ++known)
+        continue;
+    for (i = 0; i < count; ++i) {
+        if (i < known) {
+            fprintf(file, "        config_function_check(\"%s\");\n", bench_functions[i]);
+        } else {
+            fprintf(file, "        config_function_check(\"cdbench_function%lu\");\n", i);
+        }
+    }
+
+    for (known = 0; bench_libraries[known][0] != 0; ++known)
+        continue;
+    for (i = 0; i < count; ++i) {
+        if (i < known) {
+            fprintf(file, "        config_function_check_library(\"%s\", \"%s\");\n",
+                    bench_libraries[i][0], bench_libraries[i][1]);
+        } else {
+            fprintf(file, "        config_function_check_library(\"cdbench_function%lu\", \"cdbench%lu\");\n",
+                    i, i);
+        }
+    }
+
+    for (known = 0; bench_types[known][0] != 0; ++known)
+        continue;
+    for (i = 0; i < count; ++i) {
+        if (i < known) {
+            fprintf(file, "        config_type_check_header(\"%s\", \"%s\");\n",
+                    bench_types[i][0], bench_types[i][1]);
+        } else {
+            fprintf(file, "        config_type_check_header(\"cdbench_type%lu\", \"stddef.h\");\n", i);
+        }
+    }
+
+    for (known = 0; bench_tools[known] != 0; ++known)
+        continue;
+    for (i = 0; i < count; ++i) {
+        if (i < known) {
+            fprintf(file, "        config_tool_check(\"BENCH_TOOL%lu\", \"%s\");\n", i, bench_tools[i]);
+        } else {
+            fprintf(file, "        config_tool_check(\"BENCH_TOOL%lu\", \"cdbench_tool%lu\");\n", i, i);
+        }
+    }
+
+    fprintf(file, "    }\n");
+    fprintf(file, "    config_end();\n");
+    fprintf(file, "    return 0;\n}\n");
+
+    return (cdetect_bool_t)(fclose(file) == 0);
+}
+
+/*
+ * Write a compiler wrapper that counts its invocations
+ *
+ * The original search path is restored, so the wrapper does not find
+ * itself if the compiler is called gcc.
+ */
+
+cdetect_bool_t
+bench_generate_wrapper(const char *filename,
+                       const char *compiler,
+                       const char *counter)
+{
+    FILE *file;
+
+    file = fopen(filename, "w");
+    if (file == 0)
+        return CDETECT_FALSE;
+
+    fprintf(file, "#!/bin/sh\n");
+    fprintf(file, "echo x >> '%s'\n", counter);
+    fprintf(file, "PATH='%s'\n", getenv("PATH") ? getenv("PATH") : "");
+    fprintf(file, "exec %s \"$@\"\n", compiler);
+    if (fclose(file) != 0)
+        return CDETECT_FALSE;
+
+    return (cdetect_bool_t)(chmod(filename, 0755) == 0);
+}
+
+/*************************************************************************
+ *
+ * Measurement
+ *
+ ************************************************************************/
+
+typedef struct bench_result
+{
+    unsigned long wall;
+    unsigned long user;
+    unsigned long system;
+    unsigned long peak_rss;
+    unsigned long compilations;
+    int status;
+} bench_result_t;
+
+/*
+ * Count the lines written by the compiler wrapper
+ */
+
+unsigned long
+bench_count_lines(const char *filename)
+{
+    unsigned long result = 0;
+    FILE *file;
+    int character;
+
+    file = fopen(filename, "r");
+    if (file) {
+        while ((character = fgetc(file)) != EOF) {
+            if (character == '\n')
+                ++result;
+        }
+        fclose(file);
+    }
+    return result;
+}
+
+/*
+ * Run a command in a separate process
+ *
+ * The command runs below an intermediate process, so that the resource
+ * usage of the intermediate process covers exactly this run.
+ */
+
+cdetect_bool_t
+bench_run(const char *command,
+          bench_result_t *result)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    struct rusage usage;
+    cdetect_string_t output;
+    long process;
+    int channel;
+    int status;
+    unsigned long begin;
+
+    begin = cdetect_clock();
+    process = cdetect_process_fork(&channel);
+    if (process == 0) {
+        status = system(command);
+        status = (WIFEXITED(status)) ? WEXITSTATUS(status) : -1;
+        (void)getrusage(RUSAGE_CHILDREN, &usage);
+        output = cdetect_string_format("%lu %lu %lu %d",
+                                       (unsigned long)usage.ru_utime.tv_sec * 1000UL
+                                       + (unsigned long)usage.ru_utime.tv_usec / 1000UL,
+                                       (unsigned long)usage.ru_stime.tv_sec * 1000UL
+                                       + (unsigned long)usage.ru_stime.tv_usec / 1000UL,
+                                       (unsigned long)usage.ru_maxrss,
+                                       status);
+        (void)write(channel, output->content, output->length);
+        cdetect_process_exit(channel, 0);
+    }
+    if (process > 0) {
+        output = cdetect_process_read(channel);
+        (void)cdetect_process_wait(process);
+        result->wall = (cdetect_clock() - begin) / 1000;
+        success = (cdetect_bool_t)(sscanf(output->content, "%lu %lu %lu %d",
+                                          &result->user,
+                                          &result->system,
+                                          &result->peak_rss,
+                                          &result->status) == 4);
+        cdetect_string_destroy(output);
+    }
+#else
+    (void)command;
+    (void)result;
+#endif
+    return success;
+}
+
+/*
+ * Benchmark one size in all modes
+ */
+
+cdetect_bool_t
+bench_size(const char *top,
+           const char *directory,
+           const char *include,
+           const char *compiler,
+           unsigned long count)
+{
+    static const char *modes[] = { "cold", "warm", "refresh", 0 };
+    cdetect_bool_t success;
+    cdetect_string_t work;
+    cdetect_string_t bin;
+    cdetect_string_t filename;
+    cdetect_string_t counter;
+    cdetect_string_t command;
+    bench_result_t result;
+    int mode;
+
+    work = cdetect_string_format("%s/%s/%lu", top, directory, count);
+    bin = cdetect_string_format("%^s/bin", work);
+    counter = cdetect_string_format("%^s/compilations.txt", work);
+
+    success = cdetect_directory_create(work->content) && cdetect_directory_create(bin->content);
+
+    if (success) {
+        filename = cdetect_string_format("%^s/gcc", bin);
+        success = bench_generate_wrapper(filename->content, compiler, counter->content);
+        cdetect_string_destroy(filename);
+    }
+    if (success) {
+        filename = cdetect_string_format("%^s/config.c", work);
+        success = bench_generate(filename->content, count);
+        cdetect_string_destroy(filename);
+    }
+    if (success) {
+        command = cdetect_string_format("%s -I'%s' -o '%^s/config' '%^s/config.c'",
+                                        compiler, include, work, work);
+        success = cdetect_system(command->content);
+        cdetect_string_destroy(command);
+    }
+
+    for (mode = 0; success && (modes[mode] != 0); ++mode) {
+        if (mode == 0) {
+            filename = cdetect_string_format("%^s/cachect.txt", work);
+            (void)cdetect_file_remove(filename->content);
+            cdetect_string_destroy(filename);
+        }
+        (void)cdetect_file_remove(counter->content);
+
+        command = cdetect_string_format("cd '%^s' && PATH='%^s':\"$PATH\" ./config --quiet%s",
+                                        work,
+                                        bin,
+                                        cdetect_strequal(modes[mode], "refresh") ? " --refresh" : "");
+        success = bench_run(command->content, &result);
+        cdetect_string_destroy(command);
+
+        if (success) {
+            result.compilations = bench_count_lines(counter->content);
+            printf("%lu,%s,%lu,%lu,%lu,%lu,%lu,%d\n",
+                   count * 5,
+                   modes[mode],
+                   result.wall,
+                   result.user,
+                   result.system,
+                   result.compilations,
+                   result.peak_rss,
+                   result.status);
+            (void)fflush(stdout);
+        }
+    }
+
+    cdetect_string_destroy(counter);
+    cdetect_string_destroy(bin);
+    cdetect_string_destroy(work);
+
+    return success;
+}
+
+/*************************************************************************
+ *
+ * main
+ *
+ ************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    cdetect_bool_t success = CDETECT_TRUE;
+    cdetect_string_t sizes;
+    cdetect_string_t rest;
+    cdetect_string_t compiler;
+    cdetect_string_t directory;
+    cdetect_string_t include;
+    cdetect_string_t top;
+    const char *environment;
+    char buffer[4096];
+    unsigned long count;
+    int i;
+
+    environment = getenv("CC");
+    compiler = cdetect_string_format("%s", environment ? environment : "cc");
+    sizes = cdetect_string_format("10,100");
+    directory = cdetect_string_format("cdbench");
+    include = cdetect_string_format(".");
+
+    for (i = 1; i < argc; ++i) {
+        if (cdetect_strequal_max(argv[i], 8, "--sizes=")) {
+            cdetect_string_destroy(sizes);
+            sizes = cdetect_string_format("%s", &argv[i][8]);
+        } else if (cdetect_strequal_max(argv[i], 11, "--compiler=")) {
+            cdetect_string_destroy(compiler);
+            compiler = cdetect_string_format("%s", &argv[i][11]);
+        } else if (cdetect_strequal_max(argv[i], 12, "--directory=")) {
+            cdetect_string_destroy(directory);
+            directory = cdetect_string_format("%s", &argv[i][12]);
+        } else if (cdetect_strequal_max(argv[i], 10, "--include=")) {
+            cdetect_string_destroy(include);
+            include = cdetect_string_format("%s", &argv[i][10]);
+        } else {
+            fprintf(stderr, "Usage: %s [--sizes=N,...] [--compiler=CC] [--directory=DIR] [--include=DIR]\n", argv[0]);
+            return 1;
+        }
+    }
+
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    top = cdetect_string_format("%s", getcwd(buffer, sizeof(buffer)) ? buffer : ".");
+#else
+    (void)buffer;
+    top = cdetect_string_format(".");
+#endif
+    rest = cdetect_string_format("%s/%^s", top->content, directory);
+    success = cdetect_directory_create(rest->content);
+    cdetect_string_destroy(rest);
+
+    printf("checks,mode,wall_ms,user_ms,system_ms,compiler_invocations,peak_rss,status\n");
+
+    while (success && sizes) {
+        rest = cdetect_string_split(sizes, ',');
+        count = strtoul(sizes->content, 0, 10);
+        if (count > 0) {
+            success = bench_size(top->content,
+                                 directory->content,
+                                 include->content,
+                                 compiler->content,
+                                 count);
+        }
+        cdetect_string_destroy(sizes);
+        sizes = rest;
+    }
+
+    cdetect_string_destroy(sizes);
+    cdetect_string_destroy(top);
+    cdetect_string_destroy(include);
+    cdetect_string_destroy(directory);
+    cdetect_string_destroy(compiler);
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,478 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*************************************************************************
+ *
+ * http://cdetect.sourceforge.net/
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES OF
+ * MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS AND
+ * CONTRIBUTORS ACCEPT NO RESPONSIBILITY IN ANY CONCEIVABLE MANNER.
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ *
+ * Micro-benchmarks
+ *
+ * Measures the containers and string routines that the checks are built
+ * on: maps, formatting and scanning of strings, variable substitution,
+ * wildcard matching, and regular expressions. All inputs are generated
+ * deterministically, so runs are comparable.
+ *
+ * Build and run from the top directory:
+ *
+ *   cc -O2 -I. -o bench_micro bench/micro.c
+ *   ./bench_micro --filter=map_*
+ *
+ * Options:
+ *
+ *   --filter=PATTERN   Only run benchmarks whose name matches the wildcard
+ *   --scale=N          Multiply the number of iterations by N (default 1)
+ *
+ * One comma-separated line is written per benchmark:
+ *
+ *   name,iterations,ns_per_op,allocations_per_op
+ *
+ * Allocations are counted by routing malloc() and realloc() through
+ * counting functions before cdetect.c is included.
+ *
+ ************************************************************************/
+
+#include <stdlib.h>
+
+unsigned long bench_allocations = 0;
+
+void *
+bench_malloc(size_t size)
+{
+    ++bench_allocations;
+    return malloc(size);
+}
+
+void *
+bench_realloc(void *memory,
+              size_t size)
+{
+    ++bench_allocations;
+    return realloc(memory, size);
+}
+
+#define malloc(size) bench_malloc(size)
+#define realloc(memory, size) bench_realloc(memory, size)
+
+#include "cdetect/cdetect.c"
+
+#define BENCH_MAP_KEYS 100000UL
+#define BENCH_TEMPLATE_SIZE (10UL * 1024UL * 1024UL)
+#define BENCH_TEMPLATE_VARIABLES 1000UL
+
+/*************************************************************************
+ *
+ * Measurement
+ *
+ ************************************************************************/
+
+const char *bench_filter = "*";
+unsigned long bench_scale = 1;
+unsigned long bench_seed = 1;
+
+typedef struct bench_measure
+{
+    const char *name;
+    unsigned long begin;
+    unsigned long allocations;
+} bench_measure_t;
+
+/*
+ * Check if a benchmark is selected by --filter
+ */
+
+cdetect_bool_t
+bench_selected(const char *name)
+{
+    return (cdetect_bool_t)config_match(name, bench_filter);
+}
+
+/*
+ * Start measuring
+ */
+
+void
+bench_begin(bench_measure_t *measure,
+            const char *name)
+{
+    measure->name = name;
+    measure->allocations = bench_allocations;
+    measure->begin = cdetect_clock();
+}
+
+/*
+ * Stop measuring and output the result
+ */
+
+void
+bench_end(bench_measure_t *measure,
+          unsigned long iterations)
+{
+    unsigned long elapsed;
+    unsigned long allocations;
+
+    elapsed = cdetect_clock() - measure->begin;
+    allocations = bench_allocations - measure->allocations;
+    if (iterations == 0)
+        iterations = 1;
+
+    printf("%s,%lu,%.1f,%.2f\n",
+           measure->name,
+           iterations,
+           ((double)elapsed * 1000.0) / (double)iterations,
+           (double)allocations / (double)iterations);
+    (void)fflush(stdout);
+}
+
+/*
+ * Deterministic pseudo-random numbers (linear congruential generator)
+ */
+
+unsigned long
+bench_random(void)
+{
+    bench_seed = (bench_seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+    return bench_seed;
+}
+
+/*************************************************************************
+ *
+ * Benchmarks
+ *
+ ************************************************************************/
+
+/*
+ * Insert and look up keys in a map
+ */
+
+void
+bench_map(void)
+{
+    bench_measure_t measure;
+    cdetect_string_t *keys;
+    cdetect_string_t *misses;
+    cdetect_map_t map;
+    unsigned long count = BENCH_MAP_KEYS;
+    unsigned long found = 0;
+    unsigned long i;
+
+    if (!(bench_selected("map_remember") ||
+          bench_selected("map_lookup_hit") ||
+          bench_selected("map_lookup_miss")))
+        return;
+
+    keys = (cdetect_string_t *)cdetect_allocate(count * sizeof(keys[0]));
+    misses = (cdetect_string_t *)cdetect_allocate(count * sizeof(misses[0]));
+    for (i = 0; i < count; ++i) {
+        keys[i] = cdetect_string_format("CDETECT_HEADER_KEY%lu_H", i);
+        misses[i] = cdetect_string_format("CDETECT_HEADER_MISS%lu_H", i);
+    }
+
+    map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                             (cdetect_map_destroy_t)cdetect_free);
+
+    bench_begin(&measure, "map_remember");
+    for (i = 0; i < count; ++i) {
+        (void)cdetect_map_remember(map, keys[i]->content, "1");
+    }
+    if (bench_selected(measure.name))
+        bench_end(&measure, count);
+
+    if (bench_selected("map_lookup_hit")) {
+        bench_seed = 1;
+        bench_begin(&measure, "map_lookup_hit");
+        for (i = 0; i < count * bench_scale; ++i) {
+            if (cdetect_map_lookup(map, keys[bench_random() % count]->content))
+                ++found;
+        }
+        bench_end(&measure, count * bench_scale);
+    }
+
+    if (bench_selected("map_lookup_miss")) {
+        bench_begin(&measure, "map_lookup_miss");
+        for (i = 0; i < count * bench_scale; ++i) {
+            if (cdetect_map_lookup(map, misses[i % count]->content))
+                ++found;
+        }
+        bench_end(&measure, count * bench_scale);
+    }
+
+    cdetect_map_destroy(map);
+    for (i = 0; i < count; ++i) {
+        cdetect_string_destroy(keys[i]);
+        cdetect_string_destroy(misses[i]);
+    }
+    cdetect_free(misses);
+    cdetect_free(keys);
+
+    /* Keep the lookups from being optimized away */
+    if (found == 0)
+        fprintf(stderr, "map_lookup: no keys found\n");
+}
+
+/*
+ * Format strings with the most common conversions
+ */
+
+void
+bench_vformat(void)
+{
+    bench_measure_t measure;
+    cdetect_string_t result;
+    unsigned long count = 100000UL * bench_scale;
+    unsigned long i;
+
+    if (!bench_selected("string_vformat"))
+        return;
+
+    bench_begin(&measure, "string_vformat");
+    for (i = 0; i < count; ++i) {
+        result = cdetect_string_format("%s %'s %d %u %x %-*s|",
+                                       "CDETECT_FUNC_SNPRINTF",
+                                       "stdio.h",
+                                       -(int)(i & 0xFFFF),
+                                       (unsigned int)i,
+                                       (unsigned int)i,
+                                       24, "column");
+        cdetect_string_destroy(result);
+    }
+    bench_end(&measure, count);
+}
+
+/*
+ * Scan strings with the chost line format
+ */
+
+void
+bench_scan(void)
+{
+    bench_measure_t measure;
+    cdetect_string_t line;
+    cdetect_string_t first;
+    cdetect_string_t second;
+    cdetect_string_t third;
+    unsigned int numbers[3];
+    unsigned long count = 100000UL * bench_scale;
+    unsigned long i;
+
+    if (!bench_selected("string_scan"))
+        return;
+
+    line = cdetect_string_format("x86_64-unknown-linux-gnu:1F linux:2A gcc:3C");
+
+    bench_begin(&measure, "string_scan");
+    for (i = 0; i < count; ++i) {
+        first = second = third = 0;
+        (void)cdetect_string_scan(line, "%^[^:]:%x %^[^:]:%x %^[^:]:%x",
+                                  &first, &numbers[0],
+                                  &second, &numbers[1],
+                                  &third, &numbers[2]);
+        cdetect_string_destroy(first);
+        cdetect_string_destroy(second);
+        cdetect_string_destroy(third);
+    }
+    bench_end(&measure, count);
+
+    cdetect_string_destroy(line);
+}
+
+/*
+ * Substitute a large template with dense @VARIABLE@ references
+ *
+ * The template mixes known variables, unknown variables (copied as is),
+ * and variables with default values.
+ */
+
+void
+bench_substitute(void)
+{
+    bench_measure_t measure;
+    cdetect_string_t source;
+    cdetect_string_t target;
+    cdetect_string_t line;
+    cdetect_string_t name;
+    unsigned long count = 5UL * bench_scale;
+    unsigned long i;
+
+    if (!bench_selected("substitute_string"))
+        return;
+
+    for (i = 0; i < BENCH_TEMPLATE_VARIABLES; ++i) {
+        name = cdetect_string_format("VAR%lu", i);
+        (void)cdetect_map_remember(cdetect_tool_map, name->content, "value");
+        cdetect_string_destroy(name);
+    }
+
+    bench_seed = 1;
+    source = cdetect_string_create();
+    (void)cdetect_string_reserve(source, BENCH_TEMPLATE_SIZE);
+    while (source->length < BENCH_TEMPLATE_SIZE) {
+        line = cdetect_string_format("x = @VAR%lu@ @UNKNOWN%lu@ @VAR%lu=default@;\n",
+                                     bench_random() % BENCH_TEMPLATE_VARIABLES,
+                                     bench_random() % BENCH_TEMPLATE_VARIABLES,
+                                     bench_random() % (2 * BENCH_TEMPLATE_VARIABLES));
+        (void)cdetect_string_append(source, line->content);
+        cdetect_string_destroy(line);
+    }
+
+    bench_begin(&measure, "substitute_string");
+    for (i = 0; i < count; ++i) {
+        target = 0;
+        (void)cdetect_substitute_string(source, &target);
+        cdetect_string_destroy(target);
+    }
+    bench_end(&measure, count);
+
+    cdetect_string_destroy(source);
+}
+
+/*
+ * Match wildcards with many stars against strings that almost match
+ */
+
+void
+bench_match(void)
+{
+    static const char *patterns[] = {
+        "*a*a*a*a*a*a*a*a*b",
+        "*?*?*?*?*?*?*?*?*b",
+        "a*aa*aaa*aaaa*aaaaa*b",
+        0
+    };
+    bench_measure_t measure;
+    config_pattern_t pattern;
+    cdetect_string_t subject;
+    unsigned long count = 10000UL * bench_scale;
+    unsigned long matches = 0;
+    unsigned long i;
+    int patterns_count;
+    int j;
+
+    if (!(bench_selected("strmatch") || bench_selected("pattern_match")))
+        return;
+
+    for (patterns_count = 0; patterns[patterns_count] != 0; ++patterns_count)
+        continue;
+
+    subject = cdetect_string_create();
+    for (i = 0; i < 1000; ++i) {
+        (void)cdetect_string_append(subject, "a");
+    }
+
+    if (bench_selected("strmatch")) {
+        bench_begin(&measure, "strmatch");
+        for (i = 0; i < count; ++i) {
+            for (j = 0; patterns[j] != 0; ++j) {
+                matches += (unsigned long)cdetect_strmatch(subject->content, patterns[j]);
+            }
+        }
+        bench_end(&measure, count * patterns_count);
+    }
+
+    if (bench_selected("pattern_match")) {
+        bench_begin(&measure, "pattern_match");
+        for (j = 0; patterns[j] != 0; ++j) {
+            pattern = config_pattern_compile(patterns[j]);
+            for (i = 0; i < count; ++i) {
+                matches += (unsigned long)config_pattern_match(pattern, subject->content);
+            }
+            config_pattern_destroy(pattern);
+        }
+        bench_end(&measure, count * patterns_count);
+    }
+
+    cdetect_string_destroy(subject);
+
+    if (matches != 0)
+        fprintf(stderr, "strmatch: unexpected match\n");
+}
+
+/*
+ * Compile and match regular expressions
+ */
+
+void
+bench_regexp(void)
+{
+    bench_measure_t measure;
+    cdetect_regexp_t regexp;
+    cdetect_string_t subject;
+    unsigned long count;
+    unsigned long i;
+
+    if (bench_selected("regexp_compile")) {
+        count = 10000UL * bench_scale;
+        bench_begin(&measure, "regexp_compile");
+        for (i = 0; i < count; ++i) {
+            regexp = cdetect_regexp_compile("(a|b)*c+(d|e)?f.g\\d\\w");
+            cdetect_regexp_destroy(regexp);
+        }
+        bench_end(&measure, count);
+    }
+
+    if (bench_selected("regexp_match")) {
+        count = 1000UL * bench_scale;
+        subject = cdetect_string_create();
+        for (i = 0; i < 1000; ++i) {
+            (void)cdetect_string_append(subject, "a");
+        }
+        regexp = cdetect_regexp_compile("(a|aa)*(a|aa)*b");
+        bench_begin(&measure, "regexp_match");
+        for (i = 0; i < count; ++i) {
+            (void)cdetect_regexp_match(regexp, subject->content);
+        }
+        bench_end(&measure, count);
+        cdetect_regexp_destroy(regexp);
+        cdetect_string_destroy(subject);
+    }
+}
+
+/*************************************************************************
+ *
+ * main
+ *
+ ************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; ++i) {
+        if (cdetect_strequal_max(argv[i], 9, "--filter=")) {
+            bench_filter = &argv[i][9];
+        } else if (cdetect_strequal_max(argv[i], 8, "--scale=")) {
+            bench_scale = strtoul(&argv[i][8], 0, 10);
+            if (bench_scale == 0)
+                bench_scale = 1;
+        } else if (cdetect_strequal_max(argv[i], 10, "--include=")) {
+            /* Passed by bench.sh, but not needed here */
+        } else {
+            fprintf(stderr, "Usage: %s [--filter=PATTERN] [--scale=N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    cdetect_global_create();
+
+    printf("name,iterations,ns_per_op,allocations_per_op\n");
+    bench_map();
+    bench_vformat();
+    bench_scan();
+    bench_substitute();
+    bench_match();
+    bench_regexp();
+
+    cdetect_global_destroy();
+
+    return 0;
+}
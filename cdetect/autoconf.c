@@ -311,8 +311,7 @@ void ac_header_time(void)
 
 void ac_header_stdbool(void)
 {
-    config_type_check_header("_Bool", "stdbool.h")
-        || config_type_check("_Bool");
+    config_type_check_first_of("_Bool", "stdbool.h,");
 }
 
 /*
@@ -330,10 +329,7 @@ void ac_header_resolv(void)
 
 void ac_header_dirent(void)
 {
-    config_header_check("dirent.h") ||
-        config_header_check("sys/ndir.h") ||
-        config_header_check("sys/dir.h") ||
-        config_header_check("ndir.h");
+    config_header_check_first_of("dirent.h,sys/ndir.h,sys/dir.h,ndir.h");
 }
 
 void ac_header_stat(void)
@@ -379,13 +375,7 @@ void ac_header_sys_wait(void)
 
 void ac_type_pid_t(void)
 {
-    if ( !(config_type_check_header("pid_t", "stddef.h")
-           || config_type_check_header("pid_t", "sys/types.h")
-           || config_type_check_header("pid_t", "unistd.h")
-           || config_type_check_header("pid_t", "sys/wait.h")
-           || config_type_check_header("pid_t", "fcntl.h")
-           || config_type_check_header("pid_t", "signal.h")
-           || config_type_check("pid_t")) ) {
+    if (!config_type_check_first_of("pid_t", "stddef.h,sys/types.h,unistd.h,sys/wait.h,fcntl.h,signal.h,")) {
         config_macro_define("pid_t", "int");
     }
 }
@@ -396,9 +386,7 @@ void ac_type_pid_t(void)
 
 void ac_type_uid_t(void)
 {
-    config_type_check_header("uid_t", "sys/types.h")
-        || config_type_check_header("uid_t", "unistd.h")
-        || config_type_check("uid_t");
+    config_type_check_first_of("uid_t", "sys/types.h,unistd.h,");
 }
 
 /*
@@ -407,9 +395,7 @@ void ac_type_uid_t(void)
 
 void ac_type_off_t(void)
 {
-    if ( !(config_type_check_header("off_t", "sys/types.h")
-           || config_type_check_header("off_t", "unistd.h")
-           || config_type_check("off_t")) ) {
+    if (!config_type_check_first_of("off_t", "sys/types.h,unistd.h,")) {
         config_macro_define("off_t", "long");
     }
 }
@@ -420,10 +406,7 @@ void ac_type_off_t(void)
 
 void ac_type_size_t(void)
 {
-    if ( !(config_type_check_header("size_t", "stddef.h")
-           || config_type_check_header("size_t", "sys/types.h")
-           || config_type_check_header("size_t", "unistd.h")
-           || config_type_check("size_t")) ) {
+    if (!config_type_check_first_of("size_t", "stddef.h,sys/types.h,unistd.h,")) {
         config_macro_define("size_t", "unsigned");
     }
 }
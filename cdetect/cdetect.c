@@ -19,9 +19,7 @@
 #ifndef CDETECT_C_INCLUDE_GUARD
 #define CDETECT_C_INCLUDE_GUARD
 
-#define CDETECT_VERSION_MAJOR 0
-#define CDETECT_VERSION_MINOR 2
-#define CDETECT_VERSION_PATCH 2
+#include "cdetect.h"
 
 /*
   TODO:
@@ -71,6 +69,10 @@ features.
 
 cdetect.c reserves all names starting with config_ and CONFIG_ for public
 use, and all names starting with cdetect_ and CDETECT_ for internal use.
+
+If CDETECT_USE_LIBRARY is defined, only the declarations of cdetect.h are
+included, and the configure program must be linked with an object file
+of cdetect.c compiled without CDETECT_USE_LIBRARY.
 */
 
 /*************************************************************************
@@ -79,10 +81,6 @@ use, and all names starting with cdetect_ and CDETECT_ for internal use.
  *
  ************************************************************************/
 
-#define CDETECT_MKVER(v,r,p) (((v) << 24) + ((r) << 16) + (p))
-
-#define CDETECT_VERSION CDETECT_MKVER(CDETECT_VERSION_MAJOR, CDETECT_VERSION_MINOR, CDETECT_VERSION_PATCH)
-
 /*
  * Pre-defined macros.
  *
@@ -93,6 +91,15 @@ use, and all names starting with cdetect_ and CDETECT_ for internal use.
 # define CDETECT_COMPILER_MSC CDETECT_MKVER(_MSC_VER / 100, _MSC_VER % 100, 0)
 #endif
 
+/* Each thread has its own copy of variables with this storage class */
+#if defined(CDETECT_COMPILER_MSC)
+# define CDETECT_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) && ((__GNUC__ > 3) || ((__GNUC__ == 3) && (__GNUC_MINOR__ >= 3)))
+# define CDETECT_THREAD_LOCAL __thread
+#else
+# define CDETECT_THREAD_LOCAL
+#endif
+
 #if defined(WIN32) || defined(_WIN32) || defined(__WIN32__)
 # define CDETECT_OS_WIN32
 # define CDETECT_HEADER_WINDOWS_H
@@ -111,12 +118,25 @@ use, and all names starting with cdetect_ and CDETECT_ for internal use.
 #endif
 
 #if defined(CDETECT_HEADER_UNISTD_H)
+# if defined(__STRICT_ANSI__) && !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE)
+/* Strict ANSI mode hides POSIX declarations, such as kill */
+#  define _XOPEN_SOURCE 500
+# endif
 # include <unistd.h>
 # if defined(_XOPEN_XPG3) || (defined(_XOPEN_VERSION) && (_XOPEN_VERSION >= 3))
 #  define CDETECT_HEADER_SYS_WAIT_H
+#  define CDETECT_HEADER_SYS_RESOURCE_H
 # endif
 #endif
 
+#if defined(CDETECT_HEADER_UNISTD_H) || defined(CDETECT_OS_WIN32)
+# define CDETECT_HEADER_SYS_STAT_H
+#endif
+
+#if defined(CDETECT_HEADER_UNISTD_H)
+# define CDETECT_HEADER_DIRENT_H
+#endif
+
 /*************************************************************************
  *
  * Include files
@@ -135,15 +155,30 @@ use, and all names starting with cdetect_ and CDETECT_ for internal use.
 #include <stdarg.h>
 #include <string.h>
 #include <ctype.h>
+#include <limits.h>
 #include <assert.h>
+#include <time.h>
 #if defined(CDETECT_HEADER_SYS_WAIT_H)
 # include <sys/types.h>
 # include <sys/wait.h>
+# include <signal.h>
+#endif
+#if defined(CDETECT_HEADER_SYS_RESOURCE_H)
+# include <sys/resource.h>
+#endif
+#if defined(CDETECT_HEADER_SYS_STAT_H)
+# include <sys/types.h>
+# include <sys/stat.h>
+#endif
+#if defined(CDETECT_HEADER_DIRENT_H)
+# include <dirent.h>
 #endif
 #if defined(CDETECT_HEADER_WINDOWS_H)
 # include <windows.h>
 #endif
 
+#if !defined(CDETECT_USE_LIBRARY)
+
 /*
  * Default values of macros
  *
@@ -160,34 +195,26 @@ use, and all names starting with cdetect_ and CDETECT_ for internal use.
 #define CDETECT_CHOST_FILE "cdetect/chost.c"
 #endif
 
+/*
+ * CDETECT_ENGINE_OBJECT can be defined as the name of an object file of
+ * cdetect.c, which chost.c is then linked with instead of including all
+ * of cdetect.c. configure.sh defines it when it builds the object file.
+ */
+
 /*************************************************************************
  *
  * Types
  *
  ************************************************************************/
 
-typedef enum {
-    CDETECT_FALSE = 0,
-    CDETECT_TRUE = 1
-} cdetect_bool_t;
-
 typedef enum {
     CDETECT_REPORT_NULL = 0,
     CDETECT_REPORT_FOUND = 1 << 0,
-    CDETECT_REPORT_CACHED = 1 << 1
+    CDETECT_REPORT_CACHED = 1 << 1,
+    CDETECT_REPORT_TIMEOUT = 1 << 2,
+    CDETECT_REPORT_LIMIT = 1 << 3
 } cdetect_report_t;
 
-/*
- * Dynamic string
- */
-
-typedef struct cdetect_string
-{
-    char *content;
-    size_t length;
-    size_t allocated;
-} * cdetect_string_t;
-
 typedef struct cdetect_file
 {
     cdetect_string_t path;
@@ -242,9 +269,36 @@ typedef struct cdetect_map {
     cdetect_map_destroy_t destroyer;
     /* Member variables */
     cdetect_list_t first;
-    struct cdetect_map_element *chain[CDETECT_MAP_SIZE];
+    cdetect_list_t last;
+    struct cdetect_map_element **chain;
+    unsigned int size;
+    unsigned int count;
 } * cdetect_map_t;
 
+/*
+ * Wildcard pattern
+ *
+ * A pattern is split at every '*' into segments. Each segment holds one bit
+ * mask per input character (and per word of the segment length) which is
+ * used for bit-parallel (Shift-And) matching.
+ */
+
+#define CDETECT_GLOB_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+typedef struct cdetect_glob_segment
+{
+    size_t length;
+    size_t words;
+    unsigned long *masks; /* (UCHAR_MAX + 1) * words */
+} * cdetect_glob_segment_t;
+
+typedef struct cdetect_glob
+{
+    struct cdetect_glob_segment *segment;
+    int count;
+    cdetect_bool_t has_wildcard; /* Pattern contains at least one '*' */
+} * cdetect_glob_t;
+
 /*
  * Options
  */
@@ -266,11 +320,67 @@ typedef struct cdetect_option
  */
 
 typedef cdetect_bool_t (*cdetect_tool_check_filter_t)(const char *, void *);
-typedef int (*config_tool_check_filter_t)(const char *, void *);
 
 typedef cdetect_bool_t (*cdetect_macro_filter_t)(const char *, const char *);
 typedef cdetect_string_t (*cdetect_macro_transform_t)(cdetect_string_t);
 
+/*
+ * Speculative probes
+ */
+
+typedef cdetect_report_t (*cdetect_probe_check_t)(const char *, const char *);
+
+/*
+ * Queued execution
+ */
+
+typedef struct cdetect_execute_entry
+{
+    cdetect_string_t execute_file;
+    cdetect_string_t arguments;
+    config_execute_callback_t callback;
+    void *closure;
+} * cdetect_execute_entry_t;
+
+/* Result of a program that was executed together with the queue */
+typedef struct cdetect_execute_capture
+{
+    cdetect_bool_t success;
+    cdetect_string_t output;
+} * cdetect_execute_capture_t;
+
+/*
+ * Trace slice
+ *
+ * Time stamps are in microseconds since the start of the run.
+ */
+
+typedef struct cdetect_trace_slice
+{
+    const char *category;
+    cdetect_string_t name;
+    unsigned long begin;
+} * cdetect_trace_slice_t;
+
+/*
+ * Profile entries
+ */
+
+#define CDETECT_PROFILE_TOP 5
+
+typedef struct cdetect_profile_total
+{
+    unsigned long count;
+    unsigned long duration;
+} * cdetect_profile_total_t;
+
+typedef struct cdetect_profile_check
+{
+    cdetect_string_t name;
+    cdetect_string_t source;
+    unsigned long duration;
+} * cdetect_profile_check_t;
+
 /*************************************************************************
  *
  * Data
@@ -283,43 +393,101 @@ typedef cdetect_string_t (*cdetect_macro_transform_t)(cdetect_string_t);
 
 /* Compiler name */
 
-/* Arguments:
+/* Compilation arguments:
    1 = compiler
    2 = global cflags
    3 = local cflags
    4 = source
    5 = target
    6 = ldflags
+
+   Predefined macro dump arguments:
+   1 = compiler
+   2 = global cflags
+   3 = source
+
+   Included files flag: lists the path of every included file in the
+   compiler output.
 */
 
-static const char *cdetect_compilers_c[][2] = {
-    {"cl", "\"%s\" /nologo %s %s %s /Fe%s %s"}, /* Microsoft Visual Studio */
-    {"gcc", "%s %s %s %s -o %s %s"}, /* GNU C */
-    {"icc", "%s %s %s %s -o %s %s"}, /* Intel C */
-    {"xlC_r", "%s %s %s %s -o %s %s"}, /* IBM XL C */
-    {"xlC", "%s %s %s %s -o %s %s"}, /* IBM XL C */
-    {"cc", "%s %s %s %s -o %s %s"},
-    {"c89", "%s %s %s %s -o %s %s"},
-    {0, 0}
+#define CDETECT_COMPILER_NAME 0
+#define CDETECT_COMPILER_ARGUMENTS 1
+#define CDETECT_COMPILER_PREDEFINED 2
+#define CDETECT_COMPILER_INCLUDES 3
+#define CDETECT_COMPILER_COLUMNS 4
+
+static const char *cdetect_compilers_c[][CDETECT_COMPILER_COLUMNS] = {
+    {"cl", "\"%s\" /nologo %s %s %s /Fe%s %s", 0, "/showIncludes"}, /* Microsoft Visual Studio */
+    {"gcc", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", "-H"}, /* GNU C */
+    {"icc", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", "-H"}, /* Intel C */
+    {"xlC_r", "%s %s %s %s -o %s %s", "%s %s -qshowmacros -E %s", 0}, /* IBM XL C */
+    {"xlC", "%s %s %s %s -o %s %s", "%s %s -qshowmacros -E %s", 0}, /* IBM XL C */
+    {"cc", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", 0},
+    {"c89", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", 0},
+    {0, 0, 0, 0}
+};
+
+static const char *cdetect_compilers_cxx[][CDETECT_COMPILER_COLUMNS] = {
+    {"cl", "\"%s\" /nologo %s %s %s /Fe%s %s", 0, "/showIncludes"}, /* Microsoft Visual Studio */
+    {"g++", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", "-H"}, /* GNU C++ */
+    {"c++", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", "-H"}, /* GNU C++ */
+    {"icc", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", "-H"}, /* Intel C++ */
+    {"aCC", "%s %s %s %s -o %s %s", 0, 0}, /* HP aCC */
+    {"xlC_r", "%s %s %s %s -o %s %s", "%s %s -qshowmacros -E %s", 0}, /* IBM XL C++ */
+    {"xlC", "%s %s %s %s -o %s %s", "%s %s -qshowmacros -E %s", 0}, /* IBM XL C++ */
+    {"CC", "%s %s %s %s -o %s %s", "%s %s -dM -E %s", 0},
+    {0, 0, 0, 0}
 };
 
-static const char *cdetect_compilers_cxx[][2] = {
-    {"cl", "\"%s\" /nologo %s %s %s /Fe%s %s"}, /* Microsoft Visual Studio */
-    {"g++", "%s %s %s %s -o %s %s"}, /* GNU C++ */
-    {"c++", "%s %s %s %s -o %s %s"}, /* GNU C++ */
-    {"icc", "%s %s %s %s -o %s %s"}, /* Intel C++ */
-    {"aCC", "%s %s %s %s -o %s %s"}, /* HP aCC */
-    {"xlC_r", "%s %s %s %s -o %s %s"}, /* IBM XL C++ */
-    {"xlC", "%s %s %s %s -o %s %s"}, /* IBM XL C++ */
-    {"CC", "%s %s %s %s -o %s %s"},
-    {0, 0}
+static const char *cdetect_compilers_cpp[][CDETECT_COMPILER_COLUMNS] = { /* FIXME: arguments */
+    {"cl", "/E", 0, 0},
+    {"cpp", "", "%s %s -dM %s", 0},
+    {"cc", "-E", "%s %s -dM -E %s", 0},
+    {0, 0, 0, 0}
 };
 
-static const char *cdetect_compilers_cpp[][2] = { /* FIXME: arguments */
-    {"cl", "/E"},
-    {"cpp", ""},
-    {"cc", "-E"},
-    {0, 0}
+/* Used for compilers that are not found in the above tables */
+const char *cdetect_format_predefined_default = "%s %s -dM -E %s";
+
+/* CPU features:
+   Name of feature (used in macros and tool variables)
+   Feature that must be available before this one is probed
+   Header of the intrinsics
+   Comma-separated flags that are tried if the compiler does not target
+   the feature by default
+   Body of main(), which uses the intrinsics on the volatile int input
+   and returns zero if the result is correct
+*/
+
+#define CDETECT_CPU_FEATURE_NAME 0
+#define CDETECT_CPU_FEATURE_REQUIRES 1
+#define CDETECT_CPU_FEATURE_HEADER 2
+#define CDETECT_CPU_FEATURE_FLAGS 3
+#define CDETECT_CPU_FEATURE_BODY 4
+#define CDETECT_CPU_FEATURE_COLUMNS 5
+
+static const char *cdetect_cpu_features[][CDETECT_CPU_FEATURE_COLUMNS] = {
+    {"SSE2", 0, "emmintrin.h", "-msse2,/arch:SSE2",
+     "__m128i v = _mm_set1_epi32(input); v = _mm_add_epi32(v, v); return _mm_cvtsi128_si32(v) != 2;"},
+    {"SSE4_2", "SSE2", "nmmintrin.h", "-msse4.2",
+     "return _mm_crc32_u32(0, (unsigned int)input) == 0;"},
+    {"AVX", "SSE4_2", "immintrin.h", "-mavx,/arch:AVX",
+     "__m256d v = _mm256_set1_pd((double)input); v = _mm256_add_pd(v, v); return _mm256_movemask_pd(_mm256_cmp_pd(v, _mm256_set1_pd(2.0), _CMP_EQ_OQ)) != 15;"},
+    {"AVX2", "AVX", "immintrin.h", "-mavx2,/arch:AVX2",
+     "__m256i v = _mm256_set1_epi32(input); v = _mm256_add_epi32(v, v); return _mm256_movemask_epi8(_mm256_cmpeq_epi32(v, _mm256_set1_epi32(2))) != -1;"},
+    {"AVX512F", "AVX2", "immintrin.h", "-mavx512f,/arch:AVX512",
+     "__m512i v = _mm512_set1_epi32(input); v = _mm512_add_epi32(v, v); return _mm512_cmpeq_epi32_mask(v, _mm512_set1_epi32(2)) != 0xFFFF;"},
+    {"AVX512BW", "AVX512F", "immintrin.h", "-mavx512bw,/arch:AVX512",
+     "__m512i v = _mm512_set1_epi16((short)input); v = _mm512_add_epi16(v, v); return _mm512_cmpeq_epi16_mask(v, _mm512_set1_epi16(2)) != 0xFFFFFFFFUL;"},
+    {"AVX512DQ", "AVX512F", "immintrin.h", "-mavx512dq,/arch:AVX512",
+     "__m512i v = _mm512_set1_epi64(input); v = _mm512_mullo_epi64(v, v); return _mm512_cmpeq_epi64_mask(v, _mm512_set1_epi64(1)) != 0xFF;"},
+    {"AVX512VL", "AVX512F", "immintrin.h", "-mavx512vl,/arch:AVX512",
+     "__m256i v = _mm256_set1_epi32(input); return _mm256_cmpeq_epi32_mask(v, v) != 0xFF;"},
+    {"NEON", 0, "arm_neon.h", "-mfpu=neon",
+     "int32x4_t v = vdupq_n_s32(input); v = vaddq_s32(v, v); return vgetq_lane_s32(v, 0) != 2;"},
+    {"SVE", "NEON", "arm_sve.h", "-march=armv8-a+sve",
+     "svint32_t v = svdup_n_s32(input); return svaddv_s32(svptrue_b32(), v) < 4;"},
+    {0, 0, 0, 0, 0}
 };
 
 /* Execution */
@@ -332,10 +500,13 @@ const char *cdetect_format_remote = "%s %s >%s 2>&1";
 #if defined(CDETECT_COMPILER_MSC)
 const char *cdetect_format_compile = "\"%s\" /nologo %s %s %s /Fe%s %s";
 const char *cdetect_format_library = "/DEFAULTLIB:%s";
+const char *cdetect_format_warning_error = "/WX";
 #else
 /* Format: <compiler> <global cflags> <local cflags> <source> -o <target> <ldflags> */
 const char *cdetect_format_compile = "%s %s %s %s -o %s %s";
 const char *cdetect_format_library = "-l%s";
+/* Turns warnings about unknown flags into errors */
+const char *cdetect_format_warning_error = "-Werror";
 #endif
 
 /* Files */
@@ -349,17 +520,17 @@ const char *cdetect_suffix_source = ".c";
 #if defined(CDETECT_OS_WIN32)
 const char *cdetect_suffix_execute = ".exe";
 const char *cdetect_suffix_script = ".bat";
-const char *cdetect_file_execute = "cdetmp";
+const char *cdetect_file_execute_default = "cdetmp";
 const char cdetect_path_list_separator = ';'; /* Separates paths in the %PATH% environment variable */
 const char cdetect_path_separator = '\\'; /* Separates directories in path */
 #else
 const char *cdetect_suffix_execute = "";
 const char *cdetect_suffix_script = ".sh";
-const char *cdetect_file_execute = "./cdetmp";
+const char *cdetect_file_execute_default = "./cdetmp";
 const char cdetect_path_list_separator = ':'; /* Separates paths in the $PATH environment variable */
 const char cdetect_path_separator = '/'; /* Separates directories in path */
 #endif
-const char *cdetect_file_redirection = "cdetmp.txt";
+const char *cdetect_file_redirection_default = "cdetmp.txt";
 
 /* Misc */
 
@@ -371,6 +542,13 @@ const char *cdetect_cache_identifier_function = "FNC";
 const char *cdetect_cache_identifier_header = "HDR";
 const char *cdetect_cache_identifier_library = "LIB";
 const char *cdetect_cache_identifier_type = "TYP";
+const char *cdetect_cache_identifier_host = "HST";
+const char *cdetect_cache_identifier_integer = "INT";
+const char *cdetect_cache_identifier_compiler = "CMP";
+const char *cdetect_cache_identifier_run = "RUN";
+const char *cdetect_cache_identifier_header_location = "HDP";
+const char *cdetect_cache_identifier_cpu_feature = "CPF";
+const char *cdetect_cache_identifier_cflag = "FLG";
 
 const char cdetect_variable_begin = '@';
 const char cdetect_variable_end = '@';
@@ -385,50 +563,216 @@ const char *cdetect_null_text = "(null)";
 
 /*************************************************************************
  * Global Variables
+ *
+ * All state of a detection is kept in a context, so that independent
+ * detections can run in separate threads. The variables below refer to
+ * the context selected by the calling thread (see config_context_select),
+ * which is the default context unless another one has been selected.
  */
 
-cdetect_bool_t cdetect_is_usage = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_nested = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_silent = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_verbose = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_dryrun = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_compiler_checked = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_kernel_checked = CDETECT_FALSE;
-cdetect_bool_t cdetect_is_cpu_checked = CDETECT_FALSE;
-
-char *cdetect_command_compile = 0;
-char *cdetect_argument_cflags = 0;
-char *cdetect_command_remote = 0;
-
-char *cdetect_path = 0;
-
-cdetect_string_t cdetect_compiler_name = 0;
-unsigned int cdetect_compiler_version = 0;
-cdetect_string_t cdetect_kernel_name = 0;
-unsigned int cdetect_kernel_version = 0;
-cdetect_string_t cdetect_cpu_name = 0;
-unsigned int cdetect_cpu_version = 0;
-
-cdetect_map_t cdetect_option_map = 0;
-cdetect_map_t cdetect_option_value_map = 0;
-
-cdetect_map_t cdetect_macro_map = 0;
-cdetect_map_t cdetect_function_map = 0;
-cdetect_map_t cdetect_header_map = 0;
-cdetect_map_t cdetect_type_map = 0;
-cdetect_map_t cdetect_library_map = 0;
-
-cdetect_map_t cdetect_tool_map = 0;
-
-cdetect_string_t cdetect_header_format = 0;
-cdetect_string_t cdetect_function_format = 0;
-cdetect_string_t cdetect_library_format = 0;
-cdetect_string_t cdetect_type_format = 0;
-cdetect_string_t cdetect_work_directory = 0;
-cdetect_string_t cdetect_include_file = 0;
-cdetect_file_t cdetect_cache_file = 0;
-cdetect_string_t cdetect_copyright_notice = 0;
-cdetect_map_t cdetect_build_map = 0;
+typedef struct cdetect_context {
+    cdetect_bool_t is_initialized;
+    const char *file_execute; /* Prefix of temporary files */
+    const char *file_redirection; /* Output of executed commands */
+    cdetect_string_t file_execute_name; /* Storage of file_execute */
+    cdetect_string_t file_redirection_name; /* Storage of file_redirection */
+    cdetect_bool_t is_host_initialized;
+    cdetect_bool_t is_predefined_initialized;
+    cdetect_bool_t is_predefined_success;
+
+    cdetect_bool_t is_usage;
+    cdetect_bool_t is_nested;
+    cdetect_bool_t is_silent;
+    cdetect_bool_t is_verbose;
+    cdetect_bool_t is_dryrun;
+    cdetect_bool_t is_compiler_checked;
+    cdetect_bool_t is_kernel_checked;
+    cdetect_bool_t is_cpu_checked;
+    cdetect_bool_t is_predefined_compiler;
+    cdetect_bool_t is_predefined_cpu;
+    cdetect_bool_t is_remote_session;
+    cdetect_bool_t is_path_indexed;
+    cdetect_bool_t is_profile;
+    cdetect_bool_t is_run_prepared;
+    cdetect_bool_t is_uptodate;
+    cdetect_bool_t is_timed_out; /* Last command was stopped */
+    cdetect_bool_t is_limit_exceeded; /* Last program exceeded a limit */
+    unsigned int run_base;
+    unsigned int timeout; /* Seconds allowed for each command, 0 for no limit */
+    /* Resource limits of executed programs, 0 for no limit */
+    unsigned long limit_memory; /* Megabytes of address space */
+    unsigned long limit_cpu; /* Seconds of processor time */
+    unsigned long limit_processes; /* Processes of the user */
+    unsigned long limit_file_size; /* Megabytes per written file */
+
+    char *command_compile;
+    char *argument_cflags;
+    char *command_remote;
+    int session_input;
+    int session_output;
+    long session_pid;
+    char session_buffer[512];
+    size_t session_buffer_begin;
+    size_t session_buffer_end;
+    const char *format_predefined;
+    const char *format_includes;
+
+    char *path;
+
+    cdetect_string_t compiler_name;
+    unsigned int compiler_version;
+    cdetect_string_t kernel_name;
+    unsigned int kernel_version;
+    cdetect_string_t cpu_name;
+    unsigned int cpu_version;
+    cdetect_string_t compiler_fingerprint_value;
+
+    cdetect_map_t option_map;
+    cdetect_map_t option_value_map;
+
+    cdetect_map_t macro_map;
+    cdetect_map_t function_map;
+    cdetect_map_t header_map;
+    cdetect_map_t type_map;
+    cdetect_map_t library_map;
+    cdetect_map_t host_map;
+    cdetect_map_t cpu_feature_map; /* Compiler fingerprint and feature to outcome */
+    cdetect_map_t cflag_map; /* Compiler fingerprint and flag to outcome */
+    cdetect_map_t predefined_map;
+    cdetect_map_t integer_map;
+    cdetect_map_t compiler_map;
+
+    cdetect_map_t tool_map;
+    cdetect_map_t path_map;
+    cdetect_map_t compile_map; /* Results of compilations in this run */
+    cdetect_map_t run_map; /* Fingerprint and files of the previous run */
+    cdetect_map_t header_location_map; /* Stamp and path of found headers */
+    cdetect_map_t header_directory_map; /* Directories of found headers */
+    cdetect_map_t timeout_map; /* Results that must not be cached */
+    cdetect_map_t variant_map; /* Name and compile-time flags of variants */
+
+    cdetect_string_t header_format;
+    cdetect_string_t function_format;
+    cdetect_string_t library_format;
+    cdetect_string_t type_format;
+    cdetect_string_t work_directory;
+    cdetect_string_t include_file;
+    cdetect_file_t cache_file;
+    cdetect_string_t copyright_notice;
+    cdetect_map_t build_map;
+    cdetect_map_t depend_map; /* Input files other than templates */
+    cdetect_list_t execute_queue;
+    cdetect_string_t trace_file;
+    cdetect_string_t trace_events;
+    cdetect_stack_t trace_stack;
+    unsigned long trace_check_begin;
+    cdetect_map_t profile_phase_map;
+    cdetect_map_t profile_probe_map;
+    cdetect_list_t profile_checks;
+    cdetect_string_t profile_source;
+    unsigned long profile_reports[(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED) + 1];
+    unsigned int execute_queue_count;
+    unsigned int execute_queue_size;
+    cdetect_bool_t is_remote_shared_checked;
+    cdetect_bool_t is_remote_shared; /* Remote side sees the working directory */
+} *cdetect_context_t;
+
+struct cdetect_context cdetect_context_default;
+CDETECT_THREAD_LOCAL cdetect_context_t cdetect_context_current = &cdetect_context_default;
+unsigned int cdetect_context_count = 0;
+
+#define cdetect_file_execute (cdetect_context_current->file_execute)
+#define cdetect_file_redirection (cdetect_context_current->file_redirection)
+#define cdetect_is_host_initialized (cdetect_context_current->is_host_initialized)
+#define cdetect_is_predefined_initialized (cdetect_context_current->is_predefined_initialized)
+#define cdetect_is_predefined_success (cdetect_context_current->is_predefined_success)
+#define cdetect_is_usage (cdetect_context_current->is_usage)
+#define cdetect_is_nested (cdetect_context_current->is_nested)
+#define cdetect_is_silent (cdetect_context_current->is_silent)
+#define cdetect_is_verbose (cdetect_context_current->is_verbose)
+#define cdetect_is_dryrun (cdetect_context_current->is_dryrun)
+#define cdetect_is_compiler_checked (cdetect_context_current->is_compiler_checked)
+#define cdetect_is_kernel_checked (cdetect_context_current->is_kernel_checked)
+#define cdetect_is_cpu_checked (cdetect_context_current->is_cpu_checked)
+#define cdetect_is_predefined_compiler (cdetect_context_current->is_predefined_compiler)
+#define cdetect_is_predefined_cpu (cdetect_context_current->is_predefined_cpu)
+#define cdetect_is_remote_session (cdetect_context_current->is_remote_session)
+#define cdetect_is_path_indexed (cdetect_context_current->is_path_indexed)
+#define cdetect_is_profile (cdetect_context_current->is_profile)
+#define cdetect_is_run_prepared (cdetect_context_current->is_run_prepared)
+#define cdetect_is_uptodate (cdetect_context_current->is_uptodate)
+#define cdetect_is_timed_out (cdetect_context_current->is_timed_out)
+#define cdetect_is_limit_exceeded (cdetect_context_current->is_limit_exceeded)
+#define cdetect_run_base (cdetect_context_current->run_base)
+#define cdetect_timeout (cdetect_context_current->timeout)
+#define cdetect_limit_memory (cdetect_context_current->limit_memory)
+#define cdetect_limit_cpu (cdetect_context_current->limit_cpu)
+#define cdetect_limit_processes (cdetect_context_current->limit_processes)
+#define cdetect_limit_file_size (cdetect_context_current->limit_file_size)
+#define cdetect_command_compile (cdetect_context_current->command_compile)
+#define cdetect_argument_cflags (cdetect_context_current->argument_cflags)
+#define cdetect_command_remote (cdetect_context_current->command_remote)
+#define cdetect_session_input (cdetect_context_current->session_input)
+#define cdetect_session_output (cdetect_context_current->session_output)
+#define cdetect_session_pid (cdetect_context_current->session_pid)
+#define cdetect_session_buffer (cdetect_context_current->session_buffer)
+#define cdetect_session_buffer_begin (cdetect_context_current->session_buffer_begin)
+#define cdetect_session_buffer_end (cdetect_context_current->session_buffer_end)
+#define cdetect_format_predefined (cdetect_context_current->format_predefined)
+#define cdetect_format_includes (cdetect_context_current->format_includes)
+#define cdetect_path (cdetect_context_current->path)
+#define cdetect_compiler_name (cdetect_context_current->compiler_name)
+#define cdetect_compiler_version (cdetect_context_current->compiler_version)
+#define cdetect_kernel_name (cdetect_context_current->kernel_name)
+#define cdetect_kernel_version (cdetect_context_current->kernel_version)
+#define cdetect_cpu_name (cdetect_context_current->cpu_name)
+#define cdetect_cpu_version (cdetect_context_current->cpu_version)
+#define cdetect_compiler_fingerprint_value (cdetect_context_current->compiler_fingerprint_value)
+#define cdetect_option_map (cdetect_context_current->option_map)
+#define cdetect_option_value_map (cdetect_context_current->option_value_map)
+#define cdetect_macro_map (cdetect_context_current->macro_map)
+#define cdetect_function_map (cdetect_context_current->function_map)
+#define cdetect_header_map (cdetect_context_current->header_map)
+#define cdetect_type_map (cdetect_context_current->type_map)
+#define cdetect_library_map (cdetect_context_current->library_map)
+#define cdetect_host_map (cdetect_context_current->host_map)
+#define cdetect_cpu_feature_map (cdetect_context_current->cpu_feature_map)
+#define cdetect_cflag_map (cdetect_context_current->cflag_map)
+#define cdetect_predefined_map (cdetect_context_current->predefined_map)
+#define cdetect_integer_map (cdetect_context_current->integer_map)
+#define cdetect_compiler_map (cdetect_context_current->compiler_map)
+#define cdetect_tool_map (cdetect_context_current->tool_map)
+#define cdetect_path_map (cdetect_context_current->path_map)
+#define cdetect_compile_map (cdetect_context_current->compile_map)
+#define cdetect_run_map (cdetect_context_current->run_map)
+#define cdetect_header_location_map (cdetect_context_current->header_location_map)
+#define cdetect_header_directory_map (cdetect_context_current->header_directory_map)
+#define cdetect_timeout_map (cdetect_context_current->timeout_map)
+#define cdetect_variant_map (cdetect_context_current->variant_map)
+#define cdetect_header_format (cdetect_context_current->header_format)
+#define cdetect_function_format (cdetect_context_current->function_format)
+#define cdetect_library_format (cdetect_context_current->library_format)
+#define cdetect_type_format (cdetect_context_current->type_format)
+#define cdetect_work_directory (cdetect_context_current->work_directory)
+#define cdetect_include_file (cdetect_context_current->include_file)
+#define cdetect_cache_file (cdetect_context_current->cache_file)
+#define cdetect_copyright_notice (cdetect_context_current->copyright_notice)
+#define cdetect_build_map (cdetect_context_current->build_map)
+#define cdetect_depend_map (cdetect_context_current->depend_map)
+#define cdetect_execute_queue (cdetect_context_current->execute_queue)
+#define cdetect_trace_file (cdetect_context_current->trace_file)
+#define cdetect_trace_events (cdetect_context_current->trace_events)
+#define cdetect_trace_stack (cdetect_context_current->trace_stack)
+#define cdetect_trace_check_begin (cdetect_context_current->trace_check_begin)
+#define cdetect_profile_phase_map (cdetect_context_current->profile_phase_map)
+#define cdetect_profile_probe_map (cdetect_context_current->profile_probe_map)
+#define cdetect_profile_checks (cdetect_context_current->profile_checks)
+#define cdetect_profile_source (cdetect_context_current->profile_source)
+#define cdetect_profile_reports (cdetect_context_current->profile_reports)
+#define cdetect_execute_queue_count (cdetect_context_current->execute_queue_count)
+#define cdetect_execute_queue_size (cdetect_context_current->execute_queue_size)
+#define cdetect_is_remote_shared_checked (cdetect_context_current->is_remote_shared_checked)
+#define cdetect_is_remote_shared (cdetect_context_current->is_remote_shared)
 
 /*************************************************************************
  *
@@ -633,6 +977,245 @@ cdetect_strequal_max(const char *first,
     return ( atEnd || (count == max_length) );
 }
 
+/*
+ * Initialize the bit masks of a pattern segment
+ */
+
+cdetect_bool_t
+cdetect_glob_segment_set(cdetect_glob_segment_t self,
+                         const char *pattern,
+                         size_t length)
+{
+    size_t i;
+    int c;
+
+    self->length = length;
+    self->words = (length + CDETECT_GLOB_BITS - 1) / CDETECT_GLOB_BITS;
+    self->masks = 0;
+
+    if (self->words == 0)
+        return CDETECT_TRUE;
+
+    self->masks = (unsigned long *)cdetect_allocate((UCHAR_MAX + 1) * self->words * sizeof(unsigned long));
+    if (self->masks == 0)
+        return CDETECT_FALSE;
+    (void)memset(self->masks, 0, (UCHAR_MAX + 1) * self->words * sizeof(unsigned long));
+
+    for (i = 0; i < length; ++i) {
+        for (c = 0; c <= UCHAR_MAX; ++c) {
+            if ( (pattern[i] == cdetect_wildcard_one) ||
+                 (toupper(c) == toupper((int)((unsigned char)pattern[i]))) ) {
+                self->masks[c * self->words + i / CDETECT_GLOB_BITS] |= 1UL << (i % CDETECT_GLOB_BITS);
+            }
+        }
+    }
+    return CDETECT_TRUE;
+}
+
+/*
+ * Check if a pattern segment matches at the beginning of text
+ */
+
+cdetect_bool_t
+cdetect_glob_segment_at(cdetect_glob_segment_t self,
+                        const unsigned char *text)
+{
+    size_t i;
+
+    for (i = 0; i < self->length; ++i) {
+        if (((self->masks[text[i] * self->words + i / CDETECT_GLOB_BITS] >> (i % CDETECT_GLOB_BITS)) & 1UL) == 0)
+            return CDETECT_FALSE;
+    }
+    return CDETECT_TRUE;
+}
+
+/*
+ * Find the leftmost occurrence of a pattern segment in text[0..length).
+ *
+ * Returns the offset just after the occurrence, or zero if not found.
+ */
+
+size_t
+cdetect_glob_segment_find(cdetect_glob_segment_t self,
+                          const unsigned char *text,
+                          size_t length)
+{
+    unsigned long local[4];
+    unsigned long *state;
+    unsigned long carry;
+    unsigned long next_carry;
+    const unsigned long *mask;
+    size_t last_word;
+    unsigned long last_bit;
+    size_t result = 0;
+    size_t i;
+    size_t w;
+
+    assert(self->length > 0);
+
+    if (self->length > length)
+        return 0;
+
+    state = (self->words <= sizeof(local) / sizeof(local[0]))
+        ? local
+        : (unsigned long *)cdetect_allocate(self->words * sizeof(unsigned long));
+    if (state == 0)
+        return 0;
+    (void)memset(state, 0, self->words * sizeof(unsigned long));
+
+    last_word = (self->length - 1) / CDETECT_GLOB_BITS;
+    last_bit = 1UL << ((self->length - 1) % CDETECT_GLOB_BITS);
+
+    for (i = 0; i < length; ++i) {
+        mask = &self->masks[text[i] * self->words];
+        carry = 1UL;
+        for (w = 0; w < self->words; ++w) {
+            next_carry = state[w] >> (CDETECT_GLOB_BITS - 1);
+            state[w] = ((state[w] << 1) | carry) & mask[w];
+            carry = next_carry;
+        }
+        if (state[last_word] & last_bit) {
+            result = i + 1;
+            break;
+        }
+    }
+
+    if (state != local)
+        cdetect_free(state);
+
+    return result;
+}
+
+/*
+ * Compile a wildcard pattern
+ */
+
+cdetect_glob_t
+cdetect_glob_compile(const char *pattern)
+{
+    cdetect_glob_t self;
+    size_t before;
+    size_t after;
+    int count;
+
+    assert(pattern != 0);
+
+    self = (cdetect_glob_t)cdetect_allocate(sizeof(*self));
+    if (self == 0)
+        return 0;
+
+    /* Number of segments is at most the number of wildcards plus one */
+    count = 1;
+    for (after = 0; pattern[after] != 0; ++after) {
+        if (pattern[after] == cdetect_wildcard_many)
+            ++count;
+    }
+    self->has_wildcard = (cdetect_bool_t)(count > 1);
+    self->count = 0;
+    self->segment = (struct cdetect_glob_segment *)cdetect_allocate(count * sizeof(struct cdetect_glob_segment));
+    if (self->segment == 0) {
+        cdetect_free(self);
+        return 0;
+    }
+
+    before = 0;
+    for (;;) {
+        for (after = before;
+             (pattern[after] != 0) && (pattern[after] != cdetect_wildcard_many);
+             ++after)
+            continue;
+        /*
+         * Keep the first and last segment even if empty, because they are
+         * anchored to the beginning and end of the string.
+         */
+        if ( (after > before) || (self->count == 0) || (pattern[after] == 0) ) {
+            if (!cdetect_glob_segment_set(&self->segment[self->count++],
+                                          &pattern[before],
+                                          after - before)) {
+                while (self->count > 0) {
+                    cdetect_free(self->segment[--self->count].masks);
+                }
+                cdetect_free(self->segment);
+                cdetect_free(self);
+                return 0;
+            }
+        }
+        if (pattern[after] == 0)
+            break;
+        before = after + 1;
+    }
+    return self;
+}
+
+/*
+ * Destroy a compiled wildcard pattern
+ */
+
+void
+cdetect_glob_destroy(cdetect_glob_t self)
+{
+    int i;
+
+    if (self) {
+        for (i = 0; i < self->count; ++i) {
+            cdetect_free(self->segment[i].masks);
+        }
+        cdetect_free(self->segment);
+        cdetect_free(self);
+    }
+}
+
+/*
+ * Match string against compiled wildcard pattern.
+ *
+ * The first and last segment are anchored, and the segments in between are
+ * located leftmost-first, so every character of the string is examined at
+ * most once for each segment word.
+ */
+
+cdetect_bool_t
+cdetect_glob_match(cdetect_glob_t self,
+                   const char *string)
+{
+    const unsigned char *text = (const unsigned char *)string;
+    cdetect_glob_segment_t first;
+    cdetect_glob_segment_t last;
+    size_t length;
+    size_t begin;
+    size_t end;
+    size_t found;
+    int i;
+
+    if ((self == 0) || (string == 0))
+        return CDETECT_FALSE;
+
+    length = strlen(string);
+    first = &self->segment[0];
+    last = &self->segment[self->count - 1];
+
+    if (!self->has_wildcard) {
+        return (cdetect_bool_t)( (length == first->length) &&
+                                 cdetect_glob_segment_at(first, text) );
+    }
+
+    if (first->length + last->length > length)
+        return CDETECT_FALSE;
+    if (!cdetect_glob_segment_at(first, text))
+        return CDETECT_FALSE;
+    if (!cdetect_glob_segment_at(last, &text[length - last->length]))
+        return CDETECT_FALSE;
+
+    begin = first->length;
+    end = length - last->length;
+    for (i = 1; i < self->count - 1; ++i) {
+        found = cdetect_glob_segment_find(&self->segment[i], &text[begin], end - begin);
+        if (found == 0)
+            return CDETECT_FALSE;
+        begin += found;
+    }
+    return CDETECT_TRUE;
+}
+
 /*
  * Compare two strings using wildcards
  */
@@ -641,32 +1224,20 @@ int
 cdetect_strmatch(const char *string,
                  const char *pattern)
 {
+    cdetect_glob_t glob;
+    int result;
+
     if (string == pattern)
         return 1;
 
     if ((string == 0) || (pattern == 0))
         return 0;
 
-    for (; (pattern[0] != cdetect_wildcard_many); ++pattern, ++string) {
-        if (string[0] == 0) {
-            return (pattern[0] == 0);
-        }
-        if ( (toupper((int)string[0]) != toupper((int)pattern[0])) &&
-             (pattern[0] != cdetect_wildcard_one) ) {
-            return 0;
-        }
-    }
-    /* Two-line patch to prevent too much recursion */
-    while (pattern[1] == cdetect_wildcard_many)
-        pattern++;
-
-    for (; string[0] != 0; ++string) {
-        if ( cdetect_strmatch(string, &pattern[1]) ) {
-            return 1;
-        }
-    }
+    glob = cdetect_glob_compile(pattern);
+    result = (int)cdetect_glob_match(glob, string);
+    cdetect_glob_destroy(glob);
 
-    return 0;
+    return result;
 }
 
 /**
@@ -690,6 +1261,82 @@ config_match(const char *string,
     return cdetect_strmatch(string, pattern);
 }
 
+/**
+   Compile a wildcard pattern for repeated use.
+
+   @param pattern Pattern, including wildcards.
+   @return Compiled pattern, or the null pointer (0) on failure.
+
+   Use this instead of @c config_match when the same pattern is matched
+   against many strings. The pattern must be released with
+   @c config_pattern_destroy.
+
+   @sa config_pattern_match
+*/
+
+config_pattern_t
+config_pattern_compile(const char *pattern)
+{
+    if (pattern == 0)
+        return 0;
+
+    return cdetect_glob_compile(pattern);
+}
+
+/**
+   Compare string with a compiled wildcard pattern.
+
+   @param pattern Compiled pattern.
+   @param string String to be searched.
+   @return Boolean value indicating success or failure.
+
+   Same semantics as @c config_match.
+*/
+
+int
+config_pattern_match(config_pattern_t pattern,
+                     const char *string)
+{
+    return (int)cdetect_glob_match(pattern, string);
+}
+
+/**
+   Release a compiled wildcard pattern.
+
+   @param pattern Compiled pattern.
+*/
+
+void
+config_pattern_destroy(config_pattern_t pattern)
+{
+    cdetect_glob_destroy(pattern);
+}
+
+/*
+ * Calculate a 32-bit FNV-1a hash value of a string
+ *
+ * The @p seed is the hash value of any preceding data, which allows hashing
+ * of several strings in sequence. Use zero for the first string.
+ */
+
+unsigned int
+cdetect_hash_string(const char *data,
+                    unsigned int seed)
+{
+    unsigned long hash;
+
+    hash = (seed == 0) ? 2166136261UL : (unsigned long)seed;
+    if (data) {
+        for (; *data != 0; ++data) {
+            hash ^= (unsigned long)((unsigned char)*data);
+            hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+        }
+    }
+    /* Separate consecutive strings */
+    hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    return (unsigned int)hash;
+}
+
 /*
  * Copy a string
  */
@@ -985,6 +1632,7 @@ cdetect_string_append_quoted_char(cdetect_string_t self,
 
         switch (character) {
 
+        case '\\': buffer[i++] = '\\'; buffer[i++] = '\\'; break;
         case '\"': buffer[i++] = '\\'; buffer[i++] = '\"'; break;
         case '\'': buffer[i++] = '\\'; buffer[i++] = '\''; break;
 
@@ -1025,17 +1673,51 @@ cdetect_string_append_quoted_char(cdetect_string_t self,
 }
 
 /*
- * Append path (and separator if needed) to string
+ * Append text as the content of a JSON string
  */
 
 cdetect_bool_t
-cdetect_string_append_path(cdetect_string_t self,
-                           const char *path)
+cdetect_string_append_json(cdetect_string_t self,
+                           const char *text)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
+    const char *digits = "0123456789abcdef";
+    cdetect_bool_t success = CDETECT_TRUE;
+    unsigned char character;
 
-    if (self->content[self->length] != cdetect_path_separator) {
-        success = cdetect_string_append_char(self, cdetect_path_separator);
+    assert(self != 0);
+    assert(text != 0);
+
+    for (; success && (*text != 0); ++text) {
+        character = (unsigned char)*text;
+        if ((character == '\\') || (character == '\"')) {
+            success = cdetect_string_append_char(self, '\\');
+            if (success)
+                success = cdetect_string_append_char(self, (char)character);
+        } else if (character < 0x20) {
+            success = cdetect_string_append(self, "\\u00");
+            if (success)
+                success = cdetect_string_append_char(self, digits[character / 16]);
+            if (success)
+                success = cdetect_string_append_char(self, digits[character % 16]);
+        } else {
+            success = cdetect_string_append_char(self, (char)character);
+        }
+    }
+    return success;
+}
+
+/*
+ * Append path (and separator if needed) to string
+ */
+
+cdetect_bool_t
+cdetect_string_append_path(cdetect_string_t self,
+                           const char *path)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+
+    if (self->content[self->length] != cdetect_path_separator) {
+        success = cdetect_string_append_char(self, cdetect_path_separator);
     }
     if (success) {
         success = cdetect_string_append(self, path);
@@ -1044,44 +1726,53 @@ cdetect_string_append_path(cdetect_string_t self,
 }
 
 /*
- * Convert number to text and append to string
+ * Convert unsigned number to text and append to string
  */
 
 cdetect_bool_t
-cdetect_string_append_number(cdetect_string_t self,
-                             int number,
-                             int base)
+cdetect_string_append_unsigned(cdetect_string_t self,
+                               unsigned long number,
+                               int base)
 {
     const char *digits = "0123456789ABCDEF";
-    int absolute_number;
     char buffer[64];
     int i;
 
     assert(self != 0);
-    assert((base > 0) && (base <= (int)strlen(digits)));
+    assert((base > 1) && (base <= (int)strlen(digits)));
 
-    if (number == 0) {
-        if (cdetect_string_append_char(self, '0') == CDETECT_FALSE)
-            return CDETECT_FALSE;
+    i = sizeof(buffer) - 1;
+    buffer[i] = 0;
+    do {
+        buffer[--i] = digits[number % (unsigned long)base];
+        number /= (unsigned long)base;
+    } while ((number > 0) && (i > 0));
 
-    } else {
-        if (number < 0) {
-            absolute_number = -number;
-            if (cdetect_string_append_char(self, '-') == CDETECT_FALSE)
-                return CDETECT_FALSE;
-        } else {
-            absolute_number = number;
-        }
-        i = sizeof(buffer) - 1;
-        buffer[i] = 0;
-        while ((absolute_number > 0) && (i >= 0)) {
-            buffer[--i] = digits[absolute_number % base];
-            absolute_number /= base;
-        }
-        if (cdetect_string_append(self, &buffer[i]) == CDETECT_FALSE)
+    return cdetect_string_append(self, &buffer[i]);
+}
+
+/*
+ * Convert number to text and append to string
+ */
+
+cdetect_bool_t
+cdetect_string_append_number(cdetect_string_t self,
+                             long number,
+                             int base)
+{
+    unsigned long absolute_number;
+
+    assert(self != 0);
+
+    if (number < 0) {
+        /* Negate in unsigned arithmetic to handle INT_MIN */
+        absolute_number = 0UL - (unsigned long)number;
+        if (cdetect_string_append_char(self, '-') == CDETECT_FALSE)
             return CDETECT_FALSE;
+    } else {
+        absolute_number = (unsigned long)number;
     }
-    return CDETECT_TRUE;
+    return cdetect_string_append_unsigned(self, absolute_number, base);
 }
 
 /*
@@ -1226,17 +1917,19 @@ cdetect_string_unescape(const char *content,
 
     result = cdetect_string_create();
     for (i = 0; content[i] != 0; ++i) {
-        if (content[i] == escape) {
+        if (content[i] != escape) {
+            (void)cdetect_string_append_char(result, content[i]);
+        } else if (content[i + 1] == escape) {
+            (void)cdetect_string_append_char(result, escape);
             ++i;
-            after = cdetect_strskip(content, i, cdetect_is_digit);
-            if (after > i) {
-                character = (char)strtoul(&content[i], 0, 16);
+        } else {
+            after = cdetect_strskip(content, i + 1, cdetect_is_xdigit);
+            if (after > i + 1) {
+                character = (char)strtoul(&content[i + 1], 0, 16);
                 (void)cdetect_string_append_char(result, character);
-                i = after;
-                /* Trailing escape is ignored */
             }
-        } else {
-            (void)cdetect_string_append_char(result, content[i]);
+            /* Skip the closing escape. Trailing escape is ignored */
+            i = (content[after] == escape) ? after : after - 1;
         }
     }
     return result;
@@ -1274,6 +1967,7 @@ cdetect_string_vformat(const char *format,
     cdetect_bool_t is_dynamic;
     cdetect_bool_t is_quote;
     cdetect_bool_t is_alternative;
+    cdetect_bool_t is_long;
     cdetect_string_t string;
     char *native;
     const char *append;
@@ -1297,6 +1991,7 @@ cdetect_string_vformat(const char *format,
             is_dynamic = CDETECT_FALSE;
             is_quote = CDETECT_FALSE;
             is_alternative = CDETECT_FALSE;
+            is_long = CDETECT_FALSE;
             more_modifiers = CDETECT_TRUE;
 
             do {
@@ -1328,6 +2023,11 @@ cdetect_string_vformat(const char *format,
                     ++i;
                     break;
 
+                case 'l':
+                    is_long = CDETECT_TRUE;
+                    ++i;
+                    break;
+
                 default:
                     more_modifiers = CDETECT_FALSE;
                     break;
@@ -1407,7 +2107,10 @@ cdetect_string_vformat(const char *format,
                 assert(!is_dynamic);
                 assert(!is_quote);
                 assert(!is_size);
-                (void)cdetect_string_append_number(self, va_arg(arguments, int), 10);
+                if (is_long)
+                    (void)cdetect_string_append_number(self, va_arg(arguments, long), 10);
+                else
+                    (void)cdetect_string_append_number(self, va_arg(arguments, int), 10);
                 break;
 
             case 'u':
@@ -1416,7 +2119,10 @@ cdetect_string_vformat(const char *format,
                 assert(!is_dynamic);
                 assert(!is_quote);
                 assert(!is_size);
-                (void)cdetect_string_append_number(self, va_arg(arguments, unsigned int), 10);
+                if (is_long)
+                    (void)cdetect_string_append_unsigned(self, va_arg(arguments, unsigned long), 10);
+                else
+                    (void)cdetect_string_append_unsigned(self, va_arg(arguments, unsigned int), 10);
                 break;
 
             case 'x':
@@ -1425,7 +2131,10 @@ cdetect_string_vformat(const char *format,
                 assert(!is_dynamic);
                 assert(!is_quote);
                 assert(!is_size);
-                (void)cdetect_string_append_number(self, va_arg(arguments, unsigned int), 16);
+                if (is_long)
+                    (void)cdetect_string_append_unsigned(self, va_arg(arguments, unsigned long), 16);
+                else
+                    (void)cdetect_string_append_unsigned(self, va_arg(arguments, unsigned int), 16);
                 break;
 
             case '%':
@@ -2116,7 +2825,11 @@ cdetect_map_create(cdetect_map_create_t creator,
         self->creator = creator;
         self->destroyer = destroyer;
         self->first = cdetect_list_create();
-        for (i = 0; i < CDETECT_MAP_SIZE; ++i) {
+        self->last = self->first;
+        self->size = CDETECT_MAP_SIZE;
+        self->count = 0;
+        self->chain = (cdetect_map_element_t *)cdetect_allocate(self->size * sizeof(self->chain[0]));
+        for (i = 0; i < self->size; ++i) {
             self->chain[i] = 0;
         }
     }
@@ -2133,9 +2846,10 @@ cdetect_map_destroy(cdetect_map_t self)
     unsigned int i;
 
     if (self) {
-        for (i = 0; i < CDETECT_MAP_SIZE; ++i) {
+        for (i = 0; i < self->size; ++i) {
             cdetect_map_element_destroy_chain(self->chain[i]);
         }
+        cdetect_free(self->chain);
         cdetect_list_destroy(self->first);
         cdetect_free(self);
     }
@@ -2146,7 +2860,8 @@ cdetect_map_destroy(cdetect_map_t self)
  */
 
 unsigned int
-cdetect_map_index(const char *key)
+cdetect_map_index(cdetect_map_t self,
+                  const char *key)
 {
     unsigned int hash = 0;
     char character;
@@ -2157,7 +2872,43 @@ cdetect_map_index(const char *key)
         hash *= 31;
         hash += (unsigned int)((unsigned char)character);
     }
-    return (hash % CDETECT_MAP_SIZE);
+    return (hash % self->size);
+}
+
+/*
+ * Enlarge the chain array when the chains become too long
+ */
+
+void
+cdetect_map_grow(cdetect_map_t self)
+{
+    cdetect_map_element_t *chain;
+    cdetect_map_element_t *old_chain;
+    cdetect_map_element_t element;
+    cdetect_map_element_t next;
+    unsigned int old_size;
+    unsigned int i;
+    unsigned int j;
+
+    old_size = self->size;
+    chain = (cdetect_map_element_t *)cdetect_allocate((2 * old_size + 1) * sizeof(chain[0]));
+    if (chain != 0) {
+        old_chain = self->chain;
+        self->chain = chain;
+        self->size = 2 * old_size + 1;
+        for (i = 0; i < self->size; ++i) {
+            chain[i] = 0;
+        }
+        for (i = 0; i < old_size; ++i) {
+            for (element = old_chain[i]; element != 0; element = next) {
+                next = element->next;
+                j = cdetect_map_index(self, element->key);
+                element->next = chain[j];
+                chain[j] = element;
+            }
+        }
+        cdetect_free(old_chain);
+    }
 }
 
 /*
@@ -2176,15 +2927,22 @@ cdetect_map_remember(cdetect_map_t self,
     assert(key != 0);
     /* value can be null pointer */
 
-    i = cdetect_map_index(key);
+    i = cdetect_map_index(self, key);
     result = cdetect_map_element_find(self->chain[i], key);
     if (result == 0) {
         /* Create new entry */
+        if (self->count > 2 * self->size) {
+            cdetect_map_grow(self);
+            i = cdetect_map_index(self, key);
+        }
         result = cdetect_map_element_create(self);
         result->key = cdetect_strdup(key);
         result->next = self->chain[i];
         self->chain[i] = result;
-        cdetect_list_append(self->first, result);
+        self->count++;
+        /* Keep track of the tail to append in constant time */
+        cdetect_list_insert(self->last, result);
+        self->last = self->last->next;
     }
     cdetect_map_element_value(result, data);
     return result;
@@ -2201,7 +2959,7 @@ cdetect_map_lookup(cdetect_map_t self,
     assert(self != 0);
     assert(key != 0);
 
-    return cdetect_map_element_find(self->chain[cdetect_map_index(key)], key);
+    return cdetect_map_element_find(self->chain[cdetect_map_index(self, key)], key);
 }
 
 /*
@@ -2881,6 +3639,63 @@ cdetect_file_remove(const char *filename)
     return (cdetect_bool_t)remove(filename);
 }
 
+/*
+ * Create a scratch directory unless it exists already
+ */
+
+cdetect_bool_t
+cdetect_directory_create(const char *path)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+#if defined(CDETECT_HEADER_DIRENT_H)
+    struct stat status;
+
+    assert(path != 0);
+
+    if (mkdir(path, 0777) == 0) {
+        success = CDETECT_TRUE;
+    } else if (stat(path, &status) == 0) {
+        success = (cdetect_bool_t)S_ISDIR(status.st_mode);
+    }
+#else
+    (void)path;
+#endif
+    return success;
+}
+
+/*
+ * Remove a scratch directory including the files in it
+ */
+
+cdetect_bool_t
+cdetect_directory_remove(const char *path)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+#if defined(CDETECT_HEADER_DIRENT_H)
+    DIR *directory;
+    struct dirent *entry;
+    cdetect_string_t filename;
+
+    assert(path != 0);
+
+    directory = opendir(path);
+    if (directory) {
+        while ((entry = readdir(directory)) != 0) {
+            if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+                continue;
+            filename = cdetect_string_format("%s%c%s", path, cdetect_path_separator, entry->d_name);
+            (void)remove(filename->content);
+            cdetect_string_destroy(filename);
+        }
+        closedir(directory);
+        success = (rmdir(path) == 0);
+    }
+#else
+    (void)path;
+#endif
+    return success;
+}
+
 /*
  * Determine the file size
  */
@@ -2905,6 +3720,41 @@ cdetect_file_size(const char *filename)
     return result;
 }
 
+/*
+ * Describe the file status (size, modification time, and inode) as a string
+ *
+ * Two stamps of the same file are equal if the file has not been changed in
+ * between. Returns the null pointer if the file does not exist.
+ */
+
+cdetect_string_t
+cdetect_file_stamp(const char *filename)
+{
+    cdetect_string_t result = 0;
+#if defined(CDETECT_HEADER_SYS_STAT_H)
+    struct stat status;
+
+    assert(filename != 0);
+
+    if (stat(filename, &status) == 0) {
+        result = cdetect_string_format("%x.%x.%x",
+                                       (unsigned int)status.st_size,
+                                       (unsigned int)status.st_mtime,
+                                       (unsigned int)status.st_ino);
+    }
+#else
+    long size;
+
+    assert(filename != 0);
+
+    size = cdetect_file_size(filename);
+    if (size != -1) {
+        result = cdetect_string_format("%x", (unsigned int)size);
+    }
+#endif
+    return result;
+}
+
 /*
  * Read file content into string
  */
@@ -2938,6 +3788,27 @@ cdetect_file_read(const char *filename,
     return (cdetect_bool_t)success;
 }
 
+/*
+ * Calculate the hash value of the content of a file
+ *
+ * Returns the null pointer (0) if the file cannot be read.
+ */
+
+cdetect_string_t
+cdetect_file_hash(const char *filename)
+{
+    cdetect_string_t result = 0;
+    cdetect_string_t data;
+
+    if (cdetect_file_read(filename, &data)) {
+        result = cdetect_string_format("%x.%x",
+                                       (unsigned int)data->length,
+                                       cdetect_hash_string(data->content, 0));
+        cdetect_string_destroy(data);
+    }
+    return result;
+}
+
 /*
  * Write string to file
  */
@@ -3031,6 +3902,8 @@ cdetect_work_file_append(cdetect_string_t filename,
  *
  ************************************************************************/
 
+void cdetect_trace_check(const char *, cdetect_report_t); /* Forward declaration */
+
 void
 cdetect_voutput(FILE *stream, const char *format, va_list arguments)
 {
@@ -3095,12 +3968,20 @@ cdetect_report_bool(const char *message, cdetect_report_t found)
     cdetect_output("checking for %s... %s%s\n",
                    message,
                    (found & CDETECT_REPORT_FOUND) ? "yes" : "no",
-                   (found & CDETECT_REPORT_CACHED) ? " (cached)" : "");
+                   (found & CDETECT_REPORT_CACHED)
+                   ? " (cached)"
+                   : ((found & CDETECT_REPORT_TIMEOUT)
+                      ? " (timed out)"
+                      : ((found & CDETECT_REPORT_LIMIT) ? " (limit exceeded)" : "")));
+    cdetect_trace_check(message, found);
 }
 
 /**
    Report boolean result
 
+   A false result is reported as timed out, or as exceeding a resource
+   limit, if that is what stopped the last compilation or execution.
+
    @param message Message to be reported.
    @param found
 */
@@ -3108,7 +3989,14 @@ cdetect_report_bool(const char *message, cdetect_report_t found)
 void
 config_report_bool(const char *message, int found)
 {
-    cdetect_report_bool(message, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    cdetect_report_t report = CDETECT_REPORT_FOUND;
+
+    if (!found) {
+        report = cdetect_is_timed_out
+            ? CDETECT_REPORT_TIMEOUT
+            : (cdetect_is_limit_exceeded ? CDETECT_REPORT_LIMIT : CDETECT_REPORT_NULL);
+    }
+    cdetect_report_bool(message, report);
 }
 
 /* FIXME: Documentation */
@@ -3117,6 +4005,7 @@ void
 config_report_string(const char *message, const char *value)
 {
     cdetect_output("checking for %s... %s\n", message, value);
+    cdetect_trace_check(message, CDETECT_REPORT_FOUND);
 }
 
 /*
@@ -3137,1869 +4026,6118 @@ cdetect_log(const char *format, ...)
 
 /*************************************************************************
  *
- * Substitution
+ * Tracing
  *
  ************************************************************************/
 
 /*
- * Substitute a single variable
+ * Monotonic clock in microseconds since the first call
  */
 
-cdetect_bool_t
-cdetect_substitute_variable(cdetect_string_t source,
-                            cdetect_string_t target,
-                            size_t variable_before,
-                            size_t variable_after,
-                            size_t default_before,
-                            size_t default_after,
-                            cdetect_map_t variable_map)
+unsigned long
+cdetect_clock(void)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    cdetect_string_t variable;
-    cdetect_map_element_t element;
-
-    assert(source != 0);
-    assert(target != 0);
-
-    if (variable_map) {
-        variable = cdetect_string_create();
-        if (variable) {
-            (void)cdetect_string_append_range(variable, source->content, variable_before, variable_after);
+    static cdetect_bool_t is_initialized = CDETECT_FALSE;
+#if defined(CLOCK_MONOTONIC)
+    static struct timespec origin;
+    struct timespec now;
+
+    if (!is_initialized) {
+        is_initialized = CDETECT_TRUE;
+        (void)clock_gettime(CLOCK_MONOTONIC, &origin);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long)(now.tv_sec - origin.tv_sec) * 1000000UL
+        + (unsigned long)(now.tv_nsec / 1000)
+        - (unsigned long)(origin.tv_nsec / 1000);
+#elif defined(CDETECT_HEADER_WINDOWS_H)
+    static LARGE_INTEGER origin;
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+
+    if (!is_initialized) {
+        is_initialized = CDETECT_TRUE;
+        (void)QueryPerformanceFrequency(&frequency);
+        (void)QueryPerformanceCounter(&origin);
+    }
+    (void)QueryPerformanceCounter(&now);
+    return (frequency.QuadPart == 0)
+        ? 0
+        : (unsigned long)(((now.QuadPart - origin.QuadPart) * 1000000) / frequency.QuadPart);
+#else
+    /* Only second resolution */
+    static time_t origin;
 
-            if (variable->content) {
-                element = cdetect_map_lookup(variable_map, variable->content);
-                if (element && element->data) {
-                    /* Use stored value */
-                    (void)cdetect_string_append(target, (const char *)element->data);
-                    success = CDETECT_TRUE;
-                } else if ((default_after > 0) && (default_before <= default_after)) {
-                    /* Use default value */
-                    (void)cdetect_string_append_range(target, source->content, default_before, default_after);
-                    success = CDETECT_TRUE;
-                }
-            }
-            cdetect_string_destroy(variable);
-        }
+    if (!is_initialized) {
+        is_initialized = CDETECT_TRUE;
+        origin = time(0);
     }
-    return success;
+    return (unsigned long)difftime(time(0), origin) * 1000000UL;
+#endif
 }
 
 /*
- * Substitute all variables in string
+ * Check if timing is recorded
  */
 
 cdetect_bool_t
-cdetect_substitute_string(cdetect_string_t source,
-                          cdetect_string_t *target)
+cdetect_trace_enabled(void)
 {
-    /* Copy source to target while replacing all known occurrences of @VARIABLE@ */
-    size_t before = 0;
-    size_t after = 0;
-    size_t variable_before;
-    size_t variable_after;
-    size_t default_before;
-    size_t default_after;
-    size_t line_separator;
-    cdetect_bool_t do_copy;
-
-    assert(source != 0);
-    assert(target != 0);
-
-    *target = cdetect_string_format("");
-    if (*target == 0) return CDETECT_FALSE;
-
-    while (after < source->length) {
-        /* Copy text before variable */
-        after = cdetect_string_find_char(source, before, cdetect_variable_begin);
-        (void)cdetect_string_append_range(*target, source->content, before, after);
-        if (after == source->length)
-            break;
-
-        before = after + sizeof(cdetect_variable_begin);
-
-        /* Substitute variable if exists, otherwise copy */
-        after = cdetect_string_find_char(source, before, cdetect_variable_end);
-        if (after == source->length) {
-            do_copy = CDETECT_TRUE;
-        }
+    return (cdetect_bool_t)((cdetect_trace_file != 0) || cdetect_is_profile);
+}
 
-        variable_before = before;
-        variable_after = cdetect_string_find_char(source, before, cdetect_variable_default);
-        if (variable_after < after) {
-            default_after = after;
-            default_before = variable_after + sizeof(cdetect_variable_default);
-        } else {
-            variable_after = after;
-            default_before = 0;
-            default_after = 0;
-        }
+/*
+ * Append a complete event in the Chrome trace event format
+ *
+ * The arguments are inserted verbatim into the "args" object.
+ */
 
-        line_separator = cdetect_string_find_char(source, before, cdetect_variable_line);
-        if (line_separator < after) {
-            /* Newline found in variable. Skip over cdetect_variable_begin and try again. */
-            do_copy = CDETECT_TRUE;
-            after = before;
-        } else {
-            do_copy = !cdetect_substitute_variable(source,
-                                                   *target,
-                                                   variable_before,
-                                                   variable_after,
-                                                   default_before,
-                                                   default_after,
-                                                   cdetect_tool_map);
-        }
-        if (do_copy) {
-            (void)cdetect_string_append_range(*target,
-                                              source->content,
-                                              before - sizeof(cdetect_variable_begin),
-                                              after + sizeof(cdetect_variable_end));
-        }
+void
+cdetect_trace_emit(const char *category,
+                   const char *name,
+                   unsigned long begin,
+                   unsigned long end,
+                   const char *arguments)
+{
+    if (cdetect_trace_file == 0)
+        return;
 
-        before = after + sizeof(cdetect_variable_end);
-        after = before;
+    if (cdetect_trace_events == 0) {
+        cdetect_trace_events = cdetect_string_create();
+    } else {
+        (void)cdetect_string_append(cdetect_trace_events, ",\n");
     }
-
-    return (after == source->length) ? CDETECT_TRUE : CDETECT_FALSE;
+    (void)cdetect_string_append(cdetect_trace_events, "{\"name\":\"");
+    (void)cdetect_string_append_json(cdetect_trace_events, name);
+    (void)cdetect_string_append(cdetect_trace_events, "\",\"cat\":\"");
+    (void)cdetect_string_append_json(cdetect_trace_events, category);
+    (void)cdetect_string_append(cdetect_trace_events, "\",\"ph\":\"X\",\"ts\":");
+    (void)cdetect_string_append_unsigned(cdetect_trace_events, begin, 10);
+    (void)cdetect_string_append(cdetect_trace_events, ",\"dur\":");
+    (void)cdetect_string_append_unsigned(cdetect_trace_events, end - begin, 10);
+    (void)cdetect_string_append(cdetect_trace_events, ",\"pid\":1,\"tid\":1,\"args\":{");
+    (void)cdetect_string_append(cdetect_trace_events, arguments ? arguments : "");
+    (void)cdetect_string_append(cdetect_trace_events, "}}");
 }
 
 /*
- * Substitute all variables in file
+ * Add a finished slice to the profile
  */
 
 void
-cdetect_substitute_file(const char *source,
-                        const char *target)
+cdetect_profile_slice(const char *category,
+                      const char *name,
+                      unsigned long duration)
 {
-    cdetect_string_t input;
-    cdetect_string_t output;
-
-    cdetect_log("cdetect_substitute_file(source = %'s, target = %'s)\n", source, target);
+    cdetect_map_t map;
+    cdetect_map_element_t element;
+    cdetect_profile_total_t total;
 
-    if (cdetect_file_read(source, &input)) {
+    if (!cdetect_is_profile)
+        return;
 
-        if (cdetect_substitute_string(input, &output)) {
-            (void)cdetect_file_remove(target);
-            if (cdetect_file_overwrite(target, output) == CDETECT_FALSE) {
-                cdetect_log("Cannot write file %s\n", target);
-            }
-            cdetect_output("creating %s (from %s)\n", target, source);
-        }
-        cdetect_string_destroy(output);
-        cdetect_string_destroy(input);
+    map = cdetect_strequal(category, "phase")
+        ? cdetect_profile_phase_map
+        : cdetect_profile_probe_map;
+    element = cdetect_map_lookup(map, name);
+    if (element == 0) {
+        total = (cdetect_profile_total_t)cdetect_allocate(sizeof(*total));
+        total->count = 0;
+        total->duration = 0;
+        element = cdetect_map_remember(map, name, total);
     }
+    total = (cdetect_profile_total_t)element->data;
+    total->count++;
+    total->duration += duration;
 }
 
 /*
- * Substitute all variables in all registered files
+ * Remember the source code compiled by the current check
  */
 
 void
-cdetect_substitute_all_files(void)
+cdetect_profile_compile(cdetect_string_t sourcecode)
 {
-    cdetect_map_element_t element;
-    cdetect_list_t current;
+    if (!cdetect_is_profile)
+        return;
 
-    for (current = cdetect_list_front(cdetect_build_map->first);
-         current != 0;
-         current = cdetect_list_next(current)) {
-        element = (cdetect_map_element_t)current->data;
-        if (element) {
-            cdetect_substitute_file(element->key, (const char *)element->data);
-        }
-    }
+    cdetect_string_destroy(cdetect_profile_source);
+    cdetect_profile_source = cdetect_string_format("%^s", sourcecode);
 }
 
-/*************************************************************************
- *
- * Execution and Compilation
- *
- ************************************************************************/
-
 /*
- * Wrapper for system() to hide platform specific code
+ * Add a finished check to the profile
  */
 
-cdetect_bool_t
-cdetect_system(const char *command)
+void
+cdetect_profile_check(const char *name,
+                      cdetect_report_t report,
+                      unsigned long duration)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    int status;
-
-    assert(command != 0);
+    cdetect_profile_check_t check;
 
-#if defined(CDETECT_FUNC__FLUSHALL)
+    if (!cdetect_is_profile)
+        return;
 
-    /*
-     * The system() documentation on MSDN states:
-     *
-     *  "You must explicitly flush (using fflush or _flushall) or close any
-     *   stream before calling system."
-     */
-    (void)_flushall();
+    cdetect_profile_reports[report & (CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED)]++;
 
-#endif
+    check = (cdetect_profile_check_t)cdetect_allocate(sizeof(*check));
+    if (check) {
+        check->name = cdetect_string_format("%s", name);
+        check->source = cdetect_profile_source;
+        check->duration = duration;
+        cdetect_list_append(cdetect_profile_checks, check);
+    }
+    cdetect_profile_source = 0;
+}
 
-    status = system(command);
+void
+cdetect_profile_check_destroy(cdetect_profile_check_t self)
+{
+    if (self) {
+        cdetect_string_destroy(self->source);
+        cdetect_string_destroy(self->name);
+        cdetect_free(self);
+    }
+}
 
-#if defined(WIFEXITED) && defined(WEXITSTATUS) && defined(WIFSIGNALED)
+/*
+ * Format a duration in seconds with millisecond precision
+ */
 
-    /* Extract the proper exit code */
-    if ((WIFEXITED(status)) && ((WEXITSTATUS(status)) == 0)) {
-        success = CDETECT_TRUE;
-    } else if (WIFSIGNALED(status)) {
-        /* Terminate if signal was raised (e.g. SIGINT) */
-        cdetect_fatal("Terminated\n");
-    }
+cdetect_string_t
+cdetect_profile_duration(unsigned long microseconds)
+{
+    unsigned long milliseconds;
 
-#else
+    milliseconds = (microseconds + 500) / 1000;
+    return cdetect_string_format("%lu.%c%c%c s",
+                                 milliseconds / 1000,
+                                 (char)('0' + (milliseconds / 100) % 10),
+                                 (char)('0' + (milliseconds / 10) % 10),
+                                 (char)('0' + milliseconds % 10));
+}
 
-    if (status == 0) {
-        success = CDETECT_TRUE;
-    }
+/*
+ * Output one row of the profile table
+ */
 
-#endif
+void
+cdetect_profile_row(const char *name,
+                    unsigned long count,
+                    unsigned long duration)
+{
+    cdetect_string_t time;
 
-    return success;
+    time = cdetect_profile_duration(duration);
+    if (count > 0) {
+        cdetect_output("  %-*s %*^s  %lu\n", 24, name, 12, time, count);
+    } else {
+        cdetect_output("  %-*s %*^s\n", 24, name, 12, time);
+    }
+    cdetect_string_destroy(time);
 }
 
 /*
- * Execute a command and return the status and the output
+ * Order checks by decreasing duration
  */
 
-cdetect_bool_t
-cdetect_execute(cdetect_string_t command,
-                cdetect_string_t *result,
-                cdetect_bool_t is_remote)
+int
+cdetect_profile_compare(const void *first,
+                        const void *second)
 {
-    cdetect_bool_t success;
-    cdetect_string_t full_command;
-    cdetect_string_t redirection;
+    unsigned long first_duration;
+    unsigned long second_duration;
 
-    cdetect_log("cdetect_execute(command = %'#^s, result, is_remote = %d)\n",
-                command, (int)is_remote);
+    first_duration = (*(const cdetect_profile_check_t *)first)->duration;
+    second_duration = (*(const cdetect_profile_check_t *)second)->duration;
+    if (first_duration == second_duration)
+        return 0;
+    return (first_duration < second_duration) ? 1 : -1;
+}
 
-    if (is_remote && (cdetect_file_exist(cdetect_command_remote) == CDETECT_FALSE)) {
-        success = CDETECT_FALSE;
-        cdetect_log("cdetect_execute(command = %'^s) failed\n", command);
-        cdetect_log("Remote execution not possible\n");
+/*
+ * Output the profile summary
+ */
 
-    } else {
+void
+cdetect_profile_report(void)
+{
+    cdetect_list_t current;
+    cdetect_map_element_t element;
+    cdetect_profile_total_t total;
+    cdetect_profile_check_t check;
+    cdetect_profile_check_t *sorted;
+    cdetect_string_t line;
+    cdetect_string_t rest;
+    cdetect_string_t time;
+    unsigned long wall;
+    unsigned long accounted = 0;
+    unsigned long checks = 0;
+    unsigned long check_time = 0;
+    unsigned long hits;
+    size_t count;
+    size_t i;
 
-        redirection = cdetect_file_unique_name(cdetect_file_redirection);
+    if (!cdetect_is_profile)
+        return;
 
-        if (is_remote) {
-            full_command = cdetect_string_format(cdetect_format_remote,
-                                                 cdetect_command_remote,
-                                                 command->content,
-                                                 redirection->content);
-        } else {
-            full_command = cdetect_string_format(cdetect_format_execute,
-                                                 command->content,
-                                                 redirection->content);
-        }
+    wall = cdetect_clock();
 
-        success = cdetect_system(full_command->content);
+    cdetect_output("\nProfile (time, count)\n");
+    cdetect_profile_row("total", 0, wall);
 
-        (void)cdetect_file_read(redirection->content, result);
+    for (current = cdetect_list_front(cdetect_profile_checks);
+         current != 0;
+         current = cdetect_list_next(current)) {
+        check = (cdetect_profile_check_t)current->data;
+        checks++;
+        check_time += check->duration;
+    }
+    cdetect_profile_row("checks", checks, check_time);
+    accounted += check_time;
 
-        (void)cdetect_file_remove(redirection->content);
-        cdetect_string_destroy(redirection);
-        cdetect_string_destroy(full_command);
+    for (current = cdetect_list_front(cdetect_profile_phase_map->first);
+         current != 0;
+         current = cdetect_list_next(current)) {
+        element = (cdetect_map_element_t)current->data;
+        total = (cdetect_profile_total_t)element->data;
+        cdetect_profile_row(element->key, 0, total->duration);
+        accounted += total->duration;
+    }
+    cdetect_profile_row("other", 0, (wall > accounted) ? wall - accounted : 0);
 
-        if (success == CDETECT_FALSE) {
-            cdetect_log("cdetect_execute(%'^s) failed\n", command);
-            cdetect_log(">>> OUTPUT BEGIN\n%s<<< OUTPUT END\n",
-                        (*result) ? (*result)->content : "");
+    cdetect_output("\nProbes (time, count)\n");
+    for (current = cdetect_list_front(cdetect_profile_probe_map->first);
+         current != 0;
+         current = cdetect_list_next(current)) {
+        element = (cdetect_map_element_t)current->data;
+        total = (cdetect_profile_total_t)element->data;
+        cdetect_profile_row(element->key, total->count, total->duration);
+    }
+
+    hits = cdetect_profile_reports[CDETECT_REPORT_CACHED]
+        + cdetect_profile_reports[CDETECT_REPORT_CACHED | CDETECT_REPORT_FOUND];
+    cdetect_output("\nChecks\n");
+    cdetect_output("  found %lu, not found %lu, cached found %lu, cached not found %lu\n",
+                   cdetect_profile_reports[CDETECT_REPORT_FOUND],
+                   cdetect_profile_reports[CDETECT_REPORT_NULL],
+                   cdetect_profile_reports[CDETECT_REPORT_CACHED | CDETECT_REPORT_FOUND],
+                   cdetect_profile_reports[CDETECT_REPORT_CACHED]);
+    cdetect_output("  cache hits %lu (%lu%%), misses %lu (%lu%%)\n",
+                   hits,
+                   (checks > 0) ? (100 * hits) / checks : 0,
+                   checks - hits,
+                   (checks > 0) ? (100 * (checks - hits)) / checks : 0);
+
+    count = (size_t)checks;
+    if (count > 0) {
+        sorted = (cdetect_profile_check_t *)cdetect_allocate(count * sizeof(*sorted));
+        i = 0;
+        for (current = cdetect_list_front(cdetect_profile_checks);
+             current != 0;
+             current = cdetect_list_next(current)) {
+            sorted[i++] = (cdetect_profile_check_t)current->data;
+        }
+        qsort(sorted, count, sizeof(*sorted), cdetect_profile_compare);
+
+        cdetect_output("\nSlowest checks\n");
+        for (i = 0; (i < count) && (i < CDETECT_PROFILE_TOP); ++i) {
+            time = cdetect_profile_duration(sorted[i]->duration);
+            cdetect_output("  %*^s  %^s\n", 12, time, sorted[i]->name);
+            cdetect_string_destroy(time);
+            if (sorted[i]->source) {
+                line = cdetect_string_format("%^s", sorted[i]->source);
+                while (line) {
+                    rest = cdetect_string_split(line, '\n');
+                    if ((line->length > 0) || rest) {
+                        cdetect_output("      | %^s\n", line);
+                    }
+                    cdetect_string_destroy(line);
+                    line = rest;
+                }
+            }
         }
+        cdetect_free(sorted);
     }
-    return success;
 }
 
-cdetect_bool_t
-cdetect_execute_substitute(cdetect_string_t command,
-                           cdetect_string_t *result,
-                           cdetect_bool_t is_remote)
+/*
+ * Begin a slice
+ *
+ * Slices must be ended in reverse order. A phase also starts a new check,
+ * so that checks never straddle phase boundaries.
+ */
+
+void
+cdetect_trace_begin(const char *category,
+                    const char *name)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    cdetect_string_t real_command = 0;
+    cdetect_trace_slice_t slice;
 
-    if (cdetect_substitute_string(command, &real_command)) {
+    if (!cdetect_trace_enabled())
+        return;
 
-        success = cdetect_execute(real_command, result, is_remote);
+    slice = (cdetect_trace_slice_t)cdetect_allocate(sizeof(*slice));
+    if (slice) {
+        slice->category = category;
+        slice->name = cdetect_string_format("%s", name);
+        slice->begin = cdetect_clock();
+        if (cdetect_strequal(category, "phase")) {
+            cdetect_trace_check_begin = slice->begin;
+        }
+        cdetect_stack_push(cdetect_trace_stack, slice);
     }
-
-    cdetect_string_destroy(real_command);
-
-    return success;
 }
 
 /*
- * Compile a file and optionally execute the resulting program
+ * End the most recent slice
  */
 
-cdetect_bool_t
-cdetect_compile_file(cdetect_string_t source_file,
-                     cdetect_string_t execute_file,
-                     cdetect_string_t cflags,
-                     cdetect_string_t ldflags,
-                     cdetect_string_t arguments,
-                     int do_execute,
-                     int is_remote,
-                     cdetect_string_t *result)
+void
+cdetect_trace_end(const char *arguments)
 {
-    cdetect_bool_t success;
-    cdetect_string_t compile_command;
-    cdetect_string_t execute_command = 0;
+    cdetect_trace_slice_t slice;
+    unsigned long end;
 
-    assert(source_file != 0);
-    assert(execute_file != 0);
-    assert(result != 0);
+    if (!cdetect_trace_enabled() || cdetect_stack_empty(cdetect_trace_stack))
+        return;
 
-    if (cdetect_command_compile == 0) {
-        return CDETECT_FALSE;
+    slice = (cdetect_trace_slice_t)cdetect_stack_pop(cdetect_trace_stack);
+    end = cdetect_clock();
+    cdetect_trace_emit(slice->category, slice->name->content, slice->begin, end, arguments);
+    cdetect_profile_slice(slice->category, slice->name->content, end - slice->begin);
+    if (cdetect_strequal(slice->category, "phase")) {
+        cdetect_trace_check_begin = end;
     }
+    cdetect_string_destroy(slice->name);
+    cdetect_free(slice);
+}
 
-    (void)cdetect_file_remove(execute_file->content);
+/*
+ * End the current check
+ *
+ * Every check ends with a single report, so a check covers the time since
+ * the previous report (or phase boundary).
+ */
 
-    compile_command = cdetect_string_format(cdetect_format_compile,
-                                            cdetect_command_compile,
-                                            cdetect_argument_cflags,
-                                            cflags ? cflags->content : "",
-                                            source_file->content,
-                                            execute_file->content,
-                                            ldflags ? ldflags->content : "");
+void
+cdetect_trace_check(const char *name,
+                    cdetect_report_t report)
+{
+    unsigned long end;
+    const char *arguments;
 
-    success = cdetect_execute(compile_command, result, CDETECT_FALSE);
+    if (!cdetect_trace_enabled())
+        return;
 
-    if (success && do_execute) {
-        cdetect_string_destroy(*result);
-        *result = 0;
+    end = cdetect_clock();
+    arguments = (report & CDETECT_REPORT_CACHED)
+        ? ((report & CDETECT_REPORT_FOUND) ? "\"cached\":true,\"found\":true" : "\"cached\":true,\"found\":false")
+        : ((report & CDETECT_REPORT_FOUND) ? "\"cached\":false,\"found\":true" : "\"cached\":false,\"found\":false");
+    cdetect_trace_emit("check", name, cdetect_trace_check_begin, end, arguments);
+    cdetect_profile_check(name, report, end - cdetect_trace_check_begin);
+    cdetect_trace_check_begin = end;
+}
 
-        if (arguments) {
-            execute_command = cdetect_string_format("%^s %^s", execute_file, arguments);
-        } else {
-            execute_command = cdetect_string_format("%^s", execute_file);
-        }
+/*
+ * Write the trace file
+ */
 
-        success = cdetect_execute(execute_command,
-                                  result,
-                                  (cdetect_bool_t)is_remote);
-    }
+void
+cdetect_trace_save(void)
+{
+    cdetect_string_t output;
 
-    if (execute_command) {
-        cdetect_string_destroy(execute_command);
-    }
-    cdetect_string_destroy(compile_command);
+    if (cdetect_trace_file == 0)
+        return;
 
-    return success;
+    cdetect_log("cdetect_trace_save(%'^s)\n", cdetect_trace_file);
+
+    output = cdetect_string_format("{\"traceEvents\":[\n%s\n],\"displayTimeUnit\":\"ms\"}\n",
+                                   cdetect_trace_events ? cdetect_trace_events->content : "");
+    if (!cdetect_file_overwrite(cdetect_trace_file->content, output)) {
+        cdetect_output("Cannot write trace file %'^s\n", cdetect_trace_file);
+    }
+    cdetect_string_destroy(output);
 }
 
+/*************************************************************************
+ *
+ * Substitution
+ *
+ ************************************************************************/
+
 /*
- * Write source code to file and compile
+ * Substitute a single variable
  */
 
 cdetect_bool_t
-cdetect_compile_source(cdetect_string_t sourcecode,
-                       cdetect_string_t cflags,
-                       cdetect_string_t ldflags,
-                       cdetect_string_t arguments,
-                       cdetect_bool_t do_execute,
-                       cdetect_bool_t is_remote,
-                       cdetect_string_t *result)
+cdetect_substitute_variable(cdetect_string_t source,
+                            cdetect_string_t target,
+                            size_t variable_before,
+                            size_t variable_after,
+                            size_t default_before,
+                            size_t default_after,
+                            cdetect_map_t variable_map)
 {
-    cdetect_bool_t success;
-    cdetect_string_t execute_file;
-    cdetect_string_t source_file;
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t variable;
+    cdetect_map_element_t element;
+
+    assert(source != 0);
+    assert(target != 0);
+
+    if (variable_map) {
+        variable = cdetect_string_create();
+        if (variable) {
+            (void)cdetect_string_append_range(variable, source->content, variable_before, variable_after);
+
+            if (variable->content) {
+                element = cdetect_map_lookup(variable_map, variable->content);
+                if (element && element->data) {
+                    /* Use stored value */
+                    (void)cdetect_string_append(target, (const char *)element->data);
+                    success = CDETECT_TRUE;
+                } else if ((default_after > 0) && (default_before <= default_after)) {
+                    /* Use default value */
+                    (void)cdetect_string_append_range(target, source->content, default_before, default_after);
+                    success = CDETECT_TRUE;
+                }
+            }
+            cdetect_string_destroy(variable);
+        }
+    }
+    return success;
+}
+
+/*
+ * Substitute all variables in string
+ */
+
+cdetect_bool_t
+cdetect_substitute_string(cdetect_string_t source,
+                          cdetect_string_t *target)
+{
+    /* Copy source to target while replacing all known occurrences of @VARIABLE@ */
+    size_t before = 0;
+    size_t after = 0;
+    size_t variable_before;
+    size_t variable_after;
+    size_t default_before;
+    size_t default_after;
+    size_t line_separator;
+    cdetect_bool_t do_copy;
+
+    assert(source != 0);
+    assert(target != 0);
+
+    *target = cdetect_string_format("");
+    if (*target == 0) return CDETECT_FALSE;
+
+    while (after < source->length) {
+        /* Copy text before variable */
+        after = cdetect_string_find_char(source, before, cdetect_variable_begin);
+        (void)cdetect_string_append_range(*target, source->content, before, after);
+        if (after == source->length)
+            break;
+
+        before = after + sizeof(cdetect_variable_begin);
+
+        /* Substitute variable if exists, otherwise copy */
+        after = cdetect_string_find_char(source, before, cdetect_variable_end);
+        if (after == source->length) {
+            do_copy = CDETECT_TRUE;
+        }
+
+        variable_before = before;
+        variable_after = cdetect_string_find_char(source, before, cdetect_variable_default);
+        if (variable_after < after) {
+            default_after = after;
+            default_before = variable_after + sizeof(cdetect_variable_default);
+        } else {
+            variable_after = after;
+            default_before = 0;
+            default_after = 0;
+        }
+
+        line_separator = cdetect_string_find_char(source, before, cdetect_variable_line);
+        if (line_separator < after) {
+            /* Newline found in variable. Skip over cdetect_variable_begin and try again. */
+            do_copy = CDETECT_TRUE;
+            after = before;
+        } else {
+            do_copy = !cdetect_substitute_variable(source,
+                                                   *target,
+                                                   variable_before,
+                                                   variable_after,
+                                                   default_before,
+                                                   default_after,
+                                                   cdetect_tool_map);
+        }
+        if (do_copy) {
+            (void)cdetect_string_append_range(*target,
+                                              source->content,
+                                              before - sizeof(cdetect_variable_begin),
+                                              after + sizeof(cdetect_variable_end));
+        }
+
+        before = after + sizeof(cdetect_variable_end);
+        after = before;
+    }
+
+    return (after == source->length) ? CDETECT_TRUE : CDETECT_FALSE;
+}
+
+/*
+ * Substitute all variables in file
+ */
+
+void
+cdetect_substitute_file(const char *source,
+                        const char *target)
+{
+    cdetect_string_t input;
+    cdetect_string_t output;
+
+    cdetect_log("cdetect_substitute_file(source = %'s, target = %'s)\n", source, target);
+
+    if (cdetect_file_read(source, &input)) {
+
+        if (cdetect_substitute_string(input, &output)) {
+            (void)cdetect_file_remove(target);
+            if (cdetect_file_overwrite(target, output) == CDETECT_FALSE) {
+                cdetect_log("Cannot write file %s\n", target);
+            }
+            cdetect_output("creating %s (from %s)\n", target, source);
+        }
+        cdetect_string_destroy(output);
+        cdetect_string_destroy(input);
+    }
+}
+
+/*
+ * Substitute all variables in all registered files
+ */
+
+void
+cdetect_substitute_all_files(void)
+{
+    cdetect_map_element_t element;
+    cdetect_list_t current;
+
+    for (current = cdetect_list_front(cdetect_build_map->first);
+         current != 0;
+         current = cdetect_list_next(current)) {
+        element = (cdetect_map_element_t)current->data;
+        if (element) {
+            cdetect_substitute_file(element->key, (const char *)element->data);
+        }
+    }
+}
+
+/*************************************************************************
+ *
+ * Execution and Compilation
+ *
+ ************************************************************************/
+
+/*
+ * Wrapper for system() to hide platform specific code
+ */
+
+cdetect_bool_t
+cdetect_system(const char *command)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    int status;
+
+    assert(command != 0);
+
+#if defined(CDETECT_FUNC__FLUSHALL)
+
+    /*
+     * The system() documentation on MSDN states:
+     *
+     *  "You must explicitly flush (using fflush or _flushall) or close any
+     *   stream before calling system."
+     */
+    (void)_flushall();
+
+#endif
+
+    status = system(command);
+
+#if defined(WIFEXITED) && defined(WEXITSTATUS) && defined(WIFSIGNALED)
+
+    /* Extract the proper exit code */
+    if ((WIFEXITED(status)) && ((WEXITSTATUS(status)) == 0)) {
+        success = CDETECT_TRUE;
+    } else if (WIFSIGNALED(status)) {
+        /* Terminate if signal was raised (e.g. SIGINT) */
+        cdetect_fatal("Terminated\n");
+    }
+
+#else
+
+    if (status == 0) {
+        success = CDETECT_TRUE;
+    }
+
+#endif
+
+    return success;
+}
+
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+
+/*
+ * Process groups of the running children
+ *
+ * Children in process groups of their own do not receive the signals that
+ * the terminal sends to the process group of the caller, so the groups are
+ * stopped when such a signal terminates the process. Signal dispositions
+ * are process-wide, so the groups of all contexts are kept here.
+ */
+
+#define CDETECT_PROCESS_GROUP_MAX 64
+#define CDETECT_PROCESS_SIGNALS 3
+
+volatile long cdetect_process_group[CDETECT_PROCESS_GROUP_MAX];
+volatile int cdetect_process_group_count = 0;
+int cdetect_process_signal_number[CDETECT_PROCESS_SIGNALS] = { SIGINT, SIGTERM, SIGHUP };
+/* Handlers of the embedding program, restored when the last group is gone */
+void (*cdetect_process_signal_previous[CDETECT_PROCESS_SIGNALS])(int);
+volatile int cdetect_process_signal_is_installed = 0;
+
+/*
+ * Restore the signal handlers of the embedding program
+ */
+
+void
+cdetect_process_signal_restore(void)
+{
+    int i;
+
+    if (cdetect_process_signal_is_installed) {
+        cdetect_process_signal_is_installed = 0;
+        for (i = 0; i < CDETECT_PROCESS_SIGNALS; ++i) {
+            (void)signal(cdetect_process_signal_number[i], cdetect_process_signal_previous[i]);
+        }
+    }
+}
+
+/*
+ * Stop the process groups of the children, and pass the signal on
+ *
+ * The children are sent SIGTERM, so that they stop their own groups too.
+ */
+
+void
+cdetect_process_signal(int number)
+{
+    int i;
+
+    for (i = 0; i < cdetect_process_group_count; ++i) {
+        (void)kill(-(pid_t)cdetect_process_group[i], SIGTERM);
+    }
+    cdetect_process_signal_restore();
+    (void)raise(number);
+}
+
+/*
+ * Remember the process group of a child
+ */
+
+void
+cdetect_process_group_add(long process)
+{
+    void (*previous)(int);
+    int i;
+
+    if (!cdetect_process_signal_is_installed) {
+        for (i = 0; i < CDETECT_PROCESS_SIGNALS; ++i) {
+            previous = signal(cdetect_process_signal_number[i], cdetect_process_signal);
+            if (previous == SIG_ERR) {
+                previous = SIG_DFL;
+            } else if (previous == SIG_IGN) {
+                /* Signals ignored by the caller (e.g. nohup) stay ignored */
+                (void)signal(cdetect_process_signal_number[i], SIG_IGN);
+            }
+            cdetect_process_signal_previous[i] = previous;
+        }
+        cdetect_process_signal_is_installed = 1;
+    }
+    if (cdetect_process_group_count < CDETECT_PROCESS_GROUP_MAX) {
+        cdetect_process_group[cdetect_process_group_count] = process;
+        ++cdetect_process_group_count;
+    }
+}
+
+/*
+ * Forget the process group of a child that has finished
+ */
+
+void
+cdetect_process_group_remove(long process)
+{
+    int i;
+
+    for (i = 0; i < cdetect_process_group_count; ++i) {
+        if (cdetect_process_group[i] == process) {
+            cdetect_process_group[i] = cdetect_process_group[cdetect_process_group_count - 1];
+            --cdetect_process_group_count;
+            break;
+        }
+    }
+    if (cdetect_process_group_count == 0)
+        cdetect_process_signal_restore();
+}
+
+#endif
+
+/*
+ * Fork a child process
+ *
+ * The child is placed in its own process group, so that it can be stopped
+ * together with anything it has started. The group is also stopped if a
+ * signal terminates the caller. The child can send a result to the
+ * parent through the descriptor stored in channel. Returns the process
+ * identifier to the parent, zero to the child, and -1 on failure.
+ */
+
+long
+cdetect_process_fork(int *channel)
+{
+    long result = -1;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    int descriptors[2];
+    int i;
+
+    assert(channel != 0);
+
+    if (pipe(descriptors) == 0) {
+        (void)fflush(0);
+        result = (long)fork();
+        if (result == 0) {
+            (void)setpgid(0, 0);
+            /* The groups of the siblings belong to the parent */
+            cdetect_process_group_count = 0;
+            /* Stopped by cdetect_process_kill whatever the parent handles */
+            for (i = 0; i < CDETECT_PROCESS_SIGNALS; ++i) {
+                cdetect_process_signal_previous[i] = SIG_DFL;
+                (void)signal(cdetect_process_signal_number[i], cdetect_process_signal);
+            }
+            cdetect_process_signal_is_installed = 1;
+            (void)close(descriptors[0]);
+            *channel = descriptors[1];
+        } else {
+            (void)close(descriptors[1]);
+            if (result > 0) {
+                /* Avoid race with the child */
+                (void)setpgid((pid_t)result, (pid_t)result);
+                cdetect_process_group_add(result);
+                *channel = descriptors[0];
+            } else {
+                (void)close(descriptors[0]);
+            }
+        }
+    }
+#else
+    (void)channel;
+#endif
+    return result;
+}
+
+/*
+ * Apply the resource limits of executed programs in the child process
+ */
+
+void
+cdetect_process_limit(void)
+{
+#if defined(CDETECT_HEADER_SYS_RESOURCE_H)
+    struct rlimit limit;
+
+    if (cdetect_limit_memory > 0) {
+        limit.rlim_cur = limit.rlim_max = (rlim_t)cdetect_limit_memory * 1024 * 1024;
+# if defined(RLIMIT_AS)
+        (void)setrlimit(RLIMIT_AS, &limit);
+# else
+        (void)setrlimit(RLIMIT_DATA, &limit);
+# endif
+    }
+    if (cdetect_limit_cpu > 0) {
+        /* The soft limit raises SIGXCPU, the hard limit one second later SIGKILL */
+        limit.rlim_cur = (rlim_t)cdetect_limit_cpu;
+        limit.rlim_max = (rlim_t)cdetect_limit_cpu + 1;
+        (void)setrlimit(RLIMIT_CPU, &limit);
+    }
+# if defined(RLIMIT_NPROC)
+    if (cdetect_limit_processes > 0) {
+        limit.rlim_cur = limit.rlim_max = (rlim_t)cdetect_limit_processes;
+        (void)setrlimit(RLIMIT_NPROC, &limit);
+    }
+# endif
+    if (cdetect_limit_file_size > 0) {
+        limit.rlim_cur = limit.rlim_max = (rlim_t)cdetect_limit_file_size * 1024 * 1024;
+        (void)setrlimit(RLIMIT_FSIZE, &limit);
+    }
+#endif
+}
+
+/*
+ * Is any resource limit of executed programs registered
+ */
+
+cdetect_bool_t
+cdetect_process_is_limited(void)
+{
+    return (cdetect_bool_t)((cdetect_limit_memory > 0) ||
+                            (cdetect_limit_cpu > 0) ||
+                            (cdetect_limit_processes > 0) ||
+                            (cdetect_limit_file_size > 0));
+}
+
+/*
+ * Terminate a child process in the child process
+ *
+ * Output buffers are flushed, but the exit handlers of the parent are not
+ * run again.
+ */
+
+void
+cdetect_process_exit(int channel,
+                     int status)
+{
+    (void)fflush(0);
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    (void)close(channel);
+    _exit(status);
+#else
+    (void)channel;
+    exit(status);
+#endif
+}
+
+/*
+ * Read everything the child process has written to the channel
+ *
+ * The channel is closed afterwards.
+ */
+
+cdetect_string_t
+cdetect_process_read(int channel)
+{
+    cdetect_string_t result;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    char buffer[256];
+    long length;
+    long i;
+
+    result = cdetect_string_create();
+    while ((length = (long)read(channel, buffer, sizeof(buffer))) > 0) {
+        for (i = 0; i < length; ++i) {
+            (void)cdetect_string_append_char(result, buffer[i]);
+        }
+    }
+    (void)close(channel);
+#else
+    (void)channel;
+    result = cdetect_string_create();
+#endif
+    return result;
+}
+
+/*
+ * Wait for a child process to finish
+ *
+ * Returns the exit status, or -1 if the child did not exit normally.
+ */
+
+int
+cdetect_process_wait(long process)
+{
+    int result = -1;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    int status;
+
+    if (waitpid((pid_t)process, &status, 0) == (pid_t)process) {
+        if (WIFEXITED(status)) {
+            result = WEXITSTATUS(status);
+        }
+    }
+    cdetect_process_group_remove(process);
+#else
+    (void)process;
+#endif
+    return result;
+}
+
+/*
+ * Wait for a child process to finish before a deadline
+ *
+ * If the child has not finished after timeout seconds, it is stopped
+ * together with everything it has started, and is_timed_out is set. A
+ * timeout of zero waits without deadline. Returns the exit status, or 128
+ * plus the signal number if the child was stopped by a signal (like the
+ * shell does), or -1 on failure.
+ */
+
+int
+cdetect_process_wait_timeout(long process,
+                             unsigned int timeout,
+                             cdetect_bool_t *is_timed_out)
+{
+    int result = -1;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    unsigned long deadline;
+    unsigned long delay = 1000; /* Microseconds */
+#if defined(CLOCK_MONOTONIC)
+    struct timespec pause;
+#endif
+    pid_t finished;
+    int status;
+
+    assert(is_timed_out != 0);
+
+    *is_timed_out = CDETECT_FALSE;
+    deadline = cdetect_clock() + (unsigned long)timeout * 1000000UL;
+    for (;;) {
+        finished = waitpid((pid_t)process, &status, (timeout > 0) ? WNOHANG : 0);
+        if (finished == (pid_t)process) {
+            if (WIFEXITED(status)) {
+                result = WEXITSTATUS(status);
+            } else if (WIFSIGNALED(status)) {
+                result = 128 + WTERMSIG(status);
+            }
+            break;
+        }
+        if ((finished < 0) || (cdetect_clock() >= deadline)) {
+            *is_timed_out = (cdetect_bool_t)(finished == 0);
+            /* Only a child with a deadline has a process group of its own */
+            (void)kill((timeout > 0) ? -(pid_t)process : (pid_t)process, SIGKILL);
+            (void)waitpid((pid_t)process, &status, 0);
+            break;
+        }
+#if defined(CLOCK_MONOTONIC)
+        /* Poll often for short commands, and less often for long ones */
+        pause.tv_sec = 0;
+        pause.tv_nsec = (long)delay * 1000L;
+        (void)nanosleep(&pause, 0);
+#elif defined(_XOPEN_UNIX)
+        (void)usleep(delay);
+#else
+        (void)sleep(1);
+#endif
+        if (delay < 50000)
+            delay *= 2;
+    }
+    cdetect_process_group_remove(process);
+#else
+    (void)timeout;
+    *is_timed_out = CDETECT_FALSE;
+    result = cdetect_process_wait(process);
+#endif
+    return result;
+}
+
+/*
+ * Stop a child process and everything it has started
+ *
+ * The child is sent SIGTERM first, so that it stops the process groups of
+ * its own children, and whatever is left of its group is killed afterwards.
+ */
+
+void
+cdetect_process_kill(long process)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    (void)kill(-(pid_t)process, SIGTERM);
+    (void)cdetect_process_wait(process);
+    (void)kill(-(pid_t)process, SIGKILL);
+#else
+    (void)process;
+#endif
+}
+
+/*
+ * Wrapper for system() with a deadline and resource limits
+ *
+ * With a deadline, the command runs in a process group of its own, which
+ * is stopped as a whole if the command has not finished after timeout
+ * seconds. Without deadline (zero) the command stays in the process group
+ * of the caller, so that stopping the caller stops the command too. If
+ * is_limited is set, the resource limits of executed programs are applied
+ * to the command. Without process control the command runs without
+ * deadline and limits.
+ */
+
+cdetect_bool_t
+cdetect_system_process(const char *command,
+                       unsigned int timeout,
+                       cdetect_bool_t is_limited)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    long process;
+    int channel;
+    int status;
+
+    assert(command != 0);
+
+    cdetect_is_timed_out = CDETECT_FALSE;
+    cdetect_is_limit_exceeded = CDETECT_FALSE;
+    if (timeout > 0) {
+        process = cdetect_process_fork(&channel);
+    } else {
+        (void)fflush(0);
+        process = (long)fork();
+        channel = -1;
+    }
+    if (process == 0) {
+        /* Child process */
+        if (channel != -1)
+            (void)close(channel);
+        if (is_limited)
+            cdetect_process_limit();
+        (void)execl("/bin/sh", "sh", "-c", command, (char *)0);
+        _exit(127);
+    } else if (process > 0) {
+        if (channel != -1)
+            (void)close(channel);
+        status = cdetect_process_wait_timeout(process, timeout, &cdetect_is_timed_out);
+        if (cdetect_is_timed_out) {
+            cdetect_log("cdetect_system_process(%'s) stopped after %u seconds\n",
+                        command, timeout);
+        } else if (is_limited && (status > 128)) {
+            /* Signals sent when the processor time or file size is exceeded */
+            cdetect_is_limit_exceeded = (cdetect_bool_t)((status == 128 + SIGXCPU) ||
+                                                         (status == 128 + SIGXFSZ) ||
+                                                         ((status == 128 + SIGKILL) && (cdetect_limit_cpu > 0)));
+            if (cdetect_is_limit_exceeded) {
+                cdetect_log("cdetect_system_process(%'s) exceeded resource limit\n", command);
+            }
+        }
+        return (cdetect_bool_t)(status == 0);
+    }
+#else
+    (void)timeout;
+    (void)is_limited;
+#endif
+    cdetect_is_timed_out = CDETECT_FALSE;
+    cdetect_is_limit_exceeded = CDETECT_FALSE;
+    return cdetect_system(command);
+}
+
+/*
+ * Remember whether a result has timed out
+ *
+ * Results that have timed out are reported as missing, but are not written
+ * to the cache, so they are checked again by the next run.
+ */
+
+void
+cdetect_timeout_remember(const char *type,
+                         const char *key,
+                         cdetect_report_t report)
+{
+    cdetect_string_t name;
+
+    name = cdetect_string_format("%s%c%s", type, cdetect_cache_separator, key);
+    if ((report & CDETECT_REPORT_TIMEOUT)) {
+        (void)cdetect_map_remember(cdetect_timeout_map, name->content, "1");
+    } else if (cdetect_map_lookup(cdetect_timeout_map, name->content)) {
+        (void)cdetect_map_remember(cdetect_timeout_map, name->content, 0);
+    }
+    cdetect_string_destroy(name);
+}
+
+cdetect_bool_t
+cdetect_timeout_lookup(const char *type,
+                       const char *key)
+{
+    cdetect_map_element_t element;
+    cdetect_string_t name;
+
+    name = cdetect_string_format("%s%c%s", type, cdetect_cache_separator, key);
+    element = cdetect_map_lookup(cdetect_timeout_map, name->content);
+    cdetect_string_destroy(name);
+
+    return (cdetect_bool_t)(element && element->data);
+}
+
+cdetect_bool_t
+cdetect_timeout_exist(void)
+{
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+
+    for (position = cdetect_list_front(cdetect_timeout_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && element->data)
+            return CDETECT_TRUE;
+    }
+    return CDETECT_FALSE;
+}
+
+/*
+ * Remote session
+ *
+ * With --remote-session, the remote command is started only once, running
+ * a small agent program. Requests and replies are exchanged over the stdin
+ * and stdout of the agent. Each message starts with a header line, which
+ * is followed by the number of payload bytes stated in the header.
+ *
+ *   PUT <name> <length>   Store payload as executable file
+ *   RUN <length>          Execute payload as command
+ *   QUIT                  Terminate agent
+ *
+ * All replies are "OK <status> <length>" followed by the command output.
+ * The agent removes the uploaded files when it terminates.
+ */
+
+static const char *cdetect_session_agent[] = {
+    "#include <stdio.h>",
+    "#include <stdlib.h>",
+    "#include <string.h>",
+    "#if defined(unix) || defined(__unix) || defined(__unix__) || (defined(__APPLE__) && defined(__MACH__))",
+    "# include <sys/types.h>",
+    "# include <sys/stat.h>",
+    "# define AGENT_CHMOD(name) chmod(name, 0755)",
+    "#else",
+    "# define AGENT_CHMOD(name) 0",
+    "#endif",
+    "#define AGENT_OUTPUT \"cdetmps.txt\"",
+    "struct upload { struct upload *next; char name[256]; } *uploads = 0;",
+    "void remember(const char *name) {",
+    "  struct upload *current;",
+    "  for (current = uploads; current != 0; current = current->next) if (strcmp(current->name, name) == 0) return;",
+    "  current = (struct upload *)malloc(sizeof(*current));",
+    "  if (current) { strcpy(current->name, name); current->next = uploads; uploads = current; }",
+    "}",
+    "void forget(void) {",
+    "  struct upload *current;",
+    "  while (uploads != 0) { current = uploads; uploads = current->next; remove(current->name); free(current); }",
+    "}",
+    "void reply(int status, FILE *file) {",
+    "  long length = 0; int c;",
+    "  if (file) { fseek(file, 0L, SEEK_END); length = ftell(file); rewind(file); }",
+    "  printf(\"OK %d %ld\\n\", status, length);",
+    "  if (file) { while ((c = fgetc(file)) != EOF) putchar(c); fclose(file); }",
+    "  fflush(stdout);",
+    "}",
+    "int main(void) {",
+    "  char line[512]; char name[256]; char *command; long length; long i; int c; int status; FILE *file;",
+    "  while (fgets(line, sizeof(line), stdin)) {",
+    "    if (sscanf(line, \"PUT %255s %ld\", name, &length) == 2) {",
+    "      file = fopen(name, \"wb\");",
+    "      for (i = 0; i < length; ++i) { if ((c = getchar()) == EOF) return 1; if (file) putc(c, file); }",
+    "      status = (file == 0);",
+    "      if (file) remember(name);",
+    "      if (file) { if (fclose(file) != 0) status = 1; if (AGENT_CHMOD(name) != 0) status = 1; }",
+    "      reply(status, 0);",
+    "    } else if (sscanf(line, \"RUN %ld\", &length) == 1) {",
+    "      command = (char *)malloc((size_t)length + 1);",
+    "      if ((command == 0) || (fread(command, 1, (size_t)length, stdin) != (size_t)length)) return 1;",
+    "      command[length] = 0;",
+    "      fflush(stdout);",
+    "      status = system(command);",
+    "      free(command);",
+    "      reply(status, fopen(AGENT_OUTPUT, \"rb\"));",
+    "      remove(AGENT_OUTPUT);",
+    "    } else if (strncmp(line, \"QUIT\", 4) == 0) {",
+    "      break;",
+    "    } else {",
+    "      reply(1, 0);",
+    "    }",
+    "  }",
+    "  forget();",
+    "  return 0;",
+    "}",
+    0
+};
+
+const char *cdetect_session_output_file = "cdetmps.txt"; /* Must match AGENT_OUTPUT */
+
+#if defined(SIGPIPE)
+/*
+ * Signal dispositions are process-wide, so the sessions of all contexts
+ * are counted here. The handler of the embedding program is restored when
+ * the last session stops.
+ */
+void (*cdetect_session_sigpipe)(int) = SIG_DFL;
+unsigned int cdetect_session_count = 0;
+#endif
+
+cdetect_bool_t cdetect_compile_file(cdetect_string_t,
+                                    cdetect_string_t,
+                                    cdetect_string_t,
+                                    cdetect_string_t,
+                                    cdetect_string_t,
+                                    int,
+                                    int,
+                                    cdetect_string_t *); /* Forward declaration */
+
+/*
+ * Stop remote session
+ */
+
+void
+cdetect_session_stop(void)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    int status;
+    cdetect_string_t agent_file;
+
+    if (cdetect_session_input != -1) {
+        (void)write(cdetect_session_input, "QUIT\n", 5);
+        (void)close(cdetect_session_input);
+        cdetect_session_input = -1;
+    }
+    if (cdetect_session_output != -1) {
+        (void)close(cdetect_session_output);
+        cdetect_session_output = -1;
+    }
+    cdetect_session_buffer_begin = cdetect_session_buffer_end = 0;
+    if (cdetect_session_pid > 0) {
+        (void)waitpid((pid_t)cdetect_session_pid, &status, 0);
+        cdetect_session_pid = -1;
+        agent_file = cdetect_string_format("%sa%s",
+                                           cdetect_file_execute,
+                                           cdetect_suffix_execute);
+        (void)cdetect_file_remove(agent_file->content);
+        cdetect_string_destroy(agent_file);
+#if defined(SIGPIPE)
+        if ((cdetect_session_count > 0) && (--cdetect_session_count == 0)) {
+            (void)signal(SIGPIPE, cdetect_session_sigpipe);
+        }
+#endif
+    }
+#endif
+}
+
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+
+/*
+ * Write all data to agent
+ */
+
+cdetect_bool_t
+cdetect_session_write(const char *data,
+                      size_t length)
+{
+    ssize_t written;
+
+    while (length > 0) {
+        written = write(cdetect_session_input, data, length);
+        if (written <= 0)
+            return CDETECT_FALSE;
+        data += written;
+        length -= (size_t)written;
+    }
+    return CDETECT_TRUE;
+}
+
+/*
+ * Read a single character from agent (or EOF)
+ */
+
+int
+cdetect_session_read(void)
+{
+    ssize_t count;
+
+    if (cdetect_session_buffer_begin == cdetect_session_buffer_end) {
+        count = read(cdetect_session_output,
+                     cdetect_session_buffer,
+                     sizeof(cdetect_session_buffer));
+        if (count <= 0)
+            return EOF;
+        cdetect_session_buffer_begin = 0;
+        cdetect_session_buffer_end = (size_t)count;
+    }
+    return (int)((unsigned char)cdetect_session_buffer[cdetect_session_buffer_begin++]);
+}
+
+#endif
+
+/*
+ * Send request to agent and wait for reply
+ */
+
+cdetect_bool_t
+cdetect_session_request(cdetect_string_t header,
+                        cdetect_string_t payload,
+                        int *status,
+                        cdetect_string_t *result)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_string_t line;
+    long length;
+    long i;
+    int c;
+
+    *result = 0;
+    if (cdetect_session_input == -1)
+        return CDETECT_FALSE;
+
+    /* Request */
+    length = payload ? (long)payload->length : 0;
+    line = cdetect_string_format("%^s %ld\n", header, length);
+    c = (int)cdetect_session_write(line->content, line->length);
+    cdetect_string_destroy(line);
+    if (!c || ((length > 0) && !cdetect_session_write(payload->content, (size_t)length)))
+        goto error;
+
+    /* Reply */
+    line = cdetect_string_create();
+    while (((c = cdetect_session_read()) != EOF) && (c != '\n')) {
+        (void)cdetect_string_append_char(line, (char)c);
+    }
+    c = (line->content != 0) && (sscanf(line->content, "OK %d %ld", status, &length) == 2);
+    cdetect_string_destroy(line);
+    if (!c)
+        goto error;
+
+    *result = cdetect_string_create();
+    if (cdetect_string_reserve(*result, (size_t)length + 1) == CDETECT_FALSE)
+        goto error;
+    for (i = 0; i < length; ++i) {
+        c = cdetect_session_read();
+        if (c == EOF)
+            goto error;
+        (*result)->content[(*result)->length++] = (char)c;
+    }
+    (*result)->content[(*result)->length] = 0;
+
+    return CDETECT_TRUE;
+
+ error:
+    cdetect_log("Remote session lost\n");
+    cdetect_string_destroy(*result);
+    *result = 0;
+    cdetect_session_stop();
+#else
+    (void)header;
+    (void)payload;
+    (void)status;
+    (void)result;
+#endif
+    return CDETECT_FALSE;
+}
+
+/*
+ * Upload executable file to agent
+ */
+
+cdetect_bool_t
+cdetect_session_upload(const char *filename)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t header;
+    cdetect_string_t payload = 0;
+    cdetect_string_t reply = 0;
+    int status = -1;
+
+    header = cdetect_string_format("PUT %s", filename);
+    if (cdetect_file_read(filename, &payload) &&
+        cdetect_session_request(header, payload, &status, &reply)) {
+        success = (status == 0) ? CDETECT_TRUE : CDETECT_FALSE;
+    }
+    cdetect_string_destroy(reply);
+    cdetect_string_destroy(payload);
+    cdetect_string_destroy(header);
+
+    return success;
+}
+
+/*
+ * Start remote session
+ */
+
+cdetect_bool_t
+cdetect_session_start(void)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_bool_t success;
+    cdetect_string_t source_file;
+    cdetect_string_t execute_file;
+    cdetect_string_t sourcecode;
+    cdetect_string_t command;
+    cdetect_string_t result = 0;
+    int to_agent[2];
+    int from_agent[2];
+    int i;
+
+    if (cdetect_session_input != -1)
+        return CDETECT_TRUE;
+    if (cdetect_session_pid != 0)
+        return CDETECT_FALSE; /* Failed earlier */
+    cdetect_session_pid = -1;
+
+    cdetect_log("cdetect_session_start(%'s)\n", cdetect_command_remote);
+
+    source_file = cdetect_string_format("%sa%s", /* Name purposely mangled */
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+    execute_file = cdetect_string_format("%sa%s",
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    sourcecode = cdetect_string_create();
+    for (i = 0; cdetect_session_agent[i] != 0; ++i) {
+        (void)cdetect_string_append(sourcecode, cdetect_session_agent[i]);
+        (void)cdetect_string_append_char(sourcecode, '\n');
+    }
+
+    success = cdetect_file_overwrite(source_file->content, sourcecode);
+    if (success) {
+        success = cdetect_compile_file(source_file,
+                                       execute_file,
+                                       0,
+                                       0,
+                                       0,
+                                       CDETECT_FALSE,
+                                       CDETECT_FALSE,
+                                       &result);
+    }
+    (void)cdetect_file_remove(source_file->content);
+
+    if (success && (pipe(to_agent) == 0)) {
+        if (pipe(from_agent) == 0) {
+
+            command = cdetect_string_format("%s %^s", cdetect_command_remote, execute_file);
+            (void)fflush(0);
+
+            cdetect_session_pid = (long)fork();
+            if (cdetect_session_pid == 0) {
+                /* Agent process */
+                (void)dup2(to_agent[0], 0);
+                (void)dup2(from_agent[1], 1);
+                (void)close(to_agent[0]);
+                (void)close(to_agent[1]);
+                (void)close(from_agent[0]);
+                (void)close(from_agent[1]);
+                (void)execl("/bin/sh", "sh", "-c", command->content, (char *)0);
+                _exit(127);
+            }
+            cdetect_string_destroy(command);
+
+            (void)close(to_agent[0]);
+            (void)close(from_agent[1]);
+            if (cdetect_session_pid > 0) {
+#if defined(SIGPIPE)
+                /* Report lost agent as write error */
+                if (cdetect_session_count++ == 0) {
+                    cdetect_session_sigpipe = signal(SIGPIPE, SIG_IGN);
+                    if (cdetect_session_sigpipe == SIG_ERR)
+                        cdetect_session_sigpipe = SIG_DFL;
+                }
+#endif
+                cdetect_session_input = to_agent[1];
+                cdetect_session_output = from_agent[0];
+            } else {
+                (void)close(to_agent[1]);
+                (void)close(from_agent[0]);
+            }
+        } else {
+            (void)close(to_agent[0]);
+            (void)close(to_agent[1]);
+        }
+    }
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(sourcecode);
+    cdetect_string_destroy(execute_file);
+    cdetect_string_destroy(source_file);
+
+    if (cdetect_session_input == -1) {
+        cdetect_log("Remote session not available\n");
+        return CDETECT_FALSE;
+    }
+    return CDETECT_TRUE;
+
+#else
+    return CDETECT_FALSE;
+#endif
+}
+
+/*
+ * Execute a command through the remote session
+ *
+ * The executable (first word of the command) is uploaded before execution.
+ */
+
+cdetect_bool_t
+cdetect_session_execute(cdetect_string_t command,
+                        cdetect_string_t *result)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    cdetect_string_t header;
+    cdetect_string_t full_command;
+    cdetect_string_t reply = 0;
+    int status = -1;
+
+    executable = cdetect_string_format("%^s", command);
+    remainder = cdetect_string_split(executable, ' ');
+
+    if (cdetect_session_upload(executable->content)) {
+        full_command = cdetect_string_format(cdetect_format_execute,
+                                             command->content,
+                                             cdetect_session_output_file);
+        header = cdetect_string_format("RUN");
+        if (cdetect_session_request(header, full_command, &status, &reply)) {
+            success = (status == 0) ? CDETECT_TRUE : CDETECT_FALSE;
+            *result = reply;
+        }
+        cdetect_string_destroy(header);
+        cdetect_string_destroy(full_command);
+    }
+
+    cdetect_string_destroy(remainder);
+    cdetect_string_destroy(executable);
+
+    return success;
+}
+
+/*
+ * Execute a command and return the status and the output
+ *
+ * If is_limited is set, the resource limits of executed programs are
+ * applied to local execution.
+ */
+
+cdetect_bool_t
+cdetect_execute_limited(cdetect_string_t command,
+                        cdetect_string_t *result,
+                        cdetect_bool_t is_remote,
+                        cdetect_bool_t is_limited)
+{
+    cdetect_bool_t success;
+    cdetect_string_t full_command;
+    cdetect_string_t redirection;
+
+    cdetect_log("cdetect_execute(command = %'#^s, result, is_remote = %d)\n",
+                command, (int)is_remote);
+    cdetect_trace_begin("process", is_remote ? "remote process" : "local process");
+
+    if (is_remote && (cdetect_file_exist(cdetect_command_remote) == CDETECT_FALSE)) {
+        success = CDETECT_FALSE;
+        cdetect_log("cdetect_execute(command = %'^s) failed\n", command);
+        cdetect_log("Remote execution not possible\n");
+
+    } else if (is_remote && cdetect_is_remote_session && cdetect_session_start()) {
+
+        success = cdetect_session_execute(command, result);
+        if (success == CDETECT_FALSE) {
+            cdetect_log("cdetect_execute(%'^s) failed\n", command);
+            cdetect_log(">>> OUTPUT BEGIN\n%s<<< OUTPUT END\n",
+                        (*result) ? (*result)->content : "");
+        }
+
+    } else {
+
+        redirection = cdetect_file_unique_name(cdetect_file_redirection);
+
+        if (is_remote) {
+            full_command = cdetect_string_format(cdetect_format_remote,
+                                                 cdetect_command_remote,
+                                                 command->content,
+                                                 redirection->content);
+        } else {
+            full_command = cdetect_string_format(cdetect_format_execute,
+                                                 command->content,
+                                                 redirection->content);
+        }
+
+        is_limited = (cdetect_bool_t)(is_limited && !is_remote && cdetect_process_is_limited());
+        if ((cdetect_timeout > 0) || is_limited) {
+            success = cdetect_system_process(full_command->content,
+                                             cdetect_timeout,
+                                             is_limited);
+        } else {
+            cdetect_is_timed_out = CDETECT_FALSE;
+            cdetect_is_limit_exceeded = CDETECT_FALSE;
+            success = cdetect_system(full_command->content);
+        }
+
+        (void)cdetect_file_read(redirection->content, result);
+
+        (void)cdetect_file_remove(redirection->content);
+        cdetect_string_destroy(redirection);
+        cdetect_string_destroy(full_command);
+
+        if (success == CDETECT_FALSE) {
+            cdetect_log("cdetect_execute(%'^s) failed\n", command);
+            cdetect_log(">>> OUTPUT BEGIN\n%s<<< OUTPUT END\n",
+                        (*result) ? (*result)->content : "");
+        }
+    }
+    cdetect_trace_end(success ? "\"success\":true" : "\"success\":false");
+    return success;
+}
+
+cdetect_bool_t
+cdetect_execute(cdetect_string_t command,
+                cdetect_string_t *result,
+                cdetect_bool_t is_remote)
+{
+    return cdetect_execute_limited(command, result, is_remote, CDETECT_FALSE);
+}
+
+cdetect_bool_t
+cdetect_execute_substitute(cdetect_string_t command,
+                           cdetect_string_t *result,
+                           cdetect_bool_t is_remote)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t real_command = 0;
+
+    if (cdetect_substitute_string(command, &real_command)) {
+
+        success = cdetect_execute(real_command, result, is_remote);
+    }
+
+    cdetect_string_destroy(real_command);
+
+    return success;
+}
+
+cdetect_bool_t cdetect_execute_bundle(cdetect_string_t,
+                                      cdetect_string_t,
+                                      cdetect_string_t *); /* Forward declaration */
+
+/*
+ * Compile a file and optionally execute the resulting program
+ */
+
+cdetect_bool_t
+cdetect_compile_file(cdetect_string_t source_file,
+                     cdetect_string_t execute_file,
+                     cdetect_string_t cflags,
+                     cdetect_string_t ldflags,
+                     cdetect_string_t arguments,
+                     int do_execute,
+                     int is_remote,
+                     cdetect_string_t *result)
+{
+    cdetect_bool_t success;
+    cdetect_string_t compile_command;
+    cdetect_string_t execute_command = 0;
+
+    assert(source_file != 0);
+    assert(execute_file != 0);
+    assert(result != 0);
+
+    if (cdetect_command_compile == 0) {
+        return CDETECT_FALSE;
+    }
+
+    (void)cdetect_file_remove(execute_file->content);
+
+    compile_command = cdetect_string_format(cdetect_format_compile,
+                                            cdetect_command_compile,
+                                            cdetect_argument_cflags,
+                                            cflags ? cflags->content : "",
+                                            source_file->content,
+                                            execute_file->content,
+                                            ldflags ? ldflags->content : "");
+
+    cdetect_trace_begin("compile", "compile");
+    success = cdetect_execute(compile_command, result, CDETECT_FALSE);
+    cdetect_trace_end(success ? "\"success\":true" : "\"success\":false");
+
+    if (success && do_execute) {
+        cdetect_string_destroy(*result);
+        *result = 0;
+
+        if (arguments) {
+            execute_command = cdetect_string_format("%^s %^s", execute_file, arguments);
+        } else {
+            execute_command = cdetect_string_format("%^s", execute_file);
+        }
+
+        cdetect_trace_begin("execute", "execute");
+        if (is_remote && (cdetect_execute_queue_size > 0)) {
+            /* Share the remote invocation with the queued programs */
+            success = cdetect_execute_bundle(execute_file, arguments, result);
+        } else {
+            success = cdetect_execute_limited(execute_command,
+                                              result,
+                                              (cdetect_bool_t)is_remote,
+                                              CDETECT_TRUE);
+        }
+        cdetect_trace_end(success ? "\"success\":true" : "\"success\":false");
+    }
+
+    if (execute_command) {
+        cdetect_string_destroy(execute_command);
+    }
+    cdetect_string_destroy(compile_command);
+
+    return success;
+}
+
+/*
+ * Calculate the key of a compilation in the compile map
+ *
+ * Two independent hash values over everything that affects the outcome
+ * make accidental collisions unlikely.
+ */
+
+cdetect_string_t
+cdetect_compile_key(cdetect_string_t sourcecode,
+                    cdetect_string_t cflags,
+                    cdetect_string_t ldflags,
+                    cdetect_string_t arguments,
+                    cdetect_bool_t do_execute,
+                    cdetect_bool_t is_remote)
+{
+    const char *data[8];
+    unsigned int first = 0;
+    unsigned int second = 0x9E3779B9U;
+    int count = 0;
+    int i;
+
+    data[count++] = sourcecode->content;
+    data[count++] = cflags ? cflags->content : "";
+    data[count++] = ldflags ? ldflags->content : "";
+    data[count++] = arguments ? arguments->content : "";
+    data[count++] = do_execute ? "execute" : "compile";
+    data[count++] = is_remote ? cdetect_command_remote : "local";
+    data[count++] = cdetect_command_compile;
+    data[count++] = cdetect_argument_cflags;
+
+    for (i = 0; i < count; ++i) {
+        first = cdetect_hash_string(data[i], first);
+    }
+    for (i = count - 1; i >= 0; --i) {
+        second = cdetect_hash_string(data[i], second);
+    }
+    return cdetect_string_format("%x.%x", first, second);
+}
+
+/*
+ * Write source code to file and compile
+ *
+ * The outcome is remembered, so that identical compilations are only done
+ * once per run.
+ */
+
+cdetect_bool_t
+cdetect_compile_source(cdetect_string_t sourcecode,
+                       cdetect_string_t cflags,
+                       cdetect_string_t ldflags,
+                       cdetect_string_t arguments,
+                       cdetect_bool_t do_execute,
+                       cdetect_bool_t is_remote,
+                       cdetect_string_t *result)
+{
+    cdetect_bool_t success;
+    cdetect_string_t execute_file;
+    cdetect_string_t source_file;
+    cdetect_string_t key;
+    cdetect_string_t value;
+    cdetect_map_element_t element;
+
+    cdetect_log(">>> SOURCE BEGIN\n%^s<<< SOURCE END\n", sourcecode);
+
+    cdetect_is_timed_out = CDETECT_FALSE;
+    cdetect_is_limit_exceeded = CDETECT_FALSE;
+    if (cdetect_command_compile == 0) {
+        return CDETECT_FALSE;
+    }
+
+    key = cdetect_compile_key(sourcecode, cflags, ldflags, arguments, do_execute, is_remote);
+    element = cdetect_map_lookup(cdetect_compile_map, key->content);
+    if (element && element->data) {
+        /* The first character is the status, followed by the output */
+        success = (cdetect_bool_t)(((const char *)element->data)[0] == '1');
+        *result = cdetect_string_format("%s", &((const char *)element->data)[1]);
+        cdetect_log("cdetect_compile_source() reused earlier outcome\n");
+        cdetect_string_destroy(key);
+        return success;
+    }
+
+    cdetect_profile_compile(sourcecode);
+
+    execute_file = cdetect_string_format("%s%s",
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    source_file = cdetect_string_format("%s%s",
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+
+    success = cdetect_file_overwrite(source_file->content, sourcecode);
+    if (success == CDETECT_FALSE) {
+        cdetect_log("Cannot write file %'^s\n",  source_file);
+    } else {
+        success = cdetect_compile_file(source_file,
+                                       execute_file,
+                                       cflags,
+                                       ldflags,
+                                       arguments,
+                                       do_execute,
+                                       is_remote,
+                                       result);
+        (void)cdetect_file_remove(execute_file->content);
+
+        if (!(cdetect_is_timed_out || cdetect_is_limit_exceeded)) {
+            /* Stopped commands are tried again */
+            value = cdetect_string_format("%c%s",
+                                          success ? '1' : '0',
+                                          (*result) ? (*result)->content : "");
+            (void)cdetect_map_remember(cdetect_compile_map, key->content, value->content);
+            cdetect_string_destroy(value);
+        }
+    }
+
+    (void)cdetect_file_remove(source_file->content);
+
+    cdetect_string_destroy(key);
+    cdetect_string_destroy(source_file);
+    cdetect_string_destroy(execute_file);
+
+    return success;
+}
+
+/**
+   Compile C/C++ source code.
+
+   @param source Source code buffer.
+   @param cflags Compilation flags.
+   @return Boolean indicating success or failure to compile.
+*/
+
+int
+config_compile_source(const char *source,
+                      const char *cflags)
+{
+    cdetect_bool_t success;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t result = 0;
+
+    cdetect_log("config_compile_source(source, cflags = %'s)\n", cflags);
+
+    /* FIXME: change cflags to comma-separated list of defines? */
+
+    sourcecode = cdetect_string_format("%s", source);
+    compile_flags = cdetect_string_format("%s", cflags);
+    link_flags = cdetect_string_format("");
+
+    success = cdetect_compile_source(sourcecode,
+                                     compile_flags,
+                                     link_flags,
+                                     0,
+                                     CDETECT_FALSE,
+                                     CDETECT_FALSE,
+                                     &result);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(sourcecode);
+
+    return (int)success;
+}
+
+int
+config_file_create(const char *filename, const char *message)
+{
+    cdetect_bool_t success;
+    cdetect_string_t content;
+
+    content = cdetect_string_format("%s", message);
+
+    success = cdetect_file_overwrite(filename, content);
+
+    cdetect_string_destroy(content);
+
+    return (int)success;
+}
+
+int
+config_file_remove(const char *filename)
+{
+    return (int)cdetect_file_remove(filename);
+}
+
+int
+config_file_exist_format(const char *format, ...)
+{
+    cdetect_bool_t success;
+    cdetect_string_t name;
+    va_list arguments;
+
+    cdetect_log("config_file_exist(format = %'s)\n", format);
+
+    va_start(arguments, format);
+    name = cdetect_string_vformat(format, arguments);
+    va_end(arguments);
+
+    success = cdetect_file_exist(name->content);
+
+    cdetect_string_destroy(name);
+
+    return (int)success;
+}
+
+/**
+   Compile a file containing C/C++ source code.
+
+   @param filename Name of file to be compiled.
+   @param cflags Compilation flags.
+   @return Boolean indicating success or failure to compile.
+*/
+
+int
+config_file_compile(const char *filename,
+                    const char *cflags)
+{
+    cdetect_bool_t success;
+    cdetect_string_t source_file;
+    cdetect_string_t execute_file;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t result = 0;
+
+    cdetect_log("config_file_compile(filename = %'s, cflags = %'s)\n",
+                filename, cflags);
+
+    source_file = cdetect_string_format("%s", filename);
+    execute_file = cdetect_string_format("%s%s",
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    compile_flags = cdetect_string_format("%s", cflags);
+    link_flags = cdetect_string_format("");
+
+    success = cdetect_compile_file(source_file,
+                                   execute_file,
+                                   compile_flags,
+                                   link_flags,
+                                   0,
+                                   CDETECT_FALSE,
+                                   CDETECT_FALSE,
+                                   &result);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(execute_file);
+    cdetect_string_destroy(source_file);
+
+    return (int)success;
+}
+
+/**
+   Compile and execute a file containing C/C++ source code.
+
+   @param source Source code buffer.
+   @param cflags Compilation flags.
+   @param args Arguments for the execution.
+   @return Boolean indicating success or failure to compile and execute.
+*/
+
+int
+config_execute_source(const char *source,
+                      const char *cflags,
+                      const char *args)
+{
+    cdetect_bool_t success;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t arguments;
+    cdetect_string_t result = 0;
+
+    cdetect_log("cdetect_execute_source(source, cflags = %'s, args = %'s)\n", cflags, args);
+
+    /* FIXME: change cflags to comma-separated list of defines? */
+
+    sourcecode = cdetect_string_format("%s", source);
+    compile_flags = cdetect_string_format("%s", cflags);
+    link_flags = cdetect_string_format("");
+    arguments = cdetect_string_format("%s", args);
+
+    success = cdetect_compile_source(sourcecode,
+                                     compile_flags,
+                                     link_flags,
+                                     args ? arguments : 0,
+                                     CDETECT_TRUE,
+                                     (cdetect_bool_t)(cdetect_command_remote != 0),
+                                     &result);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(arguments);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(sourcecode);
+
+    return success;
+}
+
+/**
+   Compile and execute C/C++ source code with a deadline.
+
+   @param source Source code buffer.
+   @param cflags Compilation flags.
+   @param args Arguments for the execution.
+   @param seconds Deadline of the compilation and the execution, or zero (0)
+   to use the registered deadline.
+   @return Boolean indicating success or failure to compile and execute.
+
+   @sa config_timeout_expired
+*/
+
+int
+config_execute_source_timeout(const char *source,
+                              const char *cflags,
+                              const char *args,
+                              unsigned int seconds)
+{
+    int success;
+    unsigned int previous;
+
+    previous = cdetect_timeout;
+    if (seconds > 0)
+        cdetect_timeout = seconds;
+    success = config_execute_source(source, cflags, args);
+    cdetect_timeout = previous;
+
+    return success;
+}
+
+/**
+   Check if the last compilation or execution was stopped by the deadline.
+
+   @return Boolean indicating whether the deadline expired.
+*/
+
+int
+config_timeout_expired(void)
+{
+    return (int)cdetect_is_timed_out;
+}
+
+/**
+   Execute a command.
+
+   @param command Name of command.
+   @return Boolean indicating success or failure to execute.
+*/
+/* FIXME: document %-specifiers (@ref formatting) and @VAR@ substitution (@ref varsub) */
+
+int
+config_execute_command(const char *command, ...)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t real_command;
+    cdetect_string_t result = 0;
+    va_list arguments;
+
+    cdetect_log("config_execute_command(command = %'#s, ...)\n", command);
+
+    va_start(arguments, command);
+    real_command = cdetect_string_vformat(command, arguments);
+    va_end(arguments);
+
+    success = cdetect_execute_substitute(real_command, &result, CDETECT_FALSE);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(real_command);
+
+    return success;
+}
+
+/*************************************************************************
+ *
+ * Queued Execution
+ *
+ ************************************************************************/
+
+/*
+ * Executable probes can be queued. With --remote, the queued programs are
+ * run in a single remote invocation by a runner program, which prints the
+ * output and exit status of each program between markers. Programs that
+ * are executed remotely while the queue is not empty join the invocation.
+ *
+ * The runner addresses the programs by relative path, so the remote side
+ * must see the same working directory (as with emulators or shared file
+ * systems), or a remote session must upload the programs. Otherwise each
+ * program is passed to the remote command on its own.
+ */
+
+#define CDETECT_EXECUTE_QUEUE_MAX 64
+
+/*
+ * Destroy queue entry
+ */
+
+void
+cdetect_execute_entry_destroy(cdetect_execute_entry_t self)
+{
+    if (self) {
+        (void)cdetect_file_remove(self->execute_file->content);
+        cdetect_string_destroy(self->arguments);
+        cdetect_string_destroy(self->execute_file);
+        cdetect_free(self);
+    }
+}
+
+/*
+ * Deliver result to the owner of a queue entry
+ */
+
+void
+cdetect_execute_entry_finish(cdetect_execute_entry_t self,
+                             cdetect_bool_t success,
+                             cdetect_string_t output)
+{
+    if (self->callback) {
+        self->callback(self->closure,
+                       (int)success,
+                       (output && output->content) ? output->content : "");
+    }
+    cdetect_execute_entry_destroy(self);
+}
+
+/*
+ * Does the remote side see the working directory
+ *
+ * A program that prints a marker file is executed remotely. The answer is
+ * remembered for the rest of the run.
+ */
+
+cdetect_bool_t
+cdetect_execute_remote_is_shared(void)
+{
+    cdetect_string_t marker_file;
+    cdetect_string_t source_file;
+    cdetect_string_t execute_file;
+    cdetect_string_t sourcecode;
+    cdetect_string_t token;
+    cdetect_string_t result = 0;
+    size_t i;
+
+    if (cdetect_is_remote_shared_checked)
+        return cdetect_is_remote_shared;
+    cdetect_is_remote_shared_checked = CDETECT_TRUE;
+    cdetect_is_remote_shared = CDETECT_FALSE;
+
+    marker_file = cdetect_string_format("%sm.txt", /* Name purposely mangled */
+                                        cdetect_file_execute);
+    source_file = cdetect_string_format("%sm%s",
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+    execute_file = cdetect_string_format("%sm%s",
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    token = cdetect_string_format("cdetect marker %lx", (unsigned long)time(0));
+
+    sourcecode = cdetect_string_format("#include <stdio.h>\nint main(void) {\n  int c; FILE *file = fopen(\"");
+    for (i = 0; i < marker_file->length; ++i) {
+        (void)cdetect_string_append_quoted_char(sourcecode, marker_file->content[i]);
+    }
+    (void)cdetect_string_append(sourcecode,
+                                "\", \"r\");\n"
+                                "  if (file == 0) return 1;\n"
+                                "  while ((c = fgetc(file)) != EOF) putchar(c);\n"
+                                "  fclose(file);\n"
+                                "  return 0;\n"
+                                "}\n");
+
+    if (cdetect_file_overwrite(marker_file->content, token) &&
+        cdetect_file_overwrite(source_file->content, sourcecode) &&
+        cdetect_compile_file(source_file,
+                             execute_file,
+                             0,
+                             0,
+                             0,
+                             CDETECT_TRUE,
+                             CDETECT_TRUE,
+                             &result) &&
+        result && result->content &&
+        strstr(result->content, token->content)) {
+        cdetect_is_remote_shared = CDETECT_TRUE;
+    }
+    cdetect_log("cdetect_execute_remote_is_shared() = %d\n", (int)cdetect_is_remote_shared);
+
+    (void)cdetect_file_remove(execute_file->content);
+    (void)cdetect_file_remove(source_file->content);
+    (void)cdetect_file_remove(marker_file->content);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(sourcecode);
+    cdetect_string_destroy(token);
+    cdetect_string_destroy(execute_file);
+    cdetect_string_destroy(source_file);
+    cdetect_string_destroy(marker_file);
+
+    return cdetect_is_remote_shared;
+}
+
+/*
+ * Create source code of runner program for all queued entries
+ */
+
+cdetect_string_t
+cdetect_execute_runner_source(const char *output_file)
+{
+    cdetect_string_t sourcecode;
+    cdetect_string_t command;
+    cdetect_list_t current;
+    cdetect_execute_entry_t entry;
+    size_t i;
+
+    sourcecode = cdetect_string_format("#include <stdio.h>\n#include <stdlib.h>\nstatic const char *commands[] = {\n");
+
+    for (current = cdetect_list_front(cdetect_execute_queue);
+         current;
+         current = cdetect_list_next(current)) {
+        entry = (cdetect_execute_entry_t)current->data;
+        if (entry->arguments) {
+            command = cdetect_string_format("%^s %^s", entry->execute_file, entry->arguments);
+        } else {
+            command = cdetect_string_format("%^s", entry->execute_file);
+        }
+        (void)cdetect_string_append_char(sourcecode, '"');
+        for (i = 0; i < command->length; ++i) {
+            (void)cdetect_string_append_quoted_char(sourcecode, command->content[i]);
+        }
+        (void)cdetect_string_append(sourcecode, " >");
+        (void)cdetect_string_append(sourcecode, output_file);
+        (void)cdetect_string_append(sourcecode, " 2>&1\",\n");
+        cdetect_string_destroy(command);
+    }
+
+    (void)cdetect_string_append(sourcecode, "0 };\n");
+    (void)cdetect_string_append(sourcecode,
+                                "int main(void) {\n"
+                                "  int i; int c; int status; FILE *file;\n"
+                                "  for (i = 0; commands[i] != 0; ++i) {\n"
+                                "    fflush(stdout);\n"
+                                "    status = system(commands[i]);\n"
+                                "    printf(\"### cdetect begin %d\\n\", i);\n");
+    (void)cdetect_string_append(sourcecode, "    file = fopen(\"");
+    (void)cdetect_string_append(sourcecode, output_file);
+    (void)cdetect_string_append(sourcecode,
+                                "\", \"r\");\n"
+                                "    if (file != 0) {\n"
+                                "      while ((c = fgetc(file)) != EOF) putchar(c);\n"
+                                "      fclose(file);\n");
+    (void)cdetect_string_append(sourcecode, "      remove(\"");
+    (void)cdetect_string_append(sourcecode, output_file);
+    (void)cdetect_string_append(sourcecode,
+                                "\");\n"
+                                "    }\n"
+                                "    printf(\"\\n### cdetect end %d %d\\n\", i, status);\n"
+                                "  }\n"
+                                "  return 0;\n"
+                                "}\n");
+    return sourcecode;
+}
+
+/*
+ * Extract output and status of a single entry from runner output
+ */
+
+cdetect_bool_t
+cdetect_execute_runner_result(cdetect_string_t result,
+                              int index,
+                              cdetect_string_t *output)
+{
+    cdetect_string_t begin_marker;
+    cdetect_string_t end_marker;
+    const char *begin;
+    const char *end;
+    int status = -1;
+
+    *output = 0;
+    if ((result == 0) || (result->content == 0))
+        return CDETECT_FALSE;
+
+    begin_marker = cdetect_string_format("### cdetect begin %d\n", index);
+    end_marker = cdetect_string_format("\n### cdetect end %d ", index);
+
+    begin = strstr(result->content, begin_marker->content);
+    if (begin) {
+        begin += begin_marker->length;
+        end = strstr(begin, end_marker->content);
+        if (end) {
+            *output = cdetect_string_create();
+            (void)cdetect_string_append_range(*output, begin, 0, (size_t)(end - begin));
+            (void)cdetect_string_append(*output, "");
+            status = atoi(end + end_marker->length);
+        }
+    }
+
+    cdetect_string_destroy(end_marker);
+    cdetect_string_destroy(begin_marker);
+
+    return (status == 0) ? CDETECT_TRUE : CDETECT_FALSE;
+}
+
+/*
+ * Run all queued entries in one remote invocation
+ */
+
+cdetect_bool_t
+cdetect_execute_flush(void)
+{
+    cdetect_bool_t success;
+    cdetect_bool_t entry_success;
+    cdetect_string_t source_file;
+    cdetect_string_t execute_file;
+    cdetect_string_t output_file;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t result = 0;
+    cdetect_string_t output;
+    cdetect_string_t command;
+    cdetect_list_t current;
+    cdetect_execute_entry_t entry;
+    cdetect_bool_t is_bundled;
+    int index;
+
+    if ((cdetect_execute_queue == 0) || cdetect_list_empty(cdetect_execute_queue))
+        return CDETECT_TRUE;
+
+    cdetect_log("cdetect_execute_flush()\n");
+    cdetect_execute_queue_size = 0;
+
+    source_file = cdetect_string_format("%sr%s", /* Name purposely mangled */
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+    execute_file = cdetect_string_format("%sr%s",
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    output_file = cdetect_string_format("%so.txt", /* Name purposely mangled */
+                                        cdetect_file_execute);
+    sourcecode = cdetect_execute_runner_source(output_file->content);
+    compile_flags = cdetect_string_format("");
+    link_flags = cdetect_string_format("");
+
+    /* The runner does not upload the programs itself */
+    if (cdetect_is_remote_session && cdetect_session_start()) {
+        for (current = cdetect_list_front(cdetect_execute_queue);
+             current;
+             current = cdetect_list_next(current)) {
+            entry = (cdetect_execute_entry_t)current->data;
+            (void)cdetect_session_upload(entry->execute_file->content);
+        }
+        is_bundled = CDETECT_TRUE;
+    } else {
+        is_bundled = cdetect_execute_remote_is_shared();
+    }
+
+    if (is_bundled) {
+        success = cdetect_file_overwrite(source_file->content, sourcecode);
+        if (success) {
+            success = cdetect_compile_file(source_file,
+                                           execute_file,
+                                           compile_flags,
+                                           link_flags,
+                                           0,
+                                           CDETECT_TRUE,
+                                           CDETECT_TRUE,
+                                           &result);
+            (void)cdetect_file_remove(execute_file->content);
+        }
+        (void)cdetect_file_remove(source_file->content);
+
+    } else {
+        /* Each program must be passed to the remote command */
+        for (current = cdetect_list_front(cdetect_execute_queue);
+             current;
+             current = cdetect_list_next(current)) {
+            entry = (cdetect_execute_entry_t)current->data;
+            if (entry->arguments) {
+                command = cdetect_string_format("%^s %^s", entry->execute_file, entry->arguments);
+            } else {
+                command = cdetect_string_format("%^s", entry->execute_file);
+            }
+            output = 0;
+            entry_success = cdetect_execute_limited(command, &output, CDETECT_TRUE, CDETECT_TRUE);
+            cdetect_execute_entry_finish(entry, entry_success, output);
+            cdetect_string_destroy(output);
+            cdetect_string_destroy(command);
+        }
+        cdetect_list_clear(cdetect_execute_queue);
+        success = CDETECT_TRUE;
+    }
+
+    /* Scatter results */
+    index = 0;
+    for (current = cdetect_list_front(cdetect_execute_queue);
+         current;
+         current = cdetect_list_next(current)) {
+        entry = (cdetect_execute_entry_t)current->data;
+        output = 0;
+        entry_success = success
+            ? cdetect_execute_runner_result(result, index, &output)
+            : CDETECT_FALSE;
+        cdetect_execute_entry_finish(entry, entry_success, output);
+        cdetect_string_destroy(output);
+        ++index;
+    }
+    cdetect_list_clear(cdetect_execute_queue);
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(sourcecode);
+    cdetect_string_destroy(output_file);
+    cdetect_string_destroy(execute_file);
+    cdetect_string_destroy(source_file);
+
+    return success;
+}
+
+/*
+ * Receive the result of a program executed together with the queue
+ */
+
+void
+cdetect_execute_capture(void *closure,
+                        int success,
+                        const char *output)
+{
+    cdetect_execute_capture_t capture = (cdetect_execute_capture_t)closure;
+
+    capture->success = (cdetect_bool_t)success;
+    capture->output = cdetect_string_format("%s", output);
+}
+
+/*
+ * Execute a compiled program remotely together with the queued programs
+ *
+ * The program is removed afterwards, like the queued programs.
+ */
+
+cdetect_bool_t
+cdetect_execute_bundle(cdetect_string_t execute_file,
+                       cdetect_string_t arguments,
+                       cdetect_string_t *result)
+{
+    cdetect_execute_entry_t entry;
+    struct cdetect_execute_capture capture;
+
+    cdetect_log("cdetect_execute_bundle(%'^s)\n", execute_file);
+
+    capture.success = CDETECT_FALSE;
+    capture.output = 0;
+
+    entry = (cdetect_execute_entry_t)cdetect_allocate(sizeof(*entry));
+    entry->execute_file = cdetect_string_format("%^s", execute_file);
+    entry->arguments = arguments ? cdetect_string_format("%^s", arguments) : 0;
+    entry->callback = cdetect_execute_capture;
+    entry->closure = &capture;
+    cdetect_list_append(cdetect_execute_queue, entry);
+
+    (void)cdetect_execute_flush();
+
+    *result = capture.output;
+    return capture.success;
+}
+
+/*
+ * Compile source code and queue the program for execution
+ */
+
+cdetect_bool_t
+cdetect_execute_source_queue(cdetect_string_t sourcecode,
+                             cdetect_string_t cflags,
+                             cdetect_string_t arguments,
+                             config_execute_callback_t callback,
+                             void *closure)
+{
+    cdetect_bool_t success;
+    cdetect_execute_entry_t entry;
+    cdetect_string_t source_file;
+    cdetect_string_t link_flags;
+    cdetect_string_t command;
+    cdetect_string_t result = 0;
+
+    cdetect_log(">>> SOURCE BEGIN\n%^s<<< SOURCE END\n", sourcecode);
+    cdetect_profile_compile(sourcecode);
+
+    entry = (cdetect_execute_entry_t)cdetect_allocate(sizeof(*entry));
+    entry->execute_file = cdetect_string_format("%sq%x%s", /* Name purposely mangled */
+                                                cdetect_file_execute,
+                                                (unsigned int)cdetect_execute_queue_count++,
+                                                cdetect_suffix_execute);
+    entry->arguments = arguments ? cdetect_string_format("%^s", arguments) : 0;
+    entry->callback = callback;
+    entry->closure = closure;
+
+    source_file = cdetect_string_format("%sq%s",
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+    link_flags = cdetect_string_format("");
+
+    success = cdetect_file_overwrite(source_file->content, sourcecode);
+    if (success) {
+        success = cdetect_compile_file(source_file,
+                                       entry->execute_file,
+                                       cflags,
+                                       link_flags,
+                                       0,
+                                       CDETECT_FALSE,
+                                       CDETECT_FALSE,
+                                       &result);
+    }
+    (void)cdetect_file_remove(source_file->content);
+
+    if (!success) {
+        cdetect_execute_entry_finish(entry, CDETECT_FALSE, 0);
+
+    } else if (cdetect_command_remote == 0) {
+        /* Nothing to gain from queueing local execution */
+        cdetect_string_destroy(result);
+        result = 0;
+        if (entry->arguments) {
+            command = cdetect_string_format("%^s %^s", entry->execute_file, entry->arguments);
+        } else {
+            command = cdetect_string_format("%^s", entry->execute_file);
+        }
+        success = cdetect_execute_limited(command, &result, CDETECT_FALSE, CDETECT_TRUE);
+        cdetect_execute_entry_finish(entry, success, result);
+        success = CDETECT_TRUE;
+        cdetect_string_destroy(command);
+
+    } else {
+        cdetect_list_append(cdetect_execute_queue, entry);
+        if (++cdetect_execute_queue_size >= CDETECT_EXECUTE_QUEUE_MAX) {
+            (void)cdetect_execute_flush();
+        }
+    }
+
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(source_file);
+
+    return success;
+}
+
+/**
+   Compile C/C++ source code and queue the program for execution.
+
+   With @c --remote the queued programs are executed together, using a single
+   remote invocation, when config_execute_flush is called (or when the queue
+   is full.) Otherwise the program is executed immediately.
+
+   @code
+   void check_endian(void *closure, int success, const char *output)
+   {
+       if (success)
+           config_macro_define("CONFIG_BYTE_ORDER", output);
+   }
+
+   config_execute_source_queue(source, "", 0, check_endian, 0);
+   config_execute_flush();
+   @endcode
+
+   @param source Source code buffer.
+   @param cflags Compilation flags.
+   @param args Arguments passed to the program. Can be zero (0).
+   @param callback Function that receives the closure, a boolean indicating
+   whether the program executed successfully, and the output of the program.
+   @param closure User-defined data passed to @p callback.
+   @return Boolean indicating whether the source code was compiled. The
+   callback is invoked in either case.
+
+   @sa config_execute_flush
+*/
+
+int
+config_execute_source_queue(const char *source,
+                            const char *cflags,
+                            const char *args,
+                            config_execute_callback_t callback,
+                            void *closure)
+{
+    cdetect_bool_t success;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t arguments;
+
+    cdetect_log("config_execute_source_queue(source, cflags = %'s, args = %'s)\n", cflags, args);
+
+    sourcecode = cdetect_string_format("%s", source);
+    compile_flags = cdetect_string_format("%s", cflags);
+    arguments = args ? cdetect_string_format("%s", args) : 0;
+
+    success = cdetect_execute_source_queue(sourcecode,
+                                           compile_flags,
+                                           arguments,
+                                           callback,
+                                           closure);
+
+    cdetect_string_destroy(arguments);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(sourcecode);
+
+    return success;
+}
+
+/**
+   Execute all queued programs.
+
+   @return Boolean indicating whether the programs could be executed.
+
+   @sa config_execute_source_queue
+*/
+
+int
+config_execute_flush(void)
+{
+    cdetect_log("config_execute_flush()\n");
+
+    return cdetect_execute_flush();
+}
+
+/*************************************************************************
+ *
+ * Define Macros
+ *
+ ************************************************************************/
+
+/*
+ * Define a generic macro
+ */
+
+void
+cdetect_macro_define(const char *macro,
+                     const char *value)
+{
+    assert(macro != 0);
+    assert(value != 0);
+
+    (void)cdetect_map_remember_context(cdetect_macro_map, 0, macro, value);
+}
+
+/* FIXME: Documentation */
+
+int
+config_macro_define(const char *macro,
+                    const char *value)
+{
+    cdetect_log("config_macro_define(macro = %'s, value = %'s)\n",
+                macro, value);
+
+    cdetect_macro_define(macro, value);
+
+    return (int)CDETECT_TRUE;
+}
+
+/* FIXME: Documentation */
+
+int
+config_macro_define_format(const char *macro,
+                           const char *format, ...)
+{
+    cdetect_string_t value;
+    va_list arguments;
+
+    cdetect_log("config_macro_define_format(macro = %'s, ...)\n",
+                macro);
+
+    va_start(arguments, format);
+    value = cdetect_string_vformat(format, arguments);
+    va_end(arguments);
+    cdetect_macro_define(macro, value->content);
+
+    cdetect_string_destroy(value);
+
+    return (int)CDETECT_TRUE;
+}
+
+/*
+ * Convert string into valid macro
+ */
+
+cdetect_string_t
+cdetect_macro_transform_upper(cdetect_string_t macro)
+{
+    return cdetect_string_transform_upper(macro->content);
+}
+
+/*
+ * Save macro
+ */
+
+void
+cdetect_macro_save(const char *format,
+                   const char *variable,
+                   const char *value,
+                   cdetect_macro_transform_t transform)
+{
+    cdetect_string_t data;
+    cdetect_string_t raw_macro;
+    cdetect_string_t macro;
+    size_t offset;
+
+    data = cdetect_string_format("%s", variable);
+    offset = cdetect_string_find_char(data, 0, cdetect_map_context_separator);
+    offset = (offset == data->length) ? 0 : offset + 1;
+
+    raw_macro = cdetect_string_format(format, &data->content[offset]);
+    if (transform) {
+        macro = transform(raw_macro);
+        cdetect_string_destroy(raw_macro);
+    } else {
+        macro = raw_macro;
+    }
+
+    cdetect_file_write_after(cdetect_include_file,
+                             "#define %s %s\n",
+                             macro->content, value);
+
+    cdetect_string_destroy(macro);
+    cdetect_string_destroy(data);
+}
+
+/*
+ * Save macro with number
+ */
+
+void
+cdetect_macro_save_number(const char *format,
+                          const char *variable,
+                          unsigned int number)
+{
+    cdetect_string_t value;
+
+    if (variable) {
+        value = cdetect_string_format("0x%x", number);
+        cdetect_macro_save(format, variable, value->content, cdetect_macro_transform_upper);
+        cdetect_string_destroy(value);
+    }
+}
+
+/*
+ * Save all macros in list
+ */
+
+void
+cdetect_macro_save_map(cdetect_map_t map,
+                       const char *format,
+                       cdetect_macro_filter_t filter,
+                       cdetect_macro_transform_t transform)
+{
+    cdetect_map_element_t element;
+    cdetect_list_t current;
+
+    for (current = cdetect_list_front(map->first);
+         current != 0;
+         current = cdetect_list_next(current)) {
+
+        element = (cdetect_map_element_t)current->data;
+        if (element) {
+            if ((filter == 0) || filter(element->key, (const char *)element->data)) {
+                cdetect_macro_save(format, element->key, (const char *)element->data, transform);
+            }
+        }
+    }
+}
+
+/*
+ * Filter macros with zero value
+ */
+
+cdetect_bool_t
+cdetect_macro_filter_false(const char *key,
+                           const char *value)
+{
+    assert(value != 0);
+    (void)key;
+
+    if (cdetect_strequal(value, "0"))
+        return CDETECT_FALSE;
+    return CDETECT_TRUE;
+}
+
+/*************************************************************************
+ *
+ * Detect Libraries
+ *
+ ************************************************************************/
+
+/*
+ * Define a library macro
+ */
+
+void
+cdetect_library_define(const char *library,
+                       cdetect_report_t found)
+{
+    (void)cdetect_map_remember(cdetect_library_map,
+                               library,
+                               (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    cdetect_timeout_remember(cdetect_cache_identifier_library, library, found);
+}
+
+int
+config_library_register_format(const char *format)
+{
+    cdetect_string_destroy(cdetect_library_format);
+    cdetect_library_format = cdetect_string_format("%s", format);
+    return (cdetect_library_format != 0);
+}
+
+/*************************************************************************
+ *
+ * Detect Functions
+ *
+ ************************************************************************/
+
+/*
+ * Define a function macro
+ */
+
+void
+cdetect_function_define(const char *function,
+                        const char *library,
+                        cdetect_report_t found)
+{
+    cdetect_map_element_t element;
+
+    assert(function != 0);
+
+    element = cdetect_map_remember_context(cdetect_function_map,
+                                           library,
+                                           function,
+                                           (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    cdetect_timeout_remember(cdetect_cache_identifier_function, element->key, found);
+}
+
+/* FIXME: Documentation */
+
+void
+config_function_define(const char *function,
+                       const char *library,
+                       int found)
+{
+    cdetect_function_define(function, library, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+}
+
+/*
+ * Check if a function exists
+ */
+
+cdetect_report_t
+cdetect_function_check_cache(const char *function,
+                             const char *library)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_map_element_t element;
+
+    element = cdetect_map_lookup_context(cdetect_function_map, library, function);
+    if (element && element->data) {
+        if (cdetect_strequal((const char *)element->data, "1")) {
+            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
+        } else {
+            report = CDETECT_REPORT_CACHED;
+        }
+    }
+
+    return report;
+}
+
+cdetect_report_t
+cdetect_function_check_library(const char *function,
+                               const char *library)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_string_t library_name;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t result = 0;
+
+    assert((library == 0) || (library[0] != 0)); /* Disallow the empty string */
+
+    report = cdetect_function_check_cache(function, library);
+    if (!(report & CDETECT_REPORT_CACHED)) {
+
+        /* FIXME: Is both library_name and link_flags necessary? */
+        if ((library == 0) || (library[0] == 0)) {
+            library_name = cdetect_string_format("");
+        } else {
+            library_name = cdetect_string_format(cdetect_format_library, library);
+        }
+
+        sourcecode = cdetect_string_format("#ifdef __cplusplus\nextern \"C\"\n#endif\nchar %s();\nint main(void) {%s(); return 0;}\n",
+                                           function, function);
+
+        compile_flags = cdetect_string_format("");
+        link_flags = cdetect_string_format("%^s", library_name);
+
+        report = (cdetect_compile_source(sourcecode,
+                                         compile_flags,
+                                         link_flags,
+                                         0,
+                                         CDETECT_FALSE,
+                                         CDETECT_FALSE,
+                                         &result))
+            ? CDETECT_REPORT_FOUND
+            : (cdetect_is_timed_out ? CDETECT_REPORT_TIMEOUT : CDETECT_REPORT_NULL);
+
+        cdetect_string_destroy(result);
+        cdetect_string_destroy(link_flags);
+        cdetect_string_destroy(compile_flags);
+        cdetect_string_destroy(sourcecode);
+        cdetect_string_destroy(library_name);
+    }
+    return report;
+}
+
+/**
+   Check for the existence of a given function in a given library.
+
+   @param function The function to be examined.
+   @param library Name of library in which the function resides.
+   @return True (non-zero) if the function was found, false (zero) otherwise.
+*/
+
+int
+config_function_check_library(const char *function,
+                              const char *library)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_string_t message;
+
+    cdetect_log("config_function_check_library(function = %'s, library = %'s)\n",
+                function, library);
+
+    if (function) {
+
+        if ((library) && (library[0] == 0))
+            library = 0;
+
+        message = cdetect_string_format( (library == 0) ? "%s()" : "%s() in library %s",
+                                         function,
+                                         library);
+
+        report = cdetect_function_check_library(function, library);
+        cdetect_report_bool(message->content, report);
+        cdetect_function_define(function, library, report);
+        if (library) {
+            /* If the function was found in a library, define this library as well */
+            cdetect_library_define(library, report);
+        }
+
+        cdetect_string_destroy(message);
+    }
+    return (report & CDETECT_REPORT_FOUND);
+}
+
+/* FIXME: Documentation */
+
+int
+config_function_check(const char *function)
+{
+    return config_function_check_library(function, 0);
+}
+
+int
+config_function_register_format(const char *format)
+{
+    cdetect_string_destroy(cdetect_function_format);
+    cdetect_function_format = cdetect_string_format("%s", format);
+    return (cdetect_function_format != 0);
+}
+
+/*************************************************************************
+ *
+ * Speculative Probes
+ *
+ ************************************************************************/
+
+/*
+ * Split a comma-separated list of candidates
+ *
+ * Empty candidates are only kept if keep_empty is set.
+ */
+
+cdetect_string_t *
+cdetect_probe_candidates(const char *list,
+                         cdetect_bool_t keep_empty,
+                         int *count)
+{
+    cdetect_string_t *result;
+    cdetect_string_t current;
+    cdetect_string_t rest;
+    int size = 1;
+    int i;
+
+    assert(list != 0);
+    assert(count != 0);
+
+    for (i = 0; list[i] != 0; ++i) {
+        if (list[i] == cdetect_header_separator)
+            ++size;
+    }
+    result = (cdetect_string_t *)cdetect_allocate(size * sizeof(result[0]));
+
+    *count = 0;
+    current = cdetect_string_format("%s", list);
+    while (current) {
+        rest = cdetect_string_split(current, cdetect_header_separator);
+        if (keep_empty || (current->length > 0)) {
+            result[(*count)++] = current;
+        } else {
+            cdetect_string_destroy(current);
+        }
+        current = rest;
+    }
+    return result;
+}
+
+/*
+ * Destroy a list of candidates
+ */
+
+void
+cdetect_probe_candidates_destroy(cdetect_string_t *candidates,
+                                 int count)
+{
+    int i;
+
+    for (i = 0; i < count; ++i) {
+        cdetect_string_destroy(candidates[i]);
+    }
+    cdetect_free(candidates);
+}
+
+/*
+ * Write the header locations found by a child process to the channel
+ *
+ * One line per header, with the location escaped.
+ */
+
+void
+cdetect_probe_locations_write(int channel)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t value;
+    cdetect_string_t line;
+
+    for (position = cdetect_list_front(cdetect_header_location_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && element->data) {
+            value = cdetect_string_escape((const char *)element->data,
+                                          '\n',
+                                          cdetect_cache_escape);
+            line = cdetect_string_format("%s%c%^s\n", element->key, cdetect_cache_separator, value);
+            (void)write(channel, line->content, line->length);
+            cdetect_string_destroy(line);
+            cdetect_string_destroy(value);
+        }
+    }
+#else
+    (void)channel;
+#endif
+}
+
+/*
+ * Remember the header locations written by a child process
+ */
+
+void
+cdetect_probe_locations_read(cdetect_string_t input)
+{
+    cdetect_string_t rest;
+    cdetect_string_t escaped_value;
+    cdetect_string_t value;
+
+    input = (input && input->content) ? cdetect_string_format("%^s", input) : 0;
+    while (input) {
+        rest = cdetect_string_split(input, '\n');
+        escaped_value = cdetect_string_split(input, cdetect_cache_separator);
+        if (escaped_value) {
+            value = cdetect_string_unescape(escaped_value->content,
+                                            cdetect_cache_escape);
+            (void)cdetect_map_remember(cdetect_header_location_map, input->content, value->content);
+            cdetect_string_destroy(value);
+            cdetect_string_destroy(escaped_value);
+            /* Directories are collected again when needed */
+            cdetect_map_destroy(cdetect_header_directory_map);
+            cdetect_header_directory_map = 0;
+        }
+        cdetect_string_destroy(input);
+        input = rest;
+    }
+}
+
+/*
+ * Check candidates in order until one is found
+ *
+ * Candidates that are not cached are probed concurrently by child
+ * processes, each with its own temporary and output files. The results are collected
+ * in order, and the remaining children are stopped once a candidate has
+ * been found, so reports holds exactly what checking the candidates one
+ * after another would have produced. Returns the number of candidates
+ * that the serial checks would have visited.
+ */
+
+int
+cdetect_probe_first_of(cdetect_probe_check_t cache,
+                       cdetect_probe_check_t check,
+                       const char *argument,
+                       cdetect_string_t *candidates,
+                       int count,
+                       cdetect_report_t *reports)
+{
+    int decided = count;
+    int current;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_string_t output;
+    cdetect_string_t name;
+    cdetect_report_t report;
+    long *process;
+    int *channel;
+    int pending = 0;
+    int status;
+
+    process = (long *)cdetect_allocate((count + 1) * sizeof(*process));
+    channel = (int *)cdetect_allocate((count + 1) * sizeof(*channel));
+
+    for (current = 0; current < count; ++current) {
+        process[current] = -1;
+        reports[current] = cache(argument, candidates[current]->content);
+    }
+    /* Only probe candidates that may be visited */
+    for (current = 0; current < count; ++current) {
+        if ((reports[current] & CDETECT_REPORT_FOUND))
+            break;
+        if (!(reports[current] & CDETECT_REPORT_CACHED))
+            ++pending;
+    }
+
+    for (current = 0; (pending > 1) && (current < count); ++current) {
+        if ((reports[current] & CDETECT_REPORT_FOUND))
+            break;
+        if ((reports[current] & CDETECT_REPORT_CACHED))
+            continue;
+        process[current] = cdetect_process_fork(&channel[current]);
+        if (process[current] == 0) {
+            /* Child process */
+            name = cdetect_string_format("%sp%d", cdetect_file_execute, current);
+            cdetect_file_execute = name->content;
+            name = cdetect_string_format("%^s.txt", name);
+            cdetect_file_redirection = name->content;
+            /* Only the locations found by this check are sent back */
+            cdetect_map_destroy(cdetect_header_location_map);
+            cdetect_header_location_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                                             (cdetect_map_destroy_t)cdetect_free);
+            report = check(argument, candidates[current]->content);
+            if ((report & CDETECT_REPORT_FOUND))
+                cdetect_probe_locations_write(channel[current]);
+            cdetect_process_exit(channel[current],
+                                 (report & CDETECT_REPORT_FOUND)
+                                 ? 0
+                                 : ((report & CDETECT_REPORT_TIMEOUT) ? 2 : 1));
+        }
+    }
+
+    decided = 0;
+    for (current = 0; current < count; ++current) {
+        if (process[current] > 0) {
+            if (decided > 0) {
+                /* An earlier candidate was found */
+                (void)close(channel[current]);
+                cdetect_process_kill(process[current]);
+            } else {
+                output = cdetect_process_read(channel[current]);
+                status = cdetect_process_wait(process[current]);
+                if (status == 0) {
+                    cdetect_probe_locations_read(output);
+                }
+                cdetect_string_destroy(output);
+                if (status == 0) {
+                    reports[current] = CDETECT_REPORT_FOUND;
+                } else if (status == 1) {
+                    reports[current] = CDETECT_REPORT_NULL;
+                } else if (status == 2) {
+                    reports[current] = CDETECT_REPORT_TIMEOUT;
+                } else {
+                    /* The child failed, so check it here */
+                    reports[current] = check(argument, candidates[current]->content);
+                }
+            }
+            /* Remove what a stopped child may have left behind */
+            name = cdetect_string_format("%sp%d%s", cdetect_file_execute, current, cdetect_suffix_source);
+            (void)cdetect_file_remove(name->content);
+            cdetect_string_destroy(name);
+            name = cdetect_string_format("%sp%d%s", cdetect_file_execute, current, cdetect_suffix_execute);
+            (void)cdetect_file_remove(name->content);
+            cdetect_string_destroy(name);
+            name = cdetect_string_format("%sp%d0.txt", cdetect_file_execute, current);
+            (void)cdetect_file_remove(name->content);
+            cdetect_string_destroy(name);
+
+        } else if ((decided == 0) && !(reports[current] & CDETECT_REPORT_CACHED)) {
+            /* Not forked, so check it here */
+            reports[current] = check(argument, candidates[current]->content);
+        }
+        if ((decided == 0) && (reports[current] & CDETECT_REPORT_FOUND)) {
+            decided = current + 1;
+        }
+    }
+    if (decided == 0)
+        decided = count;
+
+    cdetect_free(channel);
+    cdetect_free(process);
+#else
+    (void)cache;
+    for (current = 0; current < count; ++current) {
+        reports[current] = check(argument, candidates[current]->content);
+        if ((reports[current] & CDETECT_REPORT_FOUND)) {
+            decided = current + 1;
+            break;
+        }
+    }
+#endif
+    return decided;
+}
+
+/*************************************************************************
+ *
+ * Detect Headers
+ *
+ ************************************************************************/
+
+/*
+ * Define a header macro
+ */
+
+void
+cdetect_header_define(const char *header,
+                      cdetect_report_t found)
+{
+    (void)cdetect_map_remember(cdetect_header_map,
+                               header,
+                               (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    cdetect_timeout_remember(cdetect_cache_identifier_header, header, found);
+}
+
+/* FIXME: Documentation */
+
+void
+config_header_define(const char *header,
+                     int found)
+{
+    cdetect_header_define(header, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+}
 
-    cdetect_log(">>> SOURCE BEGIN\n%^s<<< SOURCE END\n", sourcecode);
+/*
+ * Find the path of a header in the list of included files
+ *
+ * The list is printed by the compiler with cdetect_format_includes, one
+ * file per line, either as ". path" (with one dot per nesting level) or
+ * as "Note: including file: path". The least nested match is used, so
+ * that headers with the same name in sub-directories are skipped.
+ * Returns the null pointer (0) if the header is not listed.
+ */
 
-    execute_file = cdetect_string_format("%s%s",
-                                         cdetect_file_execute,
-                                         cdetect_suffix_execute);
-    source_file = cdetect_string_format("%s%s",
-                                        cdetect_file_execute,
-                                        cdetect_suffix_source);
+cdetect_string_t
+cdetect_header_locate(cdetect_string_t output,
+                      const char *header)
+{
+    static const char *note = "Note: including file:";
+    cdetect_string_t result = 0;
+    cdetect_string_t current;
+    cdetect_string_t rest;
+    size_t length;
+    size_t begin;
+    size_t depth;
+    size_t best = 0;
+    char separator;
 
-    success = cdetect_file_overwrite(source_file->content, sourcecode);
-    if (success == CDETECT_FALSE) {
-        cdetect_log("Cannot write file %'^s\n",  source_file);
-    } else {
-        success = cdetect_compile_file(source_file,
-                                       execute_file,
-                                       cflags,
-                                       ldflags,
-                                       arguments,
-                                       do_execute,
-                                       is_remote,
-                                       result);
-        (void)cdetect_file_remove(execute_file->content);
+    length = strlen(header);
+    current = cdetect_string_format("%^s", output);
+    while (current) {
+        rest = cdetect_string_split(current, '\n');
+        cdetect_string_trim(current, "\r");
+
+        begin = 0;
+        if ((current->length > strlen(note)) &&
+            cdetect_strequal_max(current->content, strlen(note), note)) {
+            for (begin = strlen(note); current->content[begin] == ' '; ++begin)
+                continue;
+            depth = begin - strlen(note);
+        } else {
+            while (current->content[begin] == '.')
+                ++begin;
+            depth = begin;
+            begin = ((begin > 0) && (current->content[begin] == ' ')) ? begin + 1 : 0;
+        }
+
+        if (((result == 0) || (depth < best)) && (begin > 0) && (current->length > begin + length)) {
+            separator = current->content[current->length - length - 1];
+            if (((separator == '/') || (separator == cdetect_path_separator)) &&
+                cdetect_strequal_max(&current->content[current->length - length], length, header)) {
+                cdetect_string_destroy(result);
+                result = cdetect_string_format("%s", &current->content[begin]);
+                best = depth;
+            }
+        }
+        cdetect_string_destroy(current);
+        current = rest;
     }
+    return result;
+}
 
-    (void)cdetect_file_remove(source_file->content);
+/*
+ * Remember the stamp and path of a found header
+ */
 
-    cdetect_string_destroy(source_file);
-    cdetect_string_destroy(execute_file);
+void
+cdetect_header_remember_location(const char *header,
+                                 cdetect_string_t output)
+{
+    cdetect_string_t path;
+    cdetect_string_t stamp;
+    cdetect_string_t value;
 
-    return success;
+    if ((output == 0) || (cdetect_format_includes == 0))
+        return;
+
+    path = cdetect_header_locate(output, header);
+    if (path) {
+        stamp = cdetect_file_stamp(path->content);
+        if (stamp) {
+            value = cdetect_string_format("%^s %^s", stamp, path);
+            (void)cdetect_map_remember(cdetect_header_location_map, header, value->content);
+            cdetect_string_destroy(value);
+            /* Directories are collected again when needed */
+            cdetect_map_destroy(cdetect_header_directory_map);
+            cdetect_header_directory_map = 0;
+        }
+        cdetect_string_destroy(stamp);
+        cdetect_string_destroy(path);
+    }
 }
 
-/**
-   Compile C/C++ source code.
+/*
+ * Collect the directories in which headers have been found
+ */
 
-   @param source Source code buffer.
-   @param cflags Compilation flags.
-   @return Boolean indicating success or failure to compile.
-*/
+cdetect_map_t
+cdetect_header_directories(void)
+{
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t stamp;
+    cdetect_string_t path;
+    size_t length;
 
-int
-config_compile_source(const char *source,
-                      const char *cflags)
+    if (cdetect_header_directory_map == 0) {
+        cdetect_header_directory_map = cdetect_map_create(0, 0);
+        for (position = cdetect_list_front(cdetect_header_location_map->first);
+             position != 0;
+             position = cdetect_list_next(position)) {
+            element = (cdetect_map_element_t)position->data;
+            if (element && element->data) {
+                stamp = cdetect_string_format("%s", (const char *)element->data);
+                path = cdetect_string_split(stamp, ' ');
+                cdetect_string_destroy(stamp);
+                length = strlen(element->key);
+                if (path && (path->length > length)) {
+                    path->content[path->length - length] = 0;
+                    (void)cdetect_map_remember(cdetect_header_directory_map, path->content, 0);
+                }
+                cdetect_string_destroy(path);
+            }
+        }
+    }
+    return cdetect_header_directory_map;
+}
+
+/*
+ * Check if a cached result of a header has become outdated
+ *
+ * A found header is outdated if its file has changed or disappeared. A
+ * missing header is outdated if it now exists in one of the directories
+ * where other headers have been found.
+ */
+
+cdetect_bool_t
+cdetect_header_is_stale(const char *header,
+                        cdetect_bool_t is_found)
 {
-    cdetect_bool_t success;
+    cdetect_bool_t result = CDETECT_FALSE;
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t stamp;
+    cdetect_string_t path;
+    cdetect_string_t current;
+
+    if (is_found) {
+        element = cdetect_map_lookup(cdetect_header_location_map, header);
+        if (element && element->data) {
+            stamp = cdetect_string_format("%s", (const char *)element->data);
+            path = cdetect_string_split(stamp, ' ');
+            if (path) {
+                current = cdetect_file_stamp(path->content);
+                result = (cdetect_bool_t)((current == 0) ||
+                                          !cdetect_strequal(current->content, stamp->content));
+                cdetect_string_destroy(current);
+            }
+            cdetect_string_destroy(path);
+            cdetect_string_destroy(stamp);
+        }
+    } else {
+        for (position = cdetect_list_front(cdetect_header_directories()->first);
+             (result == CDETECT_FALSE) && (position != 0);
+             position = cdetect_list_next(position)) {
+            element = (cdetect_map_element_t)position->data;
+            if (element) {
+                path = cdetect_string_format("%s%s", element->key, header);
+                result = cdetect_file_exist(path->content);
+                cdetect_string_destroy(path);
+            }
+        }
+    }
+    if (result) {
+        cdetect_log("cdetect_header_is_stale(%'s) cached result is outdated\n", header);
+    }
+    return result;
+}
+
+/*
+ * Check if the existence of a header is already known
+ */
+
+cdetect_report_t
+cdetect_header_check_cache(const char *header)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_map_element_t element;
+
+    element = cdetect_map_lookup(cdetect_header_map, header);
+    if (element && element->data) {
+        if (cdetect_strequal((const char *)element->data, "1")) {
+            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
+        } else {
+            report = CDETECT_REPORT_CACHED;
+        }
+        if (cdetect_header_is_stale(header, (cdetect_bool_t)(report & CDETECT_REPORT_FOUND))) {
+            /* Probe again */
+            report = CDETECT_REPORT_NULL;
+        }
+    }
+
+    return report;
+}
+
+/*
+ * Compile a header after its prerequisites
+ *
+ * The list of included files is returned in @p output if requested, and
+ * the location of the header is remembered if it was found.
+ */
+
+cdetect_report_t
+cdetect_header_compile(cdetect_string_t preclude,
+                       const char *header,
+                       cdetect_string_t *output)
+{
+    cdetect_report_t report;
     cdetect_string_t sourcecode;
     cdetect_string_t compile_flags;
     cdetect_string_t link_flags;
     cdetect_string_t result = 0;
 
-    cdetect_log("config_compile_source(source, cflags = %'s)\n", cflags);
-
-    /* FIXME: change cflags to comma-separated list of defines? */
+    sourcecode = cdetect_string_format("%^s#include <%s>\nint main(void) { return 0;}\n",
+                                       preclude, header);
 
-    sourcecode = cdetect_string_format("%s", source);
-    compile_flags = cdetect_string_format("%s", cflags);
+    compile_flags = cdetect_string_format("%s", cdetect_format_includes ? cdetect_format_includes : "");
     link_flags = cdetect_string_format("");
 
-    success = cdetect_compile_source(sourcecode,
+    report = (cdetect_compile_source(sourcecode,
                                      compile_flags,
                                      link_flags,
                                      0,
                                      CDETECT_FALSE,
                                      CDETECT_FALSE,
-                                     &result);
+                                     &result))
+        ? CDETECT_REPORT_FOUND
+        : (cdetect_is_timed_out ? CDETECT_REPORT_TIMEOUT : CDETECT_REPORT_NULL);
 
-    cdetect_string_destroy(result);
+    if ((report & CDETECT_REPORT_FOUND)) {
+        cdetect_header_remember_location(header, result);
+    }
+    if (output) {
+        *output = result;
+    } else {
+        cdetect_string_destroy(result);
+    }
     cdetect_string_destroy(link_flags);
     cdetect_string_destroy(compile_flags);
     cdetect_string_destroy(sourcecode);
 
-    return (int)success;
+    return report;
+}
+
+/*
+ * Include the found prerequisites from first to last
+ */
+
+cdetect_string_t
+cdetect_header_preclude(cdetect_string_t *headers,
+                        cdetect_report_t *reports,
+                        int first,
+                        int last)
+{
+    cdetect_string_t result;
+    cdetect_string_t work;
+    int i;
+
+    result = cdetect_string_create();
+    for (i = first; i < last; ++i) {
+        if ((reports[i] & CDETECT_REPORT_FOUND)) {
+            work = cdetect_string_format("#include <%^s>\n", headers[i]);
+            (void)cdetect_string_append(result, work->content);
+            cdetect_string_destroy(work);
+        }
+    }
+    return result;
+}
+
+/*
+ * Check if a header exists
+ *
+ * Each prerequisite is checked after the prerequisites that follow it in
+ * the list. If none of the prerequisites is known to be missing, all of
+ * them are first tried together with the header in a single compilation.
+ * Otherwise each prerequisite is resolved once, from the last to the
+ * first, and the outcome is remembered in the header map.
+ */
+
+cdetect_report_t
+cdetect_header_check(const char *header, const char *dependencies)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_report_t *reports;
+    cdetect_string_t *prerequisites;
+    cdetect_string_t preclude;
+    cdetect_string_t output = 0;
+    cdetect_bool_t is_resolved = CDETECT_FALSE;
+    int count = 0;
+    int i;
+
+    report = cdetect_header_check_cache(header);
+    if (!(report & CDETECT_REPORT_CACHED)) {
+
+        prerequisites = cdetect_probe_candidates(dependencies ? dependencies : "",
+                                                 CDETECT_FALSE,
+                                                 &count);
+        reports = (cdetect_report_t *)cdetect_allocate((count + 1) * sizeof(reports[0]));
+
+        /* Assume that unknown prerequisites exist */
+        is_resolved = CDETECT_TRUE;
+        for (i = 0; i < count; ++i) {
+            reports[i] = cdetect_header_check_cache(prerequisites[i]->content);
+            if ((reports[i] & CDETECT_REPORT_CACHED) && !(reports[i] & CDETECT_REPORT_FOUND)) {
+                is_resolved = CDETECT_FALSE;
+            } else {
+                reports[i] = (cdetect_report_t)(reports[i] | CDETECT_REPORT_FOUND);
+            }
+        }
+
+        if (is_resolved) {
+            preclude = cdetect_header_preclude(prerequisites, reports, 0, count);
+            report = cdetect_header_compile(preclude, header, &output);
+            cdetect_string_destroy(preclude);
+            if ((report & CDETECT_REPORT_FOUND)) {
+                for (i = 0; i < count; ++i) {
+                    if (!(reports[i] & CDETECT_REPORT_CACHED)) {
+                        cdetect_header_define(prerequisites[i]->content, CDETECT_REPORT_FOUND);
+                        cdetect_header_remember_location(prerequisites[i]->content, output);
+                    }
+                }
+            } else {
+                /* Without prerequisites there is nothing else to try */
+                is_resolved = (cdetect_bool_t)(count == 0);
+            }
+        }
+
+        if (!is_resolved) {
+            /* Each prerequisite may depend on those after it */
+            for (i = count - 1; i >= 0; --i) {
+                if (!(reports[i] & CDETECT_REPORT_CACHED)) {
+                    preclude = cdetect_header_preclude(prerequisites, reports, i + 1, count);
+                    reports[i] = cdetect_header_compile(preclude, prerequisites[i]->content, 0);
+                    cdetect_header_define(prerequisites[i]->content, reports[i]);
+                    cdetect_string_destroy(preclude);
+                }
+            }
+            preclude = cdetect_header_preclude(prerequisites, reports, 0, count);
+            report = cdetect_header_compile(preclude, header, 0);
+            cdetect_string_destroy(preclude);
+        }
+
+        cdetect_string_destroy(output);
+        cdetect_free(reports);
+        cdetect_probe_candidates_destroy(prerequisites, count);
+    }
+
+    return report;
+}
+
+/*
+ * Report and define the outcome of a header check
+ */
+
+void
+cdetect_header_report(const char *header,
+                      cdetect_report_t report)
+{
+    cdetect_string_t message;
+
+    message = cdetect_string_format("<%s>", header);
+    cdetect_report_bool(message->content, report);
+    cdetect_header_define(header, report);
+
+    cdetect_string_destroy(message);
+}
+
+/*
+ * Adapters for speculative probes of headers
+ */
+
+cdetect_report_t
+cdetect_header_probe_cache(const char *dependencies,
+                           const char *header)
+{
+    (void)dependencies;
+    return cdetect_header_check_cache(header);
+}
+
+cdetect_report_t
+cdetect_header_probe_check(const char *dependencies,
+                           const char *header)
+{
+    return cdetect_header_check(header, dependencies);
+}
+
+/**
+   Check for the existence of a given header file.
+
+   @param header The header file to be examined.
+   @return True (non-zero) if the header was found, false (zero) otherwise.
+*/
+
+int
+config_header_check(const char *header)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+
+    cdetect_log("config_header_check(header = %'s)\n", header);
+
+    if (header) {
+        report = cdetect_header_check(header, 0);
+        cdetect_header_report(header, report);
+    }
+    return (report & CDETECT_REPORT_FOUND);
+}
+
+int
+config_header_check_depend(const char *header,
+                           const char *dependencies)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+
+    cdetect_log("config_header_check_depend(header = %'s, dependencies = %'s)\n",
+                header, dependencies);
+
+    if (header) {
+        report = cdetect_header_check(header, dependencies);
+        cdetect_header_report(header, report);
+    }
+    return (report & CDETECT_REPORT_FOUND);
 }
 
+/**
+   Check for the first existing header file in a list.
+
+   @param headers Comma-separated list of header files, in order of preference.
+   @return True (non-zero) if one of the headers was found, false (zero) otherwise.
+
+   The result is the same as checking each header with
+   @c config_header_check until one is found, but the headers are examined
+   concurrently where possible.
+
+   Example: Check for the directory header
+
+   @code
+   config_header_check_first_of("dirent.h,sys/ndir.h,sys/dir.h,ndir.h");
+   @endcode
+
+   which is equivalent to
+
+   @code
+   config_header_check("dirent.h")
+       || config_header_check("sys/ndir.h")
+       || config_header_check("sys/dir.h")
+       || config_header_check("ndir.h");
+   @endcode
+*/
+
 int
-config_file_create(const char *filename, const char *message)
+config_header_check_first_of(const char *headers)
 {
-    cdetect_bool_t success;
-    cdetect_string_t content;
+    cdetect_report_t *reports;
+    cdetect_string_t *candidates;
+    cdetect_bool_t found = CDETECT_FALSE;
+    int decided;
+    int count;
+    int i;
 
-    content = cdetect_string_format("%s", message);
+    cdetect_log("config_header_check_first_of(headers = %'s)\n", headers);
 
-    success = cdetect_file_overwrite(filename, content);
+    if (headers == 0)
+        return CDETECT_FALSE;
 
-    cdetect_string_destroy(content);
+    candidates = cdetect_probe_candidates(headers, CDETECT_FALSE, &count);
+    reports = (cdetect_report_t *)cdetect_allocate((count + 1) * sizeof(reports[0]));
 
-    return (int)success;
+    decided = cdetect_probe_first_of(cdetect_header_probe_cache,
+                                     cdetect_header_probe_check,
+                                     0,
+                                     candidates,
+                                     count,
+                                     reports);
+    for (i = 0; i < decided; ++i) {
+        cdetect_header_report(candidates[i]->content, reports[i]);
+        if ((reports[i] & CDETECT_REPORT_FOUND))
+            found = CDETECT_TRUE;
+    }
+
+    cdetect_free(reports);
+    cdetect_probe_candidates_destroy(candidates, count);
+
+    return found;
 }
 
+/* FIXME: Documentation */
+
 int
-config_file_remove(const char *filename)
+config_header_register(const char *target)
 {
-    return (int)cdetect_file_remove(filename);
+    cdetect_string_destroy(cdetect_include_file);
+    if (target == 0) {
+        cdetect_include_file = 0;
+    } else {
+        cdetect_include_file = cdetect_string_format("%s", target);
+    }
+    return CDETECT_TRUE;
 }
 
 int
-config_file_exist_format(const char *format, ...)
+config_header_register_format(const char *format)
 {
-    cdetect_bool_t success;
-    cdetect_string_t name;
-    va_list arguments;
-
-    cdetect_log("config_file_exist(format = %'s)\n", format);
+    cdetect_string_destroy(cdetect_header_format);
+    cdetect_header_format = cdetect_string_format("%s", format);
+    return (cdetect_header_format != 0);
+}
 
-    va_start(arguments, format);
-    name = cdetect_string_vformat(format, arguments);
-    va_end(arguments);
+/*
+ * Save header file
+ */
 
-    success = cdetect_file_exist(name->content);
+void
+cdetect_header_save(void)
+{
+    cdetect_string_t raw_include_guard = 0;
+    cdetect_string_t include_guard = 0;
 
-    cdetect_string_destroy(name);
+    if (cdetect_include_file == 0)
+        return;
 
-    return (int)success;
-}
+    cdetect_log("cdetect_header_save(%'^s)\n", cdetect_include_file);
 
-/**
-   Compile a file containing C/C++ source code.
+    cdetect_output("creating %^s\n", cdetect_include_file);
 
-   @param filename Name of file to be compiled.
-   @param cflags Compilation flags.
-   @return Boolean indicating success or failure to compile.
-*/
+    (void)cdetect_file_remove(cdetect_include_file->content);
 
-int
-config_file_compile(const char *filename,
-                    const char *cflags)
-{
-    cdetect_bool_t success;
-    cdetect_string_t source_file;
-    cdetect_string_t execute_file;
-    cdetect_string_t compile_flags;
-    cdetect_string_t link_flags;
-    cdetect_string_t result = 0;
+    cdetect_file_write_after(cdetect_include_file,
+                             "/* Autogenerated by cDetect %d.%d.%d -- http://cdetect.sourceforge.net/ */\n",
+                             CDETECT_VERSION_MAJOR,
+                             CDETECT_VERSION_MINOR,
+                             CDETECT_VERSION_PATCH);
 
-    cdetect_log("config_file_compile(filename = %'s, cflags = %'s)\n",
-                filename, cflags);
+    raw_include_guard = cdetect_string_format("CDETECT_INCLUDE_GUARD_%^s",
+                                              cdetect_include_file);
+    include_guard = cdetect_macro_transform_upper(raw_include_guard);
 
-    source_file = cdetect_string_format("%s", filename);
-    execute_file = cdetect_string_format("%s%s",
-                                         cdetect_file_execute,
-                                         cdetect_suffix_execute);
-    compile_flags = cdetect_string_format("%s", cflags);
-    link_flags = cdetect_string_format("");
+    if (include_guard) {
+        cdetect_file_write_after(cdetect_include_file,
+                                 "#ifndef %^s\n#define %^s\n\n",
+                                 include_guard,
+                                 include_guard);
+    }
 
-    success = cdetect_compile_file(source_file,
-                                   execute_file,
-                                   compile_flags,
-                                   link_flags,
-                                   0,
-                                   CDETECT_FALSE,
-                                   CDETECT_FALSE,
-                                   &result);
+    if (cdetect_is_compiler_checked && cdetect_compiler_name) {
+        cdetect_macro_save_number("CDETECT_COMPILER_%s",
+                                  cdetect_compiler_name->content,
+                                  cdetect_compiler_version);
+    }
+    if (cdetect_is_kernel_checked && cdetect_kernel_name) {
+        cdetect_macro_save_number("CDETECT_KERNEL_%s",
+                                  cdetect_kernel_name->content,
+                                  cdetect_kernel_version);
+    }
+    if (cdetect_is_cpu_checked && cdetect_cpu_name) {
+        cdetect_macro_save_number("CDETECT_CPU_%s",
+                                  cdetect_cpu_name->content,
+                                  cdetect_cpu_version);
+    }
 
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(link_flags);
-    cdetect_string_destroy(compile_flags);
-    cdetect_string_destroy(execute_file);
-    cdetect_string_destroy(source_file);
+    cdetect_macro_save_map(cdetect_header_map,
+                           cdetect_header_format->content,
+                           cdetect_macro_filter_false,
+                           cdetect_macro_transform_upper);
+    cdetect_macro_save_map(cdetect_type_map,
+                           cdetect_type_format->content,
+                           cdetect_macro_filter_false,
+                           cdetect_macro_transform_upper);
+    cdetect_macro_save_map(cdetect_function_map,
+                           cdetect_function_format->content,
+                           cdetect_macro_filter_false,
+                           cdetect_macro_transform_upper);
+    cdetect_macro_save_map(cdetect_library_map,
+                           cdetect_library_format->content,
+                           cdetect_macro_filter_false,
+                           cdetect_macro_transform_upper);
+    cdetect_macro_save_map(cdetect_macro_map, "%s", 0, 0);
 
-    return (int)success;
+    if (include_guard) {
+        cdetect_file_write_after(cdetect_include_file,
+                                 "\n#endif /* %^s */\n",
+                                 include_guard);
+    }
+    cdetect_string_destroy(include_guard);
+    cdetect_string_destroy(raw_include_guard);
 }
 
-/**
-   Compile and execute a file containing C/C++ source code.
+/*************************************************************************
+ *
+ * Detect Types
+ *
+ ************************************************************************/
 
-   @param source Source code buffer.
-   @param cflags Compilation flags.
-   @param args Arguments for the execution.
-   @return Boolean indicating success or failure to compile and execute.
-*/
+/*
+ * Define a type macro
+ */
 
-int
-config_execute_source(const char *source,
-                      const char *cflags,
-                      const char *args)
+void
+cdetect_type_define(const char *type,
+                    const char *header,
+                    cdetect_report_t found)
 {
-    cdetect_bool_t success;
-    cdetect_string_t sourcecode;
-    cdetect_string_t compile_flags;
-    cdetect_string_t link_flags;
-    cdetect_string_t arguments;
-    cdetect_string_t result = 0;
+    cdetect_map_element_t element;
 
-    cdetect_log("cdetect_execute_source(source, cflags = %'s, args = %'s)\n", cflags, args);
+    assert(type != 0);
 
-    /* FIXME: change cflags to comma-separated list of defines? */
+    element = cdetect_map_remember_context(cdetect_type_map,
+                                           header,
+                                           type,
+                                           (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    cdetect_timeout_remember(cdetect_cache_identifier_type, element->key, found);
+}
 
-    sourcecode = cdetect_string_format("%s", source);
-    compile_flags = cdetect_string_format("%s", cflags);
-    link_flags = cdetect_string_format("");
-    arguments = cdetect_string_format("%s", args);
+/**
+   Define whether or not a data type exists.
 
-    success = cdetect_compile_source(sourcecode,
-                                     compile_flags,
-                                     link_flags,
-                                     args ? arguments : 0,
-                                     CDETECT_TRUE,
-                                     (cdetect_bool_t)(cdetect_command_remote != 0),
-                                     &result);
+   @param type The name of the data type.
+   @param header The header file that contains the data type. Can be zero (0).
+   @param found Boolean indicating whether or not the type was found.
 
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(arguments);
-    cdetect_string_destroy(link_flags);
-    cdetect_string_destroy(compile_flags);
-    cdetect_string_destroy(sourcecode);
+   @sa config_type_check
+*/
 
-    return success;
+void
+config_type_define(const char *type,
+                   const char *header,
+                   int found)
+{
+    cdetect_type_define(type, header, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
 }
 
-/**
-   Execute a command.
+/*
+ * Check if a type exists
+ */
 
-   @param command Name of command.
-   @return Boolean indicating success or failure to execute.
-*/
-/* FIXME: document %-specifiers (@ref formatting) and @VAR@ substitution (@ref varsub) */
+cdetect_report_t
+cdetect_type_check_cache(const char *type,
+                         const char *header)
+{
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_map_element_t element;
 
-int
-config_execute_command(const char *command, ...)
+    element = cdetect_map_lookup_context(cdetect_type_map, header, type);
+    if (element && element->data) {
+        if (cdetect_strequal((const char *)element->data, "1")) {
+            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
+        } else {
+            report = CDETECT_REPORT_CACHED;
+        }
+    }
+
+    return report;
+}
+
+cdetect_report_t
+cdetect_type_check_header(const char *type,
+                          const char *header)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    cdetect_string_t real_command;
+    cdetect_report_t report = CDETECT_REPORT_NULL;
+    cdetect_string_t sourcecode;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
     cdetect_string_t result = 0;
-    va_list arguments;
 
-    cdetect_log("config_execute_command(command = %'#s, ...)\n", command);
+    report = cdetect_type_check_cache(type, header);
+    if (!(report & CDETECT_REPORT_CACHED)) {
+
+        if (header) {
+            sourcecode = cdetect_string_format("#include <%s>\nint main(void) { int size;\nsize = sizeof(%s);\nreturn 0;}\n",
+                                               header, type);
+        } else {
+            sourcecode = cdetect_string_format("int main(void) { int size;\nsize = sizeof(%s);\nreturn 0;}\n",
+                                               type);
+        }
 
-    va_start(arguments, command);
-    real_command = cdetect_string_vformat(command, arguments);
-    va_end(arguments);
+        compile_flags = cdetect_string_format("");
+        link_flags = cdetect_string_format("");
 
-    success = cdetect_execute_substitute(real_command, &result, CDETECT_FALSE);
+        report = (cdetect_compile_source(sourcecode,
+                                         compile_flags,
+                                         link_flags,
+                                         0,
+                                         CDETECT_FALSE,
+                                         CDETECT_FALSE,
+                                         &result))
+            ? CDETECT_REPORT_FOUND
+            : (cdetect_is_timed_out ? CDETECT_REPORT_TIMEOUT : CDETECT_REPORT_NULL);
 
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(real_command);
+		cdetect_log(">>> BEGIN OF SOURCE\n");
+		cdetect_log("%s\n",sourcecode->content);
+		cdetect_log(">>> END OF SOURCE\n");
+		cdetect_log(">>> BEGIN OF OUTPUT\n");
+		cdetect_log("%s\n",result ? result->content : "");
+		cdetect_log(">>> END OF OUTPUT\n");
 
-    return success;
-}
+        cdetect_string_destroy(result);
+        cdetect_string_destroy(link_flags);
+        cdetect_string_destroy(compile_flags);
+        cdetect_string_destroy(sourcecode);
+    }
 
-/*************************************************************************
- *
- * Define Macros
- *
- ************************************************************************/
+    return report;
+}
 
 /*
- * Define a generic macro
+ * Report and define the outcome of a type check
  */
 
 void
-cdetect_macro_define(const char *macro,
-                     const char *value)
+cdetect_type_report(const char *type,
+                    const char *header,
+                    cdetect_report_t report)
 {
-    assert(macro != 0);
-    assert(value != 0);
+    cdetect_string_t message;
 
-    (void)cdetect_map_remember_context(cdetect_macro_map, 0, macro, value);
+    message = cdetect_string_format( (header == 0) ? "type %s" : "type %s in <%s>",
+                                     type,
+                                     header);
+    cdetect_report_bool(message->content, report);
+    cdetect_type_define(type, header, report);
+    if (header) {
+        /* If the type was found in a header, define this header as well */
+        cdetect_header_define(header, report);
+    }
+
+    cdetect_string_destroy(message);
 }
 
-/* FIXME: Documentation */
+/*
+ * Adapters for speculative probes of types
+ *
+ * An empty header means no header.
+ */
 
-int
-config_macro_define(const char *macro,
-                    const char *value)
+cdetect_report_t
+cdetect_type_probe_cache(const char *type,
+                         const char *header)
 {
-    cdetect_log("config_macro_define(macro = %'s, value = %'s)\n",
-                macro, value);
-
-    cdetect_macro_define(macro, value);
+    return cdetect_type_check_cache(type, (header[0] == 0) ? 0 : header);
+}
 
-    return (int)CDETECT_TRUE;
+cdetect_report_t
+cdetect_type_probe_check(const char *type,
+                         const char *header)
+{
+    return cdetect_type_check_header(type, (header[0] == 0) ? 0 : header);
 }
 
-/* FIXME: Documentation */
+/**
+   Check for the existence of a given data type in a header file.
 
-int
-config_macro_define_format(const char *macro,
-                           const char *format, ...)
-{
-    cdetect_string_t value;
-    va_list arguments;
+   @param type Data type to be examined.
+   @param header Header file in which @p type may exist.
+   @return True (non-zero) if the type was found, false (zero) otherwise.
 
-    cdetect_log("config_macro_define_format(macro = %'s, ...)\n",
-                macro);
+   Macros for both the data type and the header are added to config.h if the
+   data type exists.
 
-    va_start(arguments, format);
-    value = cdetect_string_vformat(format, arguments);
-    va_end(arguments);
-    cdetect_macro_define(macro, value->content);
+   Example: Check if int64_t is located in <stddef.h> or <inttypes.h>
 
-    cdetect_string_destroy(value);
+   @code
+   config_type_check_header("int64_t", "stddef.h")
+       || config_type_check_header("int64_t", "inttypes.h");
+   @endcode
 
-    return (int)CDETECT_TRUE;
-}
+   which may result in
 
-/*
- * Convert string into valid macro
- */
+   @code
+   #define CDETECT_HEADER_INTTYPES_H 1
+   #define CDETECT_TYPE_INT64_T 1
+   @endcode
+*/
 
-cdetect_string_t
-cdetect_macro_transform_upper(cdetect_string_t macro)
+int
+config_type_check_header(const char *type,
+                         const char *header)
 {
-    return cdetect_string_transform_upper(macro->content);
-}
+    cdetect_report_t report = CDETECT_REPORT_NULL;
 
-/*
- * Save macro
- */
+    cdetect_log("config_type_check_header(type = %'s, header = %'s)\n",
+                type, header);
 
-void
-cdetect_macro_save(const char *format,
-                   const char *variable,
-                   const char *value,
-                   cdetect_macro_transform_t transform)
-{
-    cdetect_string_t data;
-    cdetect_string_t raw_macro;
-    cdetect_string_t macro;
-    size_t offset;
+    if (type) {
 
-    data = cdetect_string_format("%s", variable);
-    offset = cdetect_string_find_char(data, 0, cdetect_map_context_separator);
-    offset = (offset == data->length) ? 0 : offset + 1;
+        if ((header) && (header[0] == 0))
+            header = 0;
 
-    raw_macro = cdetect_string_format(format, &data->content[offset]);
-    if (transform) {
-        macro = transform(raw_macro);
-        cdetect_string_destroy(raw_macro);
-    } else {
-        macro = raw_macro;
+        report = cdetect_type_check_header(type, header);
+        cdetect_type_report(type, header, report);
     }
+    return (report & CDETECT_REPORT_FOUND);
+}
 
-    cdetect_file_write_after(cdetect_include_file,
-                             "#define %s %s\n",
-                             macro->content, value);
+/**
+   Check for the existence of a given data type in the first of a list of header files.
 
-    cdetect_string_destroy(macro);
-    cdetect_string_destroy(data);
-}
+   @param type Data type to be examined.
+   @param headers Comma-separated list of header files, in order of preference.
+   An empty entry checks for @p type without any header.
+   @return True (non-zero) if the type was found, false (zero) otherwise.
 
-/*
- * Save macro with number
- */
+   The result, including the macros added to config.h, is the same as
+   checking each header with @c config_type_check_header until the type is
+   found, but the headers are examined concurrently where possible.
 
-void
-cdetect_macro_save_number(const char *format,
-                          const char *variable,
-                          unsigned int number)
-{
-    cdetect_string_t value;
+   Example: Check for pid_t in a number of headers, and finally without any
 
-    if (variable) {
-        value = cdetect_string_format("0x%x", number);
-        cdetect_macro_save(format, variable, value->content, cdetect_macro_transform_upper);
-        cdetect_string_destroy(value);
-    }
-}
+   @code
+   config_type_check_first_of("pid_t", "sys/types.h,unistd.h,");
+   @endcode
 
-/*
- * Save all macros in list
- */
+   which is equivalent to
 
-void
-cdetect_macro_save_map(cdetect_map_t map,
-                       const char *format,
-                       cdetect_macro_filter_t filter,
-                       cdetect_macro_transform_t transform)
+   @code
+   config_type_check_header("pid_t", "sys/types.h")
+       || config_type_check_header("pid_t", "unistd.h")
+       || config_type_check("pid_t");
+   @endcode
+*/
+
+int
+config_type_check_first_of(const char *type,
+                           const char *headers)
 {
-    cdetect_map_element_t element;
-    cdetect_list_t current;
+    cdetect_report_t *reports;
+    cdetect_string_t *candidates;
+    cdetect_bool_t found = CDETECT_FALSE;
+    int decided;
+    int count;
+    int i;
 
-    for (current = cdetect_list_front(map->first);
-         current != 0;
-         current = cdetect_list_next(current)) {
+    cdetect_log("config_type_check_first_of(type = %'s, headers = %'s)\n",
+                type, headers);
 
-        element = (cdetect_map_element_t)current->data;
-        if (element) {
-            if ((filter == 0) || filter(element->key, (const char *)element->data)) {
-                cdetect_macro_save(format, element->key, (const char *)element->data, transform);
-            }
-        }
+    if ((type == 0) || (headers == 0))
+        return CDETECT_FALSE;
+
+    candidates = cdetect_probe_candidates(headers, CDETECT_TRUE, &count);
+    reports = (cdetect_report_t *)cdetect_allocate((count + 1) * sizeof(reports[0]));
+
+    decided = cdetect_probe_first_of(cdetect_type_probe_cache,
+                                     cdetect_type_probe_check,
+                                     type,
+                                     candidates,
+                                     count,
+                                     reports);
+    for (i = 0; i < decided; ++i) {
+        cdetect_type_report(type,
+                            (candidates[i]->length > 0) ? candidates[i]->content : 0,
+                            reports[i]);
+        if ((reports[i] & CDETECT_REPORT_FOUND))
+            found = CDETECT_TRUE;
     }
+
+    cdetect_free(reports);
+    cdetect_probe_candidates_destroy(candidates, count);
+
+    return found;
 }
 
-/*
- * Filter macros with zero value
- */
+/**
+   Check for the existence of a given data type.
 
-cdetect_bool_t
-cdetect_macro_filter_false(const char *key,
-                           const char *value)
-{
-    assert(value != 0);
-    (void)key;
+   @param type Data type to be examined.
+   @return Boolean indicating if the data type was found.
 
-    if (cdetect_strequal(value, "0"))
-        return CDETECT_FALSE;
-    return CDETECT_TRUE;
-}
+   @sa config_type_check_header
 
-/*************************************************************************
- *
- * Detect Libraries
- *
- ************************************************************************/
+   A macro for the data type is added to config.h if the data type exists.
 
-/*
- * Define a library macro
- */
+   Example: Check for support of long long and __int64
 
-void
-cdetect_library_define(const char *library,
-                       cdetect_report_t found)
+   @code
+   config_type_check("long long");
+   config_type_check("__int64");
+   @endcode
+
+   which may result in
+
+   @code
+   #define CDETECT_TYPE_LONG_LONG 1
+   #define CDETECT_TYPE___INT64 1
+   @endcode
+*/
+
+int
+config_type_check(const char *type)
 {
-    (void)cdetect_map_remember(cdetect_library_map,
-                               library,
-                               (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    return config_type_check_header(type, 0);
 }
 
 int
-config_library_register_format(const char *format)
+config_type_register_format(const char *format)
 {
-    cdetect_string_destroy(cdetect_library_format);
-    cdetect_library_format = cdetect_string_format("%s", format);
-    return (cdetect_library_format != 0);
+    cdetect_string_destroy(cdetect_type_format);
+    cdetect_type_format = cdetect_string_format("%s", format);
+    return (cdetect_type_format != 0);
 }
 
 /*************************************************************************
  *
- * Detect Functions
+ * Compute Integer Constants
  *
  ************************************************************************/
 
 /*
- * Define a function macro
+ * Each compilation tests a number of disjoint ranges. The line of a range
+ * only compiles if the value is outside the range, so at most one line
+ * fails and the error message tells which range holds the value. That is
+ * robust against compilers that stop after a number of errors.
  */
 
-void
-cdetect_function_define(const char *function,
-                        const char *library,
-                        cdetect_report_t found)
-{
-    assert(function != 0);
-
-    (void)cdetect_map_remember_context(cdetect_function_map,
-                                       library,
-                                       function,
-                                       (found & CDETECT_REPORT_FOUND) ? "1" : "0");
-}
+#define CDETECT_COMPUTE_BATCH 256
 
-/* FIXME: Documentation */
+/*
+ * Format constant for use in source code
+ */
 
-void
-config_function_define(const char *function,
-                       const char *library,
-                       int found)
+cdetect_string_t
+cdetect_compute_constant(long value)
 {
-    cdetect_function_define(function, library, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    /* The most negative value cannot be written as a literal */
+    if (value == LONG_MIN)
+        return cdetect_string_format("(%ldL - 1)", value + 1);
+    return cdetect_string_format("(%ldL)", value);
 }
 
 /*
- * Check if a function exists
+ * Find the source line numbers of errors in compiler output
+ *
+ * Returns the number of distinct line numbers found.
  */
 
-cdetect_report_t
-cdetect_function_check_cache(const char *function,
-                             const char *library)
+int
+cdetect_compute_error_lines(cdetect_string_t output,
+                            const char *filename,
+                            unsigned long *lines,
+                            int max_lines)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_map_element_t element;
+    size_t filename_length;
+    size_t offset;
+    size_t end;
+    size_t i;
+    size_t digits;
+    unsigned long line;
+    cdetect_bool_t is_error;
+    int count = 0;
+    int k;
 
-    element = cdetect_map_lookup_context(cdetect_function_map, library, function);
-    if (element && element->data) {
-        if (cdetect_strequal((const char *)element->data, "1")) {
-            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
-        } else {
-            report = CDETECT_REPORT_CACHED;
+    filename_length = strlen(filename);
+
+    for (offset = 0; offset < output->length; offset = end + 1) {
+        end = cdetect_string_find_char(output, offset, '\n');
+
+        /* Ignore warnings and notes */
+        is_error = CDETECT_TRUE;
+        for (i = offset; i < end; ++i) {
+            if (cdetect_strequal_max(&output->content[i], 7, "warning") ||
+                cdetect_strequal_max(&output->content[i], 5, "note:")) {
+                is_error = CDETECT_FALSE;
+                break;
+            }
         }
-    }
+        if (!is_error)
+            continue;
 
-    return report;
+        /* Look for <filename>:<line> or <filename>(<line>) */
+        for (i = offset; i + filename_length + 1 < end; ++i) {
+            if (!cdetect_strequal_max(&output->content[i], filename_length, filename))
+                continue;
+            if ((output->content[i + filename_length] != ':') &&
+                (output->content[i + filename_length] != '('))
+                continue;
+            digits = cdetect_strskip(output->content, i + filename_length + 1, cdetect_is_digit);
+            if (digits == i + filename_length + 1)
+                continue;
+            line = strtoul(&output->content[i + filename_length + 1], 0, 10);
+            for (k = 0; k < count; ++k) {
+                if (lines[k] == line)
+                    break;
+            }
+            if ((k == count) && (count < max_lines))
+                lines[count++] = line;
+            break;
+        }
+    }
+    return count;
 }
 
-cdetect_report_t
-cdetect_function_check_library(const char *function,
-                               const char *library)
+/*
+ * Compile one batch of range tests
+ *
+ * On success, @p hit is the index of the range holding the value, or -1 if
+ * the value is outside all ranges. Returns false if the failure cannot be
+ * attributed to a single range. @p is_invalid is set if the expression (or
+ * the headers) do not compile at all.
+ */
+
+cdetect_bool_t
+cdetect_compute_batch(const char *expression,
+                      cdetect_string_t prologue,
+                      unsigned long prologue_lines,
+                      const long *first,
+                      const long *last,
+                      int count,
+                      int *hit,
+                      cdetect_bool_t *is_invalid)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t library_name;
+    cdetect_bool_t success;
     cdetect_string_t sourcecode;
     cdetect_string_t compile_flags;
     cdetect_string_t link_flags;
+    cdetect_string_t source_file;
+    cdetect_string_t sign;
+    cdetect_string_t low;
+    cdetect_string_t high;
+    cdetect_string_t work;
     cdetect_string_t result = 0;
+    unsigned long lines[4];
+    size_t offset;
+    int found;
+    int i;
 
-    assert((library == 0) || (library[0] != 0)); /* Disallow the empty string */
-
-    report = cdetect_function_check_cache(function, library);
-    if (!(report & CDETECT_REPORT_CACHED)) {
-
-        /* FIXME: Is both library_name and link_flags necessary? */
-        if ((library == 0) || (library[0] == 0)) {
-            library_name = cdetect_string_format("");
+    *hit = -1;
+    *is_invalid = CDETECT_FALSE;
+
+    /* The line below the prologue checks that the expression is constant */
+    sourcecode = cdetect_string_format("%^stypedef char cdetect_compute_valid[((%s) != 0) + 1];\n",
+                                       prologue, expression);
+    for (i = 0; i < count; ++i) {
+        /* Negative ranges must not match unsigned expressions */
+        sign = (last[i] < 0)
+            ? cdetect_string_format("((%s) < 0) && ", expression)
+            : cdetect_string_format("");
+        low = cdetect_compute_constant(first[i]);
+        high = cdetect_compute_constant(last[i]);
+        if (first[i] == last[i]) {
+            work = cdetect_string_format("typedef char cdetect_compute_%d[(%^s((%s) == %^s)) ? -1 : 1];\n",
+                                         i,
+                                         sign,
+                                         expression,
+                                         low);
         } else {
-            library_name = cdetect_string_format(cdetect_format_library, library);
+            work = cdetect_string_format("typedef char cdetect_compute_%d[(%^s((%s) >= %^s) && ((%s) <= %^s)) ? -1 : 1];\n",
+                                         i,
+                                         sign,
+                                         expression,
+                                         low,
+                                         expression,
+                                         high);
         }
-
-        sourcecode = cdetect_string_format("#ifdef __cplusplus\nextern \"C\"\n#endif\nchar %s();\nint main(void) {%s(); return 0;}\n",
-                                           function, function);
-
-        compile_flags = cdetect_string_format("");
-        link_flags = cdetect_string_format("%^s", library_name);
-
-        report = (cdetect_compile_source(sourcecode,
-                                         compile_flags,
-                                         link_flags,
-                                         0,
-                                         CDETECT_FALSE,
-                                         CDETECT_FALSE,
-                                         &result))
-            ? CDETECT_REPORT_FOUND
-            : CDETECT_REPORT_NULL;
-
-        cdetect_string_destroy(result);
-        cdetect_string_destroy(link_flags);
-        cdetect_string_destroy(compile_flags);
-        cdetect_string_destroy(sourcecode);
-        cdetect_string_destroy(library_name);
+        (void)cdetect_string_append(sourcecode, work->content);
+        cdetect_string_destroy(work);
+        cdetect_string_destroy(high);
+        cdetect_string_destroy(low);
+        cdetect_string_destroy(sign);
     }
-    return report;
-}
-
-/**
-   Check for the existence of a given function in a given library.
-
-   @param function The function to be examined.
-   @param library Name of library in which the function resides.
-   @return True (non-zero) if the function was found, false (zero) otherwise.
-*/
+    (void)cdetect_string_append(sourcecode, "int main(void) { return 0; }\n");
 
-int
-config_function_check_library(const char *function,
-                              const char *library)
-{
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t message;
-
-    cdetect_log("config_function_check_library(function = %'s, library = %'s)\n",
-                function, library);
-
-    if (function) {
-
-        if ((library) && (library[0] == 0))
-            library = 0;
-
-        message = cdetect_string_format( (library == 0) ? "%s()" : "%s() in library %s",
-                                         function,
-                                         library);
+    compile_flags = cdetect_string_format("");
+    link_flags = cdetect_string_format("");
 
-        report = cdetect_function_check_library(function, library);
-        cdetect_report_bool(message->content, report);
-        cdetect_function_define(function, library, report);
-        if (library) {
-            /* If the function was found in a library, define this library as well */
-            cdetect_library_define(library, report);
+    success = cdetect_compile_source(sourcecode,
+                                     compile_flags,
+                                     link_flags,
+                                     0,
+                                     CDETECT_FALSE,
+                                     CDETECT_FALSE,
+                                     &result);
+    if (!success) {
+        /* Compiler messages may omit the directory */
+        source_file = cdetect_string_format("%s%s",
+                                            cdetect_file_execute,
+                                            cdetect_suffix_source);
+        offset = cdetect_string_find_last_char(source_file, 0, '/');
+        if (offset == source_file->length)
+            offset = cdetect_string_find_last_char(source_file, 0, cdetect_path_separator);
+        offset = (offset == source_file->length) ? 0 : offset + 1;
+
+        found = result
+            ? cdetect_compute_error_lines(result,
+                                          &source_file->content[offset],
+                                          lines,
+                                          sizeof(lines) / sizeof(lines[0]))
+            : 0;
+
+        for (i = 0; i < found; ++i) {
+            if (lines[i] <= prologue_lines + 1)
+                *is_invalid = CDETECT_TRUE;
         }
-
-        cdetect_string_destroy(message);
+        if (*is_invalid) {
+            cdetect_log("cdetect_compute_batch(%'s) invalid expression\n", expression);
+        } else if ((found == 1) &&
+                   (lines[0] >= prologue_lines + 2) &&
+                   (lines[0] < prologue_lines + 2 + (unsigned long)count)) {
+            *hit = (int)(lines[0] - prologue_lines - 2);
+            success = CDETECT_TRUE;
+        }
+        cdetect_string_destroy(source_file);
     }
-    return (report & CDETECT_REPORT_FOUND);
-}
-
-/* FIXME: Documentation */
 
-int
-config_function_check(const char *function)
-{
-    return config_function_check_library(function, 0);
-}
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(sourcecode);
 
-int
-config_function_register_format(const char *format)
-{
-    cdetect_string_destroy(cdetect_function_format);
-    cdetect_function_format = cdetect_string_format("%s", format);
-    return (cdetect_function_format != 0);
+    return success;
 }
 
-/*************************************************************************
- *
- * Detect Headers
- *
- ************************************************************************/
-
 /*
- * Define a header macro
+ * Find value by testing one range per compilation
+ *
+ * Used if the compiler output cannot be attributed to individual lines.
  */
 
-void
-cdetect_header_define(const char *header,
-                      cdetect_report_t found)
-{
-    (void)cdetect_map_remember(cdetect_header_map,
-                               header,
-                               (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+cdetect_bool_t
+cdetect_compute_serial_range(const char *expression,
+                             cdetect_string_t prologue,
+                             unsigned long prologue_lines,
+                             long first,
+                             long last)
+{
+    cdetect_bool_t is_invalid;
+    int hit;
+
+    /* Any failure means that the value is in the range */
+    if (!cdetect_compute_batch(expression, prologue, prologue_lines,
+                               &first, &last, 1, &hit, &is_invalid))
+        return CDETECT_TRUE;
+    return (hit == 0) ? CDETECT_TRUE : CDETECT_FALSE;
 }
 
-/* FIXME: Documentation */
+cdetect_bool_t
+cdetect_compute_serial(const char *expression,
+                       cdetect_string_t prologue,
+                       unsigned long prologue_lines,
+                       long *value)
+{
+    long first;
+    long last;
+    long middle;
+    int hit;
+    cdetect_bool_t is_invalid;
+
+    /* Validate expression */
+    if (!cdetect_compute_batch(expression, prologue, prologue_lines,
+                               0, 0, 0, &hit, &is_invalid))
+        return CDETECT_FALSE;
 
-void
-config_header_define(const char *header,
-                     int found)
-{
-    cdetect_header_define(header, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    /* Determine sign */
+    if (cdetect_compute_serial_range(expression, prologue, prologue_lines, LONG_MIN, -1)) {
+        first = LONG_MIN;
+        last = -1;
+    } else {
+        first = 0;
+        last = LONG_MAX;
+    }
+
+    while (first < last) {
+        middle = first + (long)(((unsigned long)last - (unsigned long)first) / 2);
+        if (cdetect_compute_serial_range(expression, prologue, prologue_lines, first, middle))
+            last = middle;
+        else
+            first = middle + 1;
+    }
+
+    /* Values above LONG_MAX end up here as well */
+    if (!cdetect_compute_serial_range(expression, prologue, prologue_lines, first, first))
+        return CDETECT_FALSE;
+
+    *value = first;
+    return CDETECT_TRUE;
 }
 
 /*
- * Check if a header exists
+ * Find value of integer constant expression
  */
 
-cdetect_report_t
-cdetect_header_check(const char *header, const char *dependencies)
+cdetect_bool_t
+cdetect_compute_int(const char *expression,
+                    const char *headers,
+                    long *value)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_map_element_t element;
-    cdetect_string_t preclude;
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_bool_t is_invalid = CDETECT_FALSE;
+    cdetect_string_t prologue;
     cdetect_string_t current;
     cdetect_string_t rest;
     cdetect_string_t work;
-    cdetect_string_t sourcecode;
-    cdetect_string_t compile_flags;
-    cdetect_string_t link_flags;
-    cdetect_string_t result = 0;
-
-    element = cdetect_map_lookup(cdetect_header_map, header);
-    if (element && element->data) {
-        if (cdetect_strequal((const char *)element->data, "1")) {
-            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
-        } else {
-            report = CDETECT_REPORT_CACHED;
-        }
-
-    } else {
+    unsigned long prologue_lines = 0;
+    unsigned long span;
+    unsigned long step;
+    long first[CDETECT_COMPUTE_BATCH];
+    long last[CDETECT_COMPUTE_BATCH];
+    long low;
+    long high;
+    long bound;
+    int count;
+    int hit;
+    int i;
 
-        /* Build list of prerequisite headers */
-        preclude = cdetect_string_create();
-        if (dependencies) {
-
-            current = cdetect_string_format("%s", dependencies);
-            while (current) {
-                rest = cdetect_string_split(current, cdetect_header_separator);
-                if (cdetect_header_check(current->content, rest ? rest->content : 0)) {
-                    cdetect_header_define(current->content, CDETECT_REPORT_FOUND);
-                    work = cdetect_string_format("#include <%^s>\n", current);
-                    (void)cdetect_string_append(preclude, work->content);
-                    cdetect_string_destroy(work);
-                }
-                cdetect_string_destroy(current);
-                current = rest;
+    /* Build list of headers */
+    prologue = cdetect_string_create();
+    (void)cdetect_string_append(prologue, "");
+    if (headers) {
+        current = cdetect_string_format("%s", headers);
+        while (current) {
+            rest = cdetect_string_split(current, cdetect_header_separator);
+            if (current->length > 0) {
+                work = cdetect_string_format("#include <%^s>\n", current);
+                (void)cdetect_string_append(prologue, work->content);
+                cdetect_string_destroy(work);
+                ++prologue_lines;
             }
+            cdetect_string_destroy(current);
+            current = rest;
         }
+    }
 
-        /* Examine if header file exists */
-        sourcecode = cdetect_string_format("%^s#include <%s>\nint main(void) { return 0;}\n",
-                                           preclude, header);
+    /* First round: ranges of exponentially increasing size on either side of zero */
+    count = 0;
+    for (bound = 0; ; bound = 2 * bound + 1) {
+        first[count] = (bound == 0) ? 0 : (bound - 1) / 2 + 1;
+        last[count] = bound;
+        ++count;
+        first[count] = -bound - 1;
+        last[count] = (bound == 0) ? -1 : -((bound - 1) / 2) - 2;
+        ++count;
+        if (bound == LONG_MAX)
+            break;
+    }
 
-        compile_flags = cdetect_string_format("");
-        link_flags = cdetect_string_format("");
+    if (cdetect_compute_batch(expression, prologue, prologue_lines,
+                              first, last, count, &hit, &is_invalid)) {
+        if (hit >= 0) {
+            low = first[hit];
+            high = last[hit];
 
-        report = (cdetect_compile_source(sourcecode,
-                                         compile_flags,
-                                         link_flags,
-                                         0,
-                                         CDETECT_FALSE,
-                                         CDETECT_FALSE,
-                                         &result))
-            ? CDETECT_REPORT_FOUND
-            : CDETECT_REPORT_NULL;
+            /* Further rounds: split the remaining range evenly */
+            while (low < high) {
+                span = (unsigned long)high - (unsigned long)low;
+                if (span < CDETECT_COMPUTE_BATCH) {
+                    step = 1;
+                    count = (int)span + 1;
+                } else {
+                    step = span / CDETECT_COMPUTE_BATCH + 1;
+                    count = (int)(span / step) + 1;
+                }
+                for (i = 0; i < count; ++i) {
+                    first[i] = (long)((unsigned long)low + (unsigned long)i * step);
+                    last[i] = (i == count - 1)
+                        ? high
+                        : (long)((unsigned long)first[i] + step - 1);
+                }
+                if (!cdetect_compute_batch(expression, prologue, prologue_lines,
+                                           first, last, count, &hit, &is_invalid) ||
+                    (hit < 0))
+                    break;
+                low = first[hit];
+                high = last[hit];
+            }
 
-        cdetect_string_destroy(result);
-        cdetect_string_destroy(link_flags);
-        cdetect_string_destroy(compile_flags);
-        cdetect_string_destroy(sourcecode);
-        cdetect_string_destroy(preclude);
+            if (low == high) {
+                /* Confirm */
+                (void)cdetect_compute_batch(expression, prologue, prologue_lines,
+                                            &low, &high, 1, &hit, &is_invalid);
+                if (hit == 0) {
+                    *value = low;
+                    success = CDETECT_TRUE;
+                }
+            }
+        }
+    } else if (!is_invalid) {
+        cdetect_log("cdetect_compute_int(%'s) cannot attribute errors\n", expression);
+        success = cdetect_compute_serial(expression, prologue, prologue_lines, value);
     }
 
-    return report;
+    cdetect_string_destroy(prologue);
+
+    return success;
 }
 
 /**
-   Check for the existence of a given header file.
+   Compute the value of an integer constant expression.
 
-   @param header The header file to be examined.
-   @return True (non-zero) if the header was found, false (zero) otherwise.
+   The value is found by compilation only, so it works for cross-compilers
+   without @c --remote execution.
+
+   @code
+   long size;
+   if (config_compute_int("sizeof(long)", 0, &size) && (size == 8))
+       config_macro_define("HAVE_64BIT_LONG", "1");
+   config_compute_int("PIPE_BUF", "limits.h", &size);
+   @endcode
+
+   @param expression Integer constant expression.
+   @param headers Comma-separated list of header files needed to compile the
+   expression. Can be zero (0).
+   @param value Output parameter with the value of the expression.
+   @return Boolean indicating whether the value could be computed. The value
+   must be representable as a long on both the host and the target.
 */
 
 int
-config_header_check(const char *header)
+config_compute_int(const char *expression,
+                   const char *headers,
+                   long *value)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t message;
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_bool_t is_cached = CDETECT_FALSE;
+    cdetect_map_element_t element;
+    cdetect_string_t work;
 
-    cdetect_log("config_header_check(header = %'s)\n", header);
+    cdetect_log("config_compute_int(expression = %'s, headers = %'s)\n",
+                expression, headers);
 
-    if (header) {
-        report = cdetect_header_check(header, 0);
-        message = cdetect_string_format("<%s>", header);
-        cdetect_report_bool(message->content, report);
-        cdetect_header_define(header, report);
+    assert(value != 0);
 
-        cdetect_string_destroy(message);
+    if (expression) {
+        element = cdetect_map_lookup_context(cdetect_integer_map, headers, expression);
+        if (element && element->data) {
+            *value = strtol((const char *)element->data, 0, 10);
+            success = CDETECT_TRUE;
+            is_cached = CDETECT_TRUE;
+        } else {
+            success = cdetect_compute_int(expression, headers, value);
+            if (success) {
+                work = cdetect_string_format("%ld", *value);
+                (void)cdetect_map_remember_context(cdetect_integer_map,
+                                                   headers,
+                                                   expression,
+                                                   work->content);
+                cdetect_string_destroy(work);
+            }
+        }
+
+        if (success) {
+            cdetect_output("checking value of %s... %ld%s\n",
+                           expression,
+                           *value,
+                           is_cached ? " (cached)" : "");
+        } else {
+            cdetect_output("checking value of %s... unknown\n", expression);
+        }
+        work = cdetect_string_format("value of %s", expression);
+        cdetect_trace_check(work->content,
+                            (cdetect_report_t)((success ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL) |
+                                               (is_cached ? CDETECT_REPORT_CACHED : CDETECT_REPORT_NULL)));
+        cdetect_string_destroy(work);
     }
-    return (report & CDETECT_REPORT_FOUND);
+    return success;
 }
 
-int
-config_header_check_depend(const char *header,
-                           const char *dependencies)
-{
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t message;
+/*************************************************************************
+ *
+ * Detect Tools
+ *
+ ************************************************************************/
 
-    cdetect_log("config_header_check_depend(header = %'s, dependencies = %'s)\n",
-                header, dependencies);
+/*
+ * Define a tool macro
+ */
 
-    if (header) {
-        report = cdetect_header_check(header, dependencies);
-        message = cdetect_string_format("<%s>", header);
-        cdetect_report_bool(message->content, report);
-        cdetect_header_define(header, report);
+void
+cdetect_tool_define(const char *variable,
+                    const char *value)
+{
+    cdetect_string_t work;
+    cdetect_string_t target = 0;
 
-        cdetect_string_destroy(message);
+    work = cdetect_string_format("%s", value);
+    if (!cdetect_substitute_string(work, &target)) {
+        target = work;
+        work = 0;
     }
-    return (report & CDETECT_REPORT_FOUND);
+    (void)cdetect_map_remember(cdetect_tool_map, variable, target->content);
+
+    cdetect_string_destroy(work);
+    cdetect_string_destroy(target);
 }
 
 /* FIXME: Documentation */
 
 int
-config_header_register(const char *target)
+config_tool_define(const char *tool,
+                   const char *value)
 {
-    cdetect_string_destroy(cdetect_include_file);
-    if (target == 0) {
-        cdetect_include_file = 0;
-    } else {
-        cdetect_include_file = cdetect_string_format("%s", target);
-        (void)cdetect_file_remove(cdetect_include_file->content);
-    }
-    return CDETECT_TRUE;
+    cdetect_log("config_tool_define(tool = %'s, value = %'s)\n", tool, value);
+
+    cdetect_tool_define(tool, value);
+    return (int)CDETECT_TRUE;
 }
 
 int
-config_header_register_format(const char *format)
+config_tool_define_bool(const char *tool,
+                        int value)
 {
-    cdetect_string_destroy(cdetect_header_format);
-    cdetect_header_format = cdetect_string_format("%s", format);
-    return (cdetect_header_format != 0);
-}
+    cdetect_log("config_tool_define_bool(tool = %'s, value = %d)\n", tool, value);
 
-/*
- * Save header file
- */
+    cdetect_tool_define(tool, (value ? "1" : "0"));
+    return (int)CDETECT_TRUE;
+}
 
-void
-cdetect_header_save(void)
+int
+config_tool_define_format(const char *tool,
+                          const char *format, ...)
 {
-    cdetect_string_t raw_include_guard = 0;
-    cdetect_string_t include_guard = 0;
+    cdetect_string_t value;
+    va_list arguments;
 
-    if (cdetect_include_file == 0)
-        return;
+    cdetect_log("config_tool_define_format(tool = %'s, format = %'s, ...)\n",
+                tool, format);
 
-    cdetect_log("cdetect_header_save(%'^s)\n", cdetect_include_file);
+    va_start(arguments, format);
+    value = cdetect_string_vformat(format, arguments);
+    va_end(arguments);
+    cdetect_tool_define(tool, value->content);
 
-    cdetect_output("creating %^s\n", cdetect_include_file);
+    cdetect_string_destroy(value);
 
-    cdetect_file_write_after(cdetect_include_file,
-                             "/* Autogenerated by cDetect %d.%d.%d -- http://cdetect.sourceforge.net/ */\n",
-                             CDETECT_VERSION_MAJOR,
-                             CDETECT_VERSION_MINOR,
-                             CDETECT_VERSION_PATCH);
+    return (int)CDETECT_TRUE;
+}
 
-    raw_include_guard = cdetect_string_format("CDETECT_INCLUDE_GUARD_%^s",
-                                              cdetect_include_file);
-    include_guard = cdetect_macro_transform_upper(raw_include_guard);
+/* FIXME: Documentation */
 
-    if (include_guard) {
-        cdetect_file_write_after(cdetect_include_file,
-                                 "#ifndef %^s\n#define %^s\n\n",
-                                 include_guard,
-                                 include_guard);
-    }
+int
+config_tool_define_command(const char *tool,
+                           const char *command, ...)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t cmd;
+    cdetect_string_t result = 0;
+    va_list arguments;
 
-    if (cdetect_is_compiler_checked && cdetect_compiler_name) {
-        cdetect_macro_save_number("CDETECT_COMPILER_%s",
-                                  cdetect_compiler_name->content,
-                                  cdetect_compiler_version);
-    }
-    if (cdetect_is_kernel_checked && cdetect_kernel_name) {
-        cdetect_macro_save_number("CDETECT_KERNEL_%s",
-                                  cdetect_kernel_name->content,
-                                  cdetect_kernel_version);
-    }
-    if (cdetect_is_cpu_checked && cdetect_cpu_name) {
-        cdetect_macro_save_number("CDETECT_CPU_%s",
-                                  cdetect_cpu_name->content,
-                                  cdetect_cpu_version);
+    cdetect_log("config_tool_define_command(tool = %'s, command = %'s, ...)\n",
+                tool, command);
+
+    va_start(arguments, command);
+    cmd = cdetect_string_vformat(command, arguments);
+    va_end(arguments);
+
+    if (cdetect_execute_substitute(cmd, &result, CDETECT_FALSE) && (result != 0)) {
+        cdetect_string_trim(result, "\r\n");
+        cdetect_tool_define(tool, result->content);
+        success = CDETECT_TRUE;
     }
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(cmd);
 
-    cdetect_macro_save_map(cdetect_header_map,
-                           cdetect_header_format->content,
-                           cdetect_macro_filter_false,
-                           cdetect_macro_transform_upper);
-    cdetect_macro_save_map(cdetect_type_map,
-                           cdetect_type_format->content,
-                           cdetect_macro_filter_false,
-                           cdetect_macro_transform_upper);
-    cdetect_macro_save_map(cdetect_function_map,
-                           cdetect_function_format->content,
-                           cdetect_macro_filter_false,
-                           cdetect_macro_transform_upper);
-    cdetect_macro_save_map(cdetect_library_map,
-                           cdetect_library_format->content,
-                           cdetect_macro_filter_false,
-                           cdetect_macro_transform_upper);
-    cdetect_macro_save_map(cdetect_macro_map, "%s", 0, 0);
+    return success;
+}
 
-    if (include_guard) {
-        cdetect_file_write_after(cdetect_include_file,
-                                 "\n#endif /* %^s */\n",
-                                 include_guard);
+/*
+ * Check if a tool exists
+ */
+
+cdetect_bool_t
+cdetect_tool_exist(const char *path)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t filename;
+    cdetect_string_t remainder;
+
+    if (path) {
+        success = cdetect_file_exist(path);
+        if (!success) {
+            filename = cdetect_string_format("%s", path);
+            /* Does not handle quoted spaces in path */
+            remainder = cdetect_string_split(filename, ' ');
+            success = cdetect_file_exist(filename->content);
+            cdetect_string_destroy(remainder);
+            cdetect_string_destroy(filename);
+        }
     }
-    cdetect_string_destroy(include_guard);
-    cdetect_string_destroy(raw_include_guard);
+    return success;
 }
 
-/*************************************************************************
- *
- * Detect Types
+
+/*
+ * Index the content of all directories in the search path
  *
- ************************************************************************/
+ * Every directory is read only once, and each file name is mapped to the
+ * list of directories (in search path order) that contain it. Returns
+ * false if the index is not available on this platform.
+ */
+
+cdetect_bool_t
+cdetect_path_index(void)
+{
+#if defined(CDETECT_HEADER_DIRENT_H)
+    cdetect_map_t visited;
+    cdetect_map_element_t element;
+    cdetect_string_t current;
+    cdetect_string_t rest;
+    cdetect_string_t directories;
+    DIR *directory;
+    struct dirent *entry;
+
+    if (!cdetect_is_path_indexed) {
+        cdetect_is_path_indexed = CDETECT_TRUE;
+        visited = cdetect_map_create(0, 0);
+        current = cdetect_string_format("%s", cdetect_path ? cdetect_path : "");
+        while (current) {
+            rest = cdetect_string_split(current, cdetect_path_list_separator);
+            if ((current->length > 0) &&
+                (cdetect_map_lookup(visited, current->content) == 0)) {
+                cdetect_map_remember(visited, current->content, 0);
+                directory = opendir(current->content);
+                if (directory) {
+                    while ((entry = readdir(directory)) != 0) {
+                        if (entry->d_name[0] == '.')
+                            continue;
+                        element = cdetect_map_lookup(cdetect_path_map, entry->d_name);
+                        if (element) {
+                            directories = cdetect_string_format("%s%c%s",
+                                                                (const char *)element->data,
+                                                                cdetect_path_list_separator,
+                                                                current->content);
+                        } else {
+                            directories = cdetect_string_format("%s", current->content);
+                        }
+                        cdetect_map_remember(cdetect_path_map, entry->d_name, directories->content);
+                        cdetect_string_destroy(directories);
+                    }
+                    closedir(directory);
+                }
+            }
+            cdetect_string_destroy(current);
+            current = rest;
+        }
+        cdetect_map_destroy(visited);
+    }
+    return CDETECT_TRUE;
+#else
+    return CDETECT_FALSE;
+#endif
+}
 
 /*
- * Define a type macro
+ * Check if an indexed file is an executable regular file
  */
 
-void
-cdetect_type_define(const char *type,
-                    const char *header,
-                    cdetect_report_t found)
+cdetect_bool_t
+cdetect_path_executable(const char *filename)
 {
-    assert(type != 0);
+    cdetect_bool_t success = CDETECT_FALSE;
+#if defined(CDETECT_HEADER_DIRENT_H)
+    struct stat status;
 
-    (void)cdetect_map_remember_context(cdetect_type_map,
-                                       header,
-                                       type,
-                                       (found & CDETECT_REPORT_FOUND) ? "1" : "0");
+    if ((stat(filename, &status) == 0) && S_ISREG(status.st_mode)) {
+        success = (access(filename, X_OK) == 0);
+    }
+#else
+    success = cdetect_file_exist(filename);
+#endif
+    return success;
 }
 
-/**
-   Define whether or not a data type exists.
-
-   @param type The name of the data type.
-   @param header The header file that contains the data type. Can be zero (0).
-   @param found Boolean indicating whether or not the type was found.
+const char *
+cdetect_tool_check_with_path(const char *variable,
+                             const char *path,
+                             cdetect_tool_check_filter_t filter,
+                             void *closure)
+{
+    cdetect_map_element_t element = 0;
 
-   @sa config_type_check
-*/
+    assert(path != 0);
+    assert(variable != 0);
 
-void
-config_type_define(const char *type,
-                   const char *header,
-                   int found)
-{
-    cdetect_type_define(type, header, found ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    element = cdetect_map_lookup(cdetect_tool_map, variable);
+    if (element == 0) {
+        if (cdetect_tool_exist(path) && (filter == 0 || filter(path, closure))) {
+            cdetect_tool_define(variable, path);
+            element = cdetect_map_lookup(cdetect_tool_map, variable);
+        }
+    }
+    return (const char *)((element && element->data) ? element->data : 0);
 }
 
 /*
- * Check if a type exists
+ * Check the indexed directories that contain the tool
+ *
+ * The tool may be followed by arguments, which are passed on to the filter.
  */
 
-cdetect_report_t
-cdetect_type_check_cache(const char *type,
-                         const char *header)
+const char *
+cdetect_tool_check_indexed(const char *variable,
+                           const char *tool,
+                           cdetect_tool_check_filter_t filter,
+                           void *closure)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
+    const char *result = 0;
     cdetect_map_element_t element;
+    cdetect_string_t name;
+    cdetect_string_t arguments;
+    cdetect_string_t current;
+    cdetect_string_t rest;
+    cdetect_string_t candidate;
 
-    element = cdetect_map_lookup_context(cdetect_type_map, header, type);
-    if (element && element->data) {
-        if (cdetect_strequal((const char *)element->data, "1")) {
-            report = (cdetect_report_t)(CDETECT_REPORT_FOUND | CDETECT_REPORT_CACHED);
-        } else {
-            report = CDETECT_REPORT_CACHED;
+    name = cdetect_string_format("%s", tool);
+    arguments = cdetect_string_split(name, ' ');
+    element = cdetect_map_lookup(cdetect_path_map, name->content);
+    if (element) {
+        current = cdetect_string_format("%s", (const char *)element->data);
+        while (current) {
+            rest = cdetect_string_split(current, cdetect_path_list_separator);
+            if (result == 0) {
+                candidate = cdetect_string_format("%s%c%s",
+                                                  current->content,
+                                                  cdetect_path_separator,
+                                                  name->content);
+                if (cdetect_path_executable(candidate->content)) {
+                    cdetect_string_append_path(current, tool);
+                    result = cdetect_tool_check_with_path(variable, current->content, filter, closure);
+                }
+                cdetect_string_destroy(candidate);
+            }
+            cdetect_string_destroy(current);
+            current = rest;
         }
     }
-
-    return report;
+    cdetect_string_destroy(arguments);
+    cdetect_string_destroy(name);
+    return result;
 }
 
-cdetect_report_t
-cdetect_type_check_header(const char *type,
-                          const char *header)
+const char *
+cdetect_tool_check(const char *variable,
+                   const char *tool,
+                   cdetect_tool_check_filter_t filter,
+                   void *closure)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t sourcecode;
-    cdetect_string_t compile_flags;
-    cdetect_string_t link_flags;
-    cdetect_string_t result = 0;
+    const char *result = 0;
+    cdetect_map_element_t element;
+    cdetect_string_t current;
+    cdetect_string_t rest;
+    cdetect_bool_t keep_trying = CDETECT_TRUE;
 
-    report = cdetect_type_check_cache(type, header);
-    if (!(report & CDETECT_REPORT_CACHED)) {
+    if (tool == 0) {
+        /* Nothing to check */
 
-        if (header) {
-            sourcecode = cdetect_string_format("#include <%s>\nint main(void) { int size;\nsize = sizeof(%s);\nreturn 0;}\n",
-                                               header, type);
+    } else if ((strchr(tool, cdetect_path_separator) == 0) && cdetect_path_index()) {
+        /* Only visit directories known to contain the tool */
+        element = cdetect_map_lookup(cdetect_tool_map, variable);
+        if (element) {
+            result = (const char *)element->data;
         } else {
-            sourcecode = cdetect_string_format("int main(void) { int size;\nsize = sizeof(%s);\nreturn 0;}\n",
-                                               type);
+            result = cdetect_tool_check_indexed(variable, tool, filter, closure);
         }
 
-        compile_flags = cdetect_string_format("");
-        link_flags = cdetect_string_format("");
+    } else {
 
-        report = (cdetect_compile_source(sourcecode,
-                                         compile_flags,
-                                         link_flags,
-                                         0,
-                                         CDETECT_FALSE,
-                                         CDETECT_FALSE,
-                                         &result))
-            ? CDETECT_REPORT_FOUND
-            : CDETECT_REPORT_NULL;
+        current = cdetect_string_format("%s", cdetect_path);
+        do {
+            rest = cdetect_string_split(current, cdetect_path_list_separator);
 
-		cdetect_log(">>> BEGIN OF SOURCE\n");
-		cdetect_log("%s\n",sourcecode->content);
-		cdetect_log(">>> END OF SOURCE\n");
-		cdetect_log(">>> BEGIN OF OUTPUT\n");
-		cdetect_log("%s\n",result->content);
-		cdetect_log(">>> END OF OUTPUT\n");
+            if (!cdetect_string_append_path(current, tool))
+                keep_trying = CDETECT_FALSE;
 
-        cdetect_string_destroy(result);
-        cdetect_string_destroy(link_flags);
-        cdetect_string_destroy(compile_flags);
-        cdetect_string_destroy(sourcecode);
+            result = cdetect_tool_check_with_path(variable, current->content, filter, closure);
+            if (result) {
+                keep_trying = CDETECT_FALSE;
+            } else if (rest == 0) {
+                keep_trying = CDETECT_FALSE;
+            }
+
+            cdetect_string_destroy(current);
+            current = rest;
+        } while (keep_trying);
+
+        cdetect_string_destroy(rest);
     }
 
-    return report;
+    return result;
 }
 
-/**
-   Check for the existence of a given data type in a header file.
+/* FIXME: Documentation */
 
-   @param type Data type to be examined.
-   @param header Header file in which @p type may exist.
-   @return True (non-zero) if the type was found, false (zero) otherwise.
+const char *
+config_tool_get(const char *tool)
+{
+    cdetect_map_element_t element;
 
-   Macros for both the data type and the header are added to config.h if the
-   data type exists.
+    if ( (tool == 0) || (cdetect_tool_map == 0) ) {
+        return 0;
+    }
 
-   Example: Check if int64_t is located in <stddef.h> or <inttypes.h>
+    element = cdetect_map_lookup(cdetect_tool_map, tool);
+    return (element == 0)
+        ? 0
+        : (const char *)element->data;
+}
 
-   @code
-   config_type_check_header("int64_t", "stddef.h")
-       || config_type_check_header("int64_t", "inttypes.h");
-   @endcode
+/* FIXME: Documentation */
 
-   which may result in
+const char *
+config_tool_check_filter(const char *variable,
+                         const char *tool,
+                         config_tool_check_filter_t filter,
+                         void *closure)
+{
+    cdetect_string_t message;
+    const char *result = 0;
 
-   @code
-   #define CDETECT_HEADER_INTTYPES_H 1
-   #define CDETECT_TYPE_INT64_T 1
-   @endcode
-*/
+    cdetect_log("config_tool_check_filter(variable = %'s, tool = %'s)\n",
+                variable, tool);
 
-int
-config_type_check_header(const char *type,
-                         const char *header)
+    result = cdetect_tool_check(variable, tool, (cdetect_tool_check_filter_t)filter, closure);
+    message = cdetect_string_format("tool %s", tool);
+    config_report_string(message->content, result ? result : "no");
+    cdetect_string_destroy(message);
+
+    return result;
+}
+
+/* FIXME: Documentation */
+
+const char *
+config_tool_check(const char *variable,
+                  const char *tool)
 {
-    cdetect_report_t report = CDETECT_REPORT_NULL;
-    cdetect_string_t message;
+    return config_tool_check_filter(variable, tool, 0, 0);
+}
 
-    cdetect_log("config_type_check_header(type = %'s, header = %'s)\n",
-                type, header);
+/*************************************************************************
+ *
+ * Detect Compiler
+ *
+ ************************************************************************/
 
-    if (type) {
+/*
+ * Check if compilation works
+ */
 
-        if ((header) && (header[0] == 0))
-            header = 0;
+cdetect_bool_t
+cdetect_check_compilation_filter(const char *command, void *userdata)
+{
+    cdetect_bool_t success;
+    const char *arguments;
+    char *backup;
+    cdetect_string_t sourcecode;
+    cdetect_string_t result;
 
-        report = cdetect_type_check_header(type, header);
+    arguments = (const char *)userdata;
 
-        message = cdetect_string_format( (header == 0) ? "type %s" : "type %s in <%s>",
-                                         type,
-                                         header);
-        cdetect_report_bool(message->content, report);
-        cdetect_type_define(type, header, report);
-        if (header) {
-            /* If the type was found in a header, define this header as well */
-            cdetect_header_define(header, report);
-        }
+    /* Workaround is needed because cdetect_command_compile is global */
+    backup = cdetect_command_compile;
+    cdetect_command_compile = (char *)command;
 
-        cdetect_string_destroy(message);
+    sourcecode = cdetect_string_format("int main(void) { return 0;}\n");
+
+    success = cdetect_compile_source(sourcecode,
+                                     0,
+                                     0,
+                                     0,
+                                     CDETECT_TRUE,
+                                     CDETECT_FALSE,
+                                     &result);
+
+    cdetect_command_compile = backup;
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(sourcecode);
+
+    return success;
+}
+
+const char *
+cdetect_check_compilation_single(const char *envar,
+                                 const char *command,
+                                 const char *arguments)
+{
+    cdetect_string_t compiler;
+    const char *result = 0;
+
+    compiler = cdetect_string_format("%s%s", command, cdetect_suffix_execute);
+    if (compiler) {
+        result = cdetect_tool_check_with_path(envar,
+                                              compiler->content,
+                                              cdetect_check_compilation_filter,
+                                              (void *)arguments);
+        if (result == 0) {
+            result = cdetect_tool_check(envar,
+                                        compiler->content,
+                                        cdetect_check_compilation_filter,
+                                        (void *)arguments);
+        }
+        cdetect_string_destroy(compiler);
     }
-    return (report & CDETECT_REPORT_FOUND);
+    return result;
 }
 
-/**
-   Check for the existence of a given data type.
+/*
+ * Find the compiler table entry matching a compiler command
+ *
+ * The entry is matched against the base name of the executable, which may
+ * carry a cross-compilation prefix (e.g. arm-linux-gnueabi-gcc).
+ */
 
-   @param type Data type to be examined.
-   @return Boolean indicating if the data type was found.
+int
+cdetect_check_compilation_entry(const char *command,
+                                const char *compilers[][CDETECT_COMPILER_COLUMNS])
+{
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    size_t first;
+    size_t last;
+    size_t length;
+    int current;
+    int result = -1;
 
-   @sa config_type_check_header
+    executable = cdetect_string_format("%s", command);
+    remainder = cdetect_string_split(executable, ' ');
 
-   A macro for the data type is added to config.h if the data type exists.
+    last = executable->length;
+    length = strlen(cdetect_suffix_execute);
+    if ((length > 0) && (last > length) &&
+        cdetect_strequal(&executable->content[last - length], cdetect_suffix_execute)) {
+        last -= length;
+    }
+    for (first = last; first > 0; --first) {
+        if ((executable->content[first - 1] == cdetect_path_separator) ||
+            (executable->content[first - 1] == '/')) {
+            break;
+        }
+    }
 
-   Example: Check for support of long long and __int64
+    for (current = 0; compilers[current][CDETECT_COMPILER_NAME] != 0; ++current) {
+        length = strlen(compilers[current][CDETECT_COMPILER_NAME]);
+        if ((length > last - first) ||
+            !cdetect_strequal_max(&executable->content[last - length],
+                                  length,
+                                  compilers[current][CDETECT_COMPILER_NAME]))
+            continue;
+        /* Either the whole name or a prefix ending with a dash */
+        if ((length == last - first) || (executable->content[last - length - 1] == '-')) {
+            result = current;
+            break;
+        }
+    }
 
-   @code
-   config_type_check("long long");
-   config_type_check("__int64");
-   @endcode
+    cdetect_string_destroy(remainder);
+    cdetect_string_destroy(executable);
 
-   which may result in
+    return result;
+}
 
-   @code
-   #define CDETECT_TYPE_LONG_LONG 1
-   #define CDETECT_TYPE___INT64 1
-   @endcode
-*/
+/*
+ * Calculate the cache key of a compiler table
+ *
+ * The key covers the settings that may change which compiler is chosen. The
+ * chosen compiler executable itself is checked by its file status.
+ */
 
-int
-config_type_check(const char *type)
+cdetect_string_t
+cdetect_check_compilation_key(const char *envar,
+                              const char *compilers[][CDETECT_COMPILER_COLUMNS])
 {
-    return config_type_check_header(type, 0);
-}
+    unsigned int hash;
+    int current;
 
-int
-config_type_register_format(const char *format)
-{
-    cdetect_string_destroy(cdetect_type_format);
-    cdetect_type_format = cdetect_string_format("%s", format);
-    return (cdetect_type_format != 0);
+    hash = cdetect_hash_string(cdetect_path, 0);
+    hash = cdetect_hash_string(cdetect_argument_cflags, hash);
+    for (current = 0; compilers[current][CDETECT_COMPILER_NAME] != 0; ++current) {
+        hash = cdetect_hash_string(compilers[current][CDETECT_COMPILER_NAME], hash);
+    }
+    return cdetect_string_format("%s.%x", envar, hash);
 }
 
-/*************************************************************************
- *
- * Detect Tools
- *
- ************************************************************************/
-
 /*
- * Define a tool macro
+ * Use the cached compiler if its executable has not changed
+ *
+ * The cached value is the file stamp of the executable followed by the
+ * compiler command.
  */
 
-void
-cdetect_tool_define(const char *variable,
-                    const char *value)
+const char *
+cdetect_check_compilation_cached(const char *envar,
+                                 const char *key)
 {
-    cdetect_string_t work;
-    cdetect_string_t target = 0;
+    const char *result = 0;
+    cdetect_map_element_t element;
+    cdetect_string_t stamp;
+    cdetect_string_t command;
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    cdetect_string_t current_stamp;
 
-    work = cdetect_string_format("%s", value);
-    if (!cdetect_substitute_string(work, &target)) {
-        target = work;
-        work = 0;
+    element = cdetect_map_lookup(cdetect_compiler_map, key);
+    if (element && element->data) {
+        stamp = cdetect_string_format("%s", (const char *)element->data);
+        command = cdetect_string_split(stamp, ' ');
+        if (command) {
+            /* Does not handle quoted spaces in path */
+            executable = cdetect_string_format("%s", command->content);
+            remainder = cdetect_string_split(executable, ' ');
+            current_stamp = cdetect_file_stamp(executable->content);
+            if (current_stamp && cdetect_strequal(current_stamp->content, stamp->content)) {
+                cdetect_log("cdetect_check_compilation() cached\n");
+                cdetect_tool_define(envar, command->content);
+                result = config_tool_get(envar);
+            }
+            cdetect_string_destroy(current_stamp);
+            cdetect_string_destroy(remainder);
+            cdetect_string_destroy(executable);
+            cdetect_string_destroy(command);
+        }
+        cdetect_string_destroy(stamp);
     }
-    (void)cdetect_map_remember(cdetect_tool_map, variable, target->content);
-
-    cdetect_string_destroy(work);
-    cdetect_string_destroy(target);
+    return result;
 }
 
-/* FIXME: Documentation */
+/*
+ * Store the chosen compiler in the cache
+ */
 
-int
-config_tool_define(const char *tool,
-                   const char *value)
+void
+cdetect_check_compilation_remember(const char *key,
+                                   const char *command)
 {
-    cdetect_log("config_tool_define(tool = %'s, value = %'s)\n", tool, value);
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    cdetect_string_t stamp;
+    cdetect_string_t value;
 
-    cdetect_tool_define(tool, value);
-    return (int)CDETECT_TRUE;
+    executable = cdetect_string_format("%s", command);
+    remainder = cdetect_string_split(executable, ' ');
+    stamp = cdetect_file_stamp(executable->content);
+    if (stamp) {
+        value = cdetect_string_format("%^s %s", stamp, command);
+        (void)cdetect_map_remember(cdetect_compiler_map, key, value->content);
+        cdetect_string_destroy(value);
+    }
+    cdetect_string_destroy(stamp);
+    cdetect_string_destroy(remainder);
+    cdetect_string_destroy(executable);
 }
 
-int
-config_tool_define_bool(const char *tool,
-                        int value)
-{
-    cdetect_log("config_tool_define_bool(tool = %'s, value = %d)\n", tool, value);
-
-    cdetect_tool_define(tool, (value ? "1" : "0"));
-    return (int)CDETECT_TRUE;
-}
+/*
+ * Probe all compilers of a compiler table
+ *
+ * Each candidate is checked concurrently by a child process in its own
+ * scratch directory, so that their temporary files do not collide. The
+ * outcome is the same as checking the candidates in order: the first
+ * working compiler in the table is chosen, and the remaining children are
+ * stopped as soon as that is known.
+ */
 
-int
-config_tool_define_format(const char *tool,
-                          const char *format, ...)
+const char *
+cdetect_check_compilation_probe(const char *envar,
+                                const char *compilers[][CDETECT_COMPILER_COLUMNS])
 {
-    cdetect_string_t value;
-    va_list arguments;
+    const char *result = 0;
+    int current;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_string_t directory;
+    cdetect_string_t output;
+    long *process;
+    int *channel;
+    int count;
 
-    cdetect_log("config_tool_define_format(tool = %'s, format = %'s, ...)\n",
-                tool, format);
+    for (count = 0; compilers[count][CDETECT_COMPILER_NAME] != 0; ++count)
+        continue;
 
-    va_start(arguments, format);
-    value = cdetect_string_vformat(format, arguments);
-    va_end(arguments);
-    cdetect_tool_define(tool, value->content);
+    process = (long *)cdetect_allocate((count + 1) * sizeof(*process));
+    channel = (int *)cdetect_allocate((count + 1) * sizeof(*channel));
+
+    /* Build the search path index once for all children */
+    (void)cdetect_path_index();
+
+    for (current = 0; current < count; ++current) {
+        process[current] = cdetect_process_fork(&channel[current]);
+        if (process[current] == 0) {
+            /* Child process */
+            directory = cdetect_string_format("%sj%d", cdetect_file_execute, current);
+            if (cdetect_directory_create(directory->content) &&
+                (chdir(directory->content) == 0)) {
+                result = cdetect_check_compilation_single(envar,
+                                                          compilers[current][CDETECT_COMPILER_NAME],
+                                                          compilers[current][CDETECT_COMPILER_ARGUMENTS]);
+                if (result) {
+                    (void)write(channel[current], result, strlen(result));
+                }
+            }
+            cdetect_process_exit(channel[current], (result == 0));
+        }
+    }
 
-    cdetect_string_destroy(value);
+    for (current = 0; current < count; ++current) {
+        if (process[current] < 0) {
+            /* Could not fork, so check it here */
+            if (result == 0) {
+                result = cdetect_check_compilation_single(envar,
+                                                          compilers[current][CDETECT_COMPILER_NAME],
+                                                          compilers[current][CDETECT_COMPILER_ARGUMENTS]);
+            }
+            continue;
+        }
+        if (result) {
+            /* A compiler earlier in the table works */
+            (void)close(channel[current]);
+            cdetect_process_kill(process[current]);
+        } else {
+            output = cdetect_process_read(channel[current]);
+            if ((cdetect_process_wait(process[current]) == 0) && (output->length > 0)) {
+                cdetect_tool_define(envar, output->content);
+                result = config_tool_get(envar);
+            }
+            cdetect_string_destroy(output);
+        }
+        directory = cdetect_string_format("%sj%d", cdetect_file_execute, current);
+        (void)cdetect_directory_remove(directory->content);
+        cdetect_string_destroy(directory);
+    }
 
-    return (int)CDETECT_TRUE;
+    cdetect_free(channel);
+    cdetect_free(process);
+#else
+    for (current = 0; compilers[current][CDETECT_COMPILER_NAME] != 0; ++current) {
+        result = cdetect_check_compilation_single(envar,
+                                                  compilers[current][CDETECT_COMPILER_NAME],
+                                                  compilers[current][CDETECT_COMPILER_ARGUMENTS]);
+        if (result)
+            break;
+    }
+#endif
+    return result;
 }
 
-/* FIXME: Documentation */
-
-int
-config_tool_define_command(const char *tool,
-                           const char *command, ...)
+cdetect_bool_t
+cdetect_check_compilation(const char *type,
+                          const char *envar,
+                          const char *compilers[][CDETECT_COMPILER_COLUMNS])
 {
     cdetect_bool_t success = CDETECT_FALSE;
-    cdetect_string_t cmd;
-    cdetect_string_t result = 0;
-    va_list arguments;
+    const char *command = 0;
+    cdetect_string_t key;
+    cdetect_string_t message;
+    int current;
 
-    cdetect_log("config_tool_define_command(tool = %'s, command = %'s, ...)\n",
-                tool, command);
+    cdetect_log("cdetect_check_compilation()\n");
+    cdetect_trace_begin("phase", "compiler detection");
 
-    va_start(arguments, command);
-    cmd = cdetect_string_vformat(command, arguments);
-    va_end(arguments);
+    /* Check from option */
+    if (cdetect_command_compile) {
+        command = cdetect_check_compilation_single(envar, cdetect_command_compile, 0);
+    }
+    /* FIXME: environment */
+    /* Check from built-in array */
+    if (command == 0) {
+        command = config_tool_get(envar);
+        if (command == 0) {
+            key = cdetect_check_compilation_key(envar, compilers);
+            command = cdetect_check_compilation_cached(envar, key->content);
+            if (command == 0) {
+                command = cdetect_check_compilation_probe(envar, compilers);
+                if (command) {
+                    cdetect_check_compilation_remember(key->content, command);
+                }
+            }
+            cdetect_string_destroy(key);
+        }
+    }
 
-    if (cdetect_execute_substitute(cmd, &result, CDETECT_FALSE) && (result != 0)) {
-        cdetect_string_trim(result, "\r\n");
-        cdetect_tool_define(tool, result->content);
+    /* FIXME: move outside this function */
+    if (command == 0) {
+        cdetect_output("checking for working %s compiler... none\n", type);
+        if (cdetect_command_compile)
+            cdetect_output("The %'s compiler does not work.\n", cdetect_command_compile);
+        cdetect_output("Please run again with the --compiler option.\n");
+    } else {
+        cdetect_free(cdetect_command_compile);
+        cdetect_command_compile = cdetect_strdup(command);
+        current = cdetect_check_compilation_entry(cdetect_command_compile, compilers);
+        cdetect_format_predefined = (current < 0)
+            ? cdetect_format_predefined_default
+            : compilers[current][CDETECT_COMPILER_PREDEFINED];
+        cdetect_format_includes = (current < 0)
+            ? 0
+            : compilers[current][CDETECT_COMPILER_INCLUDES];
         success = CDETECT_TRUE;
+        cdetect_output("checking for working %s compiler... %s\n", type, cdetect_command_compile);
     }
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(cmd);
+    message = cdetect_string_format("working %s compiler", type);
+    cdetect_trace_check(message->content, success ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    cdetect_string_destroy(message);
+    cdetect_trace_end(0);
 
     return success;
 }
 
 /*
- * Check if a tool exists
+ * Check cross-compilation
  */
 
 cdetect_bool_t
-cdetect_tool_exist(const char *path)
+cdetect_check_cross_compilation(void)
 {
     cdetect_bool_t success = CDETECT_FALSE;
-    cdetect_string_t filename;
-    cdetect_string_t remainder;
+    const char *source = "int main(void) { return 0; }\n";
 
-    if (path) {
-        success = cdetect_file_exist(path);
-        if (!success) {
-            filename = cdetect_string_format("%s", path);
-            /* Does not handle quoted spaces in path */
-            remainder = cdetect_string_split(filename, ' ');
-            success = cdetect_file_exist(filename->content);
-            cdetect_string_destroy(remainder);
-            cdetect_string_destroy(filename);
-        }
+    if (cdetect_command_remote) {
+
+        cdetect_log("cdetect_check_cross_compilation(%'s)\n",
+                    cdetect_command_remote);
+
+        success = (cdetect_bool_t)config_execute_source(source, "", "");
+        cdetect_report_bool("cross-compilation",
+                            (success == CDETECT_TRUE) ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
     }
     return success;
 }
 
+/*
+ * Calculate compiler fingerprint
+ *
+ * The fingerprint identifies the compiler executable (by its file status) and
+ * the global settings that affect the compiler output. It is used as key for
+ * cached results that depend on the compiler.
+ */
 
 const char *
-cdetect_tool_check_with_path(const char *variable,
-                             const char *path,
-                             cdetect_tool_check_filter_t filter,
-                             void *closure)
+cdetect_compiler_fingerprint(void)
 {
-    cdetect_map_element_t element = 0;
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    cdetect_string_t stamp;
+    unsigned int first;
+    unsigned int second;
 
-    assert(path != 0);
-    assert(variable != 0);
+    if (cdetect_command_compile == 0)
+        return 0;
 
-    element = cdetect_map_lookup(cdetect_tool_map, variable);
-    if (element == 0) {
-        if (cdetect_tool_exist(path) && (filter == 0 || filter(path, closure))) {
-            cdetect_tool_define(variable, path);
-        }
+    if (cdetect_compiler_fingerprint_value == 0) {
+
+        /* Does not handle quoted spaces in path */
+        executable = cdetect_string_format("%s", cdetect_command_compile);
+        remainder = cdetect_string_split(executable, ' ');
+        stamp = cdetect_file_stamp(executable->content);
+
+        first = cdetect_hash_string(cdetect_command_compile, 0);
+        first = cdetect_hash_string(stamp ? stamp->content : "", first);
+        first = cdetect_hash_string(cdetect_argument_cflags, first);
+        first = cdetect_hash_string(cdetect_command_remote, first);
+        second = cdetect_hash_string(executable->content, first);
+        second = cdetect_hash_string(CDETECT_CHOST_FILE, second);
+
+        cdetect_compiler_fingerprint_value = cdetect_string_format("%x.%x.%x",
+                                                                   (unsigned int)CDETECT_VERSION,
+                                                                   first,
+                                                                   second);
+        cdetect_log("compiler fingerprint = %'^s\n", cdetect_compiler_fingerprint_value);
+
+        cdetect_string_destroy(stamp);
+        cdetect_string_destroy(remainder);
+        cdetect_string_destroy(executable);
     }
-    return (const char *)((element && element->data) ? element->data : 0);
+    return cdetect_compiler_fingerprint_value->content;
 }
 
-const char *
-cdetect_tool_check(const char *variable,
-                   const char *tool,
-                   cdetect_tool_check_filter_t filter,
-                   void *closure)
-{
-    const char *result = 0;
-    cdetect_string_t current;
-    cdetect_string_t rest;
-    cdetect_bool_t keep_trying = CDETECT_TRUE;
+/*************************************************************************
+ *
+ * Detect Host (using chost.c)
+ *
+ ************************************************************************/
 
-    if (tool) {
+/*
+ * Decode host information as printed by chost.c (without the ### prefix)
+ *
+ * The compiler and CPU found by cdetect_predefined() take precedence, and
+ * their names are kept, because config_compiler() and config_cpu() may
+ * already have handed them out.
+ */
 
-        current = cdetect_string_format("%s", cdetect_path);
-        do {
-            rest = cdetect_string_split(current, cdetect_path_list_separator);
+cdetect_bool_t
+cdetect_host_decode(cdetect_string_t line)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_string_t compiler_name = 0;
+    cdetect_string_t kernel_name = 0;
+    cdetect_string_t cpu_name = 0;
+    unsigned int compiler_version = 0;
+    unsigned int kernel_version = 0;
+    unsigned int cpu_version = 0;
 
-            if (!cdetect_string_append_path(current, tool))
-                keep_trying = CDETECT_FALSE;
+    if (cdetect_string_scan(line, "%^[^:]:%x %^[^:]:%x %^[^:]:%x",
+                            &compiler_name, &compiler_version,
+                            &kernel_name, &kernel_version,
+                            &cpu_name, &cpu_version) == 6) {
 
-            result = cdetect_tool_check_with_path(variable, current->content, filter, closure);
-            if (result) {
-                keep_trying = CDETECT_FALSE;
-            } else if (rest == 0) {
-                keep_trying = CDETECT_FALSE;
+        if (!cdetect_is_predefined_compiler) {
+            cdetect_compiler_version = compiler_version;
+            if (compiler_name->length > 0) {
+                cdetect_string_destroy(cdetect_compiler_name);
+                cdetect_compiler_name = compiler_name;
+                compiler_name = 0;
             }
+        }
 
-            cdetect_string_destroy(current);
-            current = rest;
-        } while (keep_trying);
+        cdetect_kernel_version = kernel_version;
+        if (kernel_name->length > 0) {
+            cdetect_string_destroy(cdetect_kernel_name);
+            cdetect_kernel_name = kernel_name;
+            kernel_name = 0;
+        }
 
-        cdetect_string_destroy(rest);
+        if (!cdetect_is_predefined_cpu) {
+            cdetect_cpu_version = cpu_version;
+            if (cpu_name->length > 0) {
+                cdetect_string_destroy(cdetect_cpu_name);
+                cdetect_cpu_name = cpu_name;
+                cpu_name = 0;
+            }
+        }
+        success = CDETECT_TRUE;
     }
+    cdetect_string_destroy(cpu_name);
+    cdetect_string_destroy(kernel_name);
+    cdetect_string_destroy(compiler_name);
 
-    return result;
+    return success;
 }
 
-/* FIXME: Documentation */
+/*
+ * Get host information
+ */
 
-const char *
-config_tool_get(const char *tool)
+cdetect_bool_t
+cdetect_host(void)
 {
+    cdetect_bool_t success;
     cdetect_map_element_t element;
+    const char *fingerprint;
+    cdetect_string_t source_file;
+    cdetect_string_t execute_file;
+    cdetect_string_t compile_flags;
+    cdetect_string_t link_flags;
+    cdetect_string_t result = 0;
+    cdetect_string_t line;
 
-    if ( (tool == 0) || (cdetect_tool_map == 0) ) {
-        return 0;
-    }
+    if (cdetect_is_host_initialized)
+        return CDETECT_TRUE;
+    cdetect_is_host_initialized = CDETECT_TRUE;
 
-    element = cdetect_map_lookup(cdetect_tool_map, tool);
-    return (element == 0)
-        ? 0
-        : (const char *)element->data;
-}
+    /* Use cached result if the compiler has not changed */
+    fingerprint = cdetect_compiler_fingerprint();
+    if (fingerprint) {
+        element = cdetect_map_lookup(cdetect_host_map, fingerprint);
+        if (element && element->data) {
+            line = cdetect_string_format("%s", (const char *)element->data);
+            success = cdetect_host_decode(line);
+            cdetect_string_destroy(line);
+            if (success) {
+                cdetect_log("cdetect_host() cached\n");
+                return CDETECT_TRUE;
+            }
+        }
+    }
 
-/* FIXME: Documentation */
+    source_file = cdetect_string_format(CDETECT_CHOST_FILE);
+    execute_file = cdetect_string_format("%sb%s", /* Name purposely mangled */
+                                         cdetect_file_execute,
+                                         cdetect_suffix_execute);
+    compile_flags = cdetect_string_format("");
+    link_flags = cdetect_string_format("");
 
-const char *
-config_tool_check_filter(const char *variable,
-                         const char *tool,
-                         config_tool_check_filter_t filter,
-                         void *closure)
-{
-    cdetect_string_t message;
-    const char *result = 0;
+    cdetect_output("compiling %s...\n", source_file->content);
+    cdetect_trace_begin("phase", "chost");
+
+    success = CDETECT_FALSE;
+#if defined(CDETECT_ENGINE_OBJECT)
+    /* Link with the prebuilt engine instead of compiling it again */
+    if (cdetect_file_exist(CDETECT_ENGINE_OBJECT)) {
+        (void)cdetect_string_append(compile_flags, "-DCDETECT_USE_LIBRARY");
+        (void)cdetect_string_append(link_flags, CDETECT_ENGINE_OBJECT);
+        success = cdetect_compile_file(source_file,
+                                       execute_file,
+                                       compile_flags,
+                                       link_flags,
+                                       0,
+                                       CDETECT_TRUE,
+                                       (cdetect_bool_t)(cdetect_command_remote != 0),
+                                       &result);
+        if (!success) {
+            /* The engine may have been built by another compiler */
+            cdetect_log("cdetect_host() cannot use %'s\n", CDETECT_ENGINE_OBJECT);
+            cdetect_string_destroy(result);
+            result = 0;
+            cdetect_string_destroy(link_flags);
+            cdetect_string_destroy(compile_flags);
+            compile_flags = cdetect_string_format("");
+            link_flags = cdetect_string_format("");
+        }
+    }
+#endif
+    if (!success) {
+        success = cdetect_compile_file(source_file,
+                                       execute_file,
+                                       compile_flags,
+                                       link_flags,
+                                       0,
+                                       CDETECT_TRUE,
+                                       (cdetect_bool_t)(cdetect_command_remote != 0),
+                                       &result);
+    }
 
-    cdetect_log("config_tool_check_filter(variable = %'s, tool = %'s)\n",
-                variable, tool);
+    if (success && result) {
 
-    result = cdetect_tool_check(variable, tool, (cdetect_tool_check_filter_t)filter, closure);
-    message = cdetect_string_format("tool %s", tool);
-    config_report_string(message->content, result ? result : "no");
-    cdetect_string_destroy(message);
+        if ((result->length > 4) && (cdetect_strequal_max(result->content, 4, "### "))) {
+            line = cdetect_string_create();
+            if (line) {
+                (void)cdetect_string_append_range(line,
+                                                  result->content,
+                                                  4,
+                                                  cdetect_string_find_char(result, 4, '\n'));
+                if (line->content && cdetect_host_decode(line) && fingerprint) {
+                    (void)cdetect_map_remember(cdetect_host_map, fingerprint, line->content);
+                }
+                cdetect_string_destroy(line);
+            }
+        }
+    }
+    cdetect_trace_end(0);
 
-    return result;
-}
+    (void)cdetect_file_remove(execute_file->content);
 
-/* FIXME: Documentation */
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(link_flags);
+    cdetect_string_destroy(compile_flags);
+    cdetect_string_destroy(execute_file);
+    cdetect_string_destroy(source_file);
 
-const char *
-config_tool_check(const char *variable,
-                  const char *tool)
-{
-    return config_tool_check_filter(variable, tool, 0, 0);
+    return success;
 }
 
 /*************************************************************************
  *
- * Detect Compiler
+ * Predefined Macros (using the preprocessor of the compiler)
  *
  ************************************************************************/
 
 /*
- * Check if compilation works
+ * Parse #define lines from a predefined macro dump
+ *
+ * Function-like macros are ignored.
  */
 
-cdetect_bool_t
-cdetect_check_compilation_filter(const char *command, void *userdata)
+void
+cdetect_predefined_parse(cdetect_string_t dump)
 {
-    cdetect_bool_t success;
-    const char *arguments;
-    char *backup;
-    cdetect_string_t sourcecode;
-    cdetect_string_t result;
+    const char *directive = "#define ";
+    size_t directive_length;
+    size_t offset;
+    size_t end;
+    size_t before;
+    size_t after;
+    cdetect_string_t name;
+    cdetect_string_t value;
 
-    arguments = (const char *)userdata;
+    directive_length = strlen(directive);
 
-    /* Workaround is needed because cdetect_command_compile is global */
-    backup = cdetect_command_compile;
-    cdetect_command_compile = (char *)command;
+    for (offset = 0; offset < dump->length; offset = end + 1) {
+        end = cdetect_string_find_char(dump, offset, '\n');
 
-    sourcecode = cdetect_string_format("int main(void) { return 0;}\n");
+        if ((end - offset <= directive_length) ||
+            !cdetect_strequal_max(&dump->content[offset], directive_length, directive))
+            continue;
 
-    success = cdetect_compile_source(sourcecode,
-                                     0,
-                                     0,
-                                     0,
-                                     CDETECT_TRUE,
-                                     CDETECT_FALSE,
-                                     &result);
+        before = offset + directive_length;
+        after = before;
+        while ((after < end) &&
+               (cdetect_is_alnum((int)((unsigned char)dump->content[after])) ||
+                (dump->content[after] == '_'))) {
+            ++after;
+        }
+        if ((after == before) || ((after < end) && (dump->content[after] == '(')))
+            continue;
 
-    cdetect_command_compile = backup;
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(sourcecode);
+        name = cdetect_string_create();
+        value = cdetect_string_create();
+        (void)cdetect_string_append_range(name, dump->content, before, after);
+        (void)cdetect_string_append(value, "");
+        while ((after < end) && cdetect_is_space((int)((unsigned char)dump->content[after])))
+            ++after;
+        before = end;
+        while ((before > after) && cdetect_is_space((int)((unsigned char)dump->content[before - 1])))
+            --before;
+        (void)cdetect_string_append_range(value, dump->content, after, before);
 
-    return success;
+        (void)cdetect_map_remember(cdetect_predefined_map, name->content, value->content);
+
+        cdetect_string_destroy(value);
+        cdetect_string_destroy(name);
+    }
 }
 
+/*
+ * Get value of predefined macro (or null pointer if not defined)
+ */
+
 const char *
-cdetect_check_compilation_single(const char *envar,
-                                 const char *command,
-                                 const char *arguments)
+cdetect_predefined_value(const char *name)
 {
-    cdetect_string_t compiler;
-    const char *result = 0;
+    cdetect_map_element_t element;
 
-    compiler = cdetect_string_format("%s%s", command, cdetect_suffix_execute);
-    if (compiler) {
-        result = cdetect_tool_check_with_path(envar,
-                                              compiler->content,
-                                              cdetect_check_compilation_filter,
-                                              (void *)arguments);
-        if (result == 0) {
-            result = cdetect_tool_check(envar,
-                                        compiler->content,
-                                        cdetect_check_compilation_filter,
-                                        (void *)arguments);
-        }
-        cdetect_string_destroy(compiler);
+    element = cdetect_map_lookup(cdetect_predefined_map, name);
+    return element ? (const char *)element->data : 0;
+}
+
+/*
+ * Is any of the comma-separated predefined macros defined
+ */
+
+cdetect_bool_t
+cdetect_predefined_any(const char *names)
+{
+    cdetect_string_t list;
+    cdetect_string_t name;
+    cdetect_string_t remainder;
+    cdetect_bool_t result = CDETECT_FALSE;
+
+    list = cdetect_string_format("%s", names);
+    while (list) {
+        remainder = cdetect_string_split(list, ',');
+        name = list;
+        list = remainder;
+        if ((result == CDETECT_FALSE) && (cdetect_predefined_value(name->content) != 0))
+            result = CDETECT_TRUE;
+        cdetect_string_destroy(name);
     }
     return result;
 }
 
+/*
+ * Get integer value of predefined macro
+ *
+ * A value that names another macro is replaced by the value of that macro.
+ * Integer suffixes are ignored.
+ */
+
+unsigned long
+cdetect_predefined_number(const char *name)
+{
+    const char *value;
+    int depth;
+
+    value = cdetect_predefined_value(name);
+    for (depth = 0; value && (depth < 8); ++depth) {
+        if (!cdetect_is_alpha((int)((unsigned char)*value)) && (*value != '_'))
+            break;
+        value = cdetect_predefined_value(value);
+    }
+    return value ? strtoul(value, 0, 0) : 0;
+}
+
+/*
+ * Decode compiler from predefined macros
+ *
+ * Uses the same precedence as chost.c
+ */
+
 cdetect_bool_t
-cdetect_check_compilation(const char *type,
-                          const char *envar,
-                          const char *compilers[][2])
+cdetect_predefined_compiler(cdetect_string_t *name,
+                            unsigned int *version)
+{
+    unsigned long value;
+
+    *name = 0;
+    *version = 0;
+
+    if (cdetect_predefined_value("__DECCXX") || cdetect_predefined_value("__DECC")) {
+        value = cdetect_predefined_value("__DECCXX")
+            ? cdetect_predefined_number("__DECCXX_VER")
+            : cdetect_predefined_number("__DECC_VER");
+        *name = cdetect_string_format("decc");
+        *version = CDETECT_MKVER(value / 10000000, (value % 10000000) / 100000, value % 1000);
+
+    } else if (cdetect_predefined_value("__GNUC__")) {
+        *name = cdetect_string_format("gcc");
+        *version = CDETECT_MKVER(cdetect_predefined_number("__GNUC__"),
+                                 cdetect_predefined_number("__GNUC_MINOR__"),
+                                 cdetect_predefined_number("__GNUC_PATCHLEVEL__"));
+
+    } else if (cdetect_predefined_value("__HP_aCC")) {
+        value = cdetect_predefined_number("__HP_aCC");
+        *name = cdetect_string_format("hpacc");
+        *version = (value == 1)
+            ? CDETECT_MKVER(1, 15, 0)
+            : CDETECT_MKVER(value / 10000, (value % 10000) / 100, value % 100);
+
+    } else if (cdetect_predefined_value("__HP_cc")) {
+        value = cdetect_predefined_number("__HP_cc");
+        *name = cdetect_string_format("hpcc");
+        *version = CDETECT_MKVER(value / 10000, (value % 10000) / 100, value % 100);
+
+    } else if (cdetect_predefined_any("__INTEL_COMPILER,__ICC,__ICL")) {
+        value = cdetect_predefined_value("__INTEL_COMPILER")
+            ? cdetect_predefined_number("__INTEL_COMPILER")
+            : cdetect_predefined_number("__ICC");
+        *name = cdetect_string_format("icc");
+        *version = CDETECT_MKVER(value / 100, (value % 100) / 10, value % 10);
+
+    } else if (cdetect_predefined_value("_MSC_FULL_VER")) {
+        value = cdetect_predefined_number("_MSC_FULL_VER");
+        *name = cdetect_string_format("msc");
+        *version = CDETECT_MKVER(value / 1000000, (value % 1000000) / 10000, value % 10000);
+
+    } else if (cdetect_predefined_value("_MSC_VER")) {
+        value = cdetect_predefined_number("_MSC_VER");
+        *name = cdetect_string_format("msc");
+        *version = CDETECT_MKVER(value / 100, value % 100, 0);
+
+    } else if (cdetect_predefined_any("__SUNPRO_CC,__SUNPRO_C")) {
+        value = cdetect_predefined_value("__SUNPRO_CC")
+            ? cdetect_predefined_number("__SUNPRO_CC")
+            : cdetect_predefined_number("__SUNPRO_C");
+        *name = cdetect_string_format("sunpro");
+        *version = CDETECT_MKVER(value / 0x100, (value % 0x100) / 0x10, value % 0x10);
+    }
+
+    return (*name != 0) ? CDETECT_TRUE : CDETECT_FALSE;
+}
+
+/*
+ * Decode CPU from predefined macros
+ *
+ * Uses the same precedence as chost.c
+ */
+
+cdetect_bool_t
+cdetect_predefined_cpu(cdetect_string_t *name,
+                       unsigned int *version)
+{
+    unsigned long value;
+
+    *name = 0;
+    *version = 0;
+
+    if (cdetect_predefined_any("__alpha_ev6__,__alpha_ev5__,__alpha_ev4__,__alpha__,__alpha,_M_ALPHA")) {
+        *name = cdetect_string_format("alpha");
+        if (cdetect_predefined_value("__alpha_ev6__"))
+            *version = CDETECT_MKVER(6, 0, 0);
+        else if (cdetect_predefined_value("__alpha_ev5__"))
+            *version = CDETECT_MKVER(5, 0, 0);
+        else if (cdetect_predefined_value("__alpha_ev4__"))
+            *version = CDETECT_MKVER(4, 0, 0);
+
+    } else if (cdetect_predefined_any("__amd64__,__amd64,__x86_64__,__x86_64")) {
+        *name = cdetect_string_format("amd64");
+
+    } else if (cdetect_predefined_value("__arm__") && !cdetect_predefined_value("__ARMCC_VERSION")) {
+        *name = cdetect_string_format("arm");
+
+    } else if (cdetect_predefined_value("__TARGET_ARCH_ARM")) {
+        *name = cdetect_string_format("arm");
+        *version = CDETECT_MKVER(cdetect_predefined_number("__TARGET_ARCH_ARM"), 0, 0);
+
+    } else if (cdetect_predefined_any("__hppa__,__hppa")) {
+        *name = cdetect_string_format("hppa");
+        if (cdetect_predefined_value("_PA_RISC1_0"))
+            *version = CDETECT_MKVER(1, 0, 0);
+        else if (cdetect_predefined_value("_PA_RISC1_1"))
+            *version = CDETECT_MKVER(1, 1, 0);
+        else if (cdetect_predefined_any("_PA_RISC2_0,__RISC2_0__"))
+            *version = CDETECT_MKVER(2, 0, 0);
+
+    } else if (cdetect_predefined_any("__m68k__,M68000")) {
+        *name = cdetect_string_format("m68k");
+        if (!cdetect_predefined_value("__m68k__"))
+            ;
+        else if (cdetect_predefined_value("__mc68060__"))
+            *version = CDETECT_MKVER(6, 0, 0);
+        else if (cdetect_predefined_value("__mc68040__"))
+            *version = CDETECT_MKVER(4, 0, 0);
+        else if (cdetect_predefined_value("__mc68030__"))
+            *version = CDETECT_MKVER(3, 0, 0);
+        else if (cdetect_predefined_value("__mc68020__"))
+            *version = CDETECT_MKVER(2, 0, 0);
+        else if (cdetect_predefined_value("__mc68010__"))
+            *version = CDETECT_MKVER(1, 0, 0);
+
+    } else if (cdetect_predefined_any("__mips__,__mips,__MIPS__")) {
+        *name = cdetect_string_format("mips");
+        if (cdetect_predefined_value("__mips__")) {
+            if (cdetect_predefined_value("_MIPS_ISA")) {
+                value = cdetect_predefined_number("_MIPS_ISA");
+                if (value == cdetect_predefined_number("_MIPS_ISA_MIPS4"))
+                    *version = CDETECT_MKVER(4, 0, 0);
+                else if (value == cdetect_predefined_number("_MIPS_ISA_MIPS3"))
+                    *version = CDETECT_MKVER(3, 0, 0);
+                else if (value == cdetect_predefined_number("_MIPS_ISA_MIPS2"))
+                    *version = CDETECT_MKVER(2, 0, 0);
+                else if (value == cdetect_predefined_number("_MIPS_ISA_MIPS1"))
+                    *version = CDETECT_MKVER(1, 0, 0);
+            }
+        } else if (cdetect_predefined_value("__mips")) {
+            *version = CDETECT_MKVER(cdetect_predefined_number("__mips"), 0, 0);
+        }
+
+    } else if (cdetect_predefined_value("_M_PPC")) {
+        value = cdetect_predefined_number("_M_PPC");
+        *name = cdetect_string_format("powerpc");
+        *version = CDETECT_MKVER(value / 100, value % 100, 0);
+
+    } else if (cdetect_predefined_any("__ppc604__,__ARCH_604")) {
+        *name = cdetect_string_format("powerpc");
+        *version = CDETECT_MKVER(6, 4, 0);
+
+    } else if (cdetect_predefined_any("__ppc603__,__ARCH_603")) {
+        *name = cdetect_string_format("powerpc");
+        *version = CDETECT_MKVER(6, 3, 0);
+
+    } else if (cdetect_predefined_any("__ppc601__,__ppc601,__ARCH_601")) {
+        *name = cdetect_string_format("powerpc");
+        *version = CDETECT_MKVER(6, 1, 0);
+
+    } else if (cdetect_predefined_any("__powerpc,__powerpc__,__POWERPC__,__ppc__,__PPC,__PPC__,__ARCH_PPC")) {
+        *name = cdetect_string_format("powerpc");
+
+    } else if (cdetect_predefined_any("__sparcv8,__sparcv9,__sparc_v9__,__sparc__,__sparc,sparc")) {
+        *name = cdetect_string_format("sparc");
+        if (cdetect_predefined_value("__sparcv8"))
+            *version = CDETECT_MKVER(8, 0, 0);
+        else if (cdetect_predefined_any("__sparcv9,__sparc_v9__"))
+            *version = CDETECT_MKVER(9, 0, 0);
+
+    } else if (cdetect_predefined_value("__sh__")) {
+        *name = cdetect_string_format("superh");
+        if (cdetect_predefined_value("__SH5__"))
+            *version = CDETECT_MKVER(5, 0, 0);
+        else if (cdetect_predefined_value("__SH4__"))
+            *version = CDETECT_MKVER(4, 0, 0);
+        else if (cdetect_predefined_any("__sh3__,__SH3__"))
+            *version = CDETECT_MKVER(3, 0, 0);
+        else if (cdetect_predefined_value("__sh2__"))
+            *version = CDETECT_MKVER(2, 0, 0);
+        else if (cdetect_predefined_value("__sh1__"))
+            *version = CDETECT_MKVER(1, 0, 0);
+
+    } else if (cdetect_predefined_value("_M_IX86")) {
+        value = cdetect_predefined_number("_M_IX86");
+        *name = cdetect_string_format("x86");
+        *version = CDETECT_MKVER(value / 100, value % 100, 0);
+
+    } else if (cdetect_predefined_value("__I86__")) {
+        *name = cdetect_string_format("x86");
+        *version = CDETECT_MKVER(cdetect_predefined_number("__I86__"), 0, 0);
+
+    } else if (cdetect_predefined_any("i686,__i686,__i686__,i586,__i586,__i586__,i486,__i486,__i486__,i386,__i386,__i386__,_X86_,__THW_INTEL")) {
+        *name = cdetect_string_format("x86");
+        if (cdetect_predefined_any("i686,__i686,__i686__"))
+            *version = CDETECT_MKVER(6, 0, 0);
+        else if (cdetect_predefined_any("i586,__i586,__i586__"))
+            *version = CDETECT_MKVER(5, 0, 0);
+        else if (cdetect_predefined_any("i486,__i486,__i486__"))
+            *version = CDETECT_MKVER(4, 0, 0);
+        else if (cdetect_predefined_any("i386,__i386,__i386__"))
+            *version = CDETECT_MKVER(3, 0, 0);
+
+    } else if (cdetect_predefined_value("_M_IA64")) {
+        value = cdetect_predefined_number("_M_IA64");
+        *name = cdetect_string_format("ia64");
+        *version = CDETECT_MKVER((value % 64000) / 100, (value % 64000) % 100, 0);
+
+    } else if (cdetect_predefined_any("__ia64,__ia64__,_IA64,__IA64__")) {
+        *name = cdetect_string_format("ia64");
+    }
+
+    return (*name != 0) ? CDETECT_TRUE : CDETECT_FALSE;
+}
+
+/*
+ * Collect the predefined macros of the compiler
+ *
+ * The compiler is only asked once per run. Unlike chost.c this does not
+ * require the compiled program to be executed, so it also works for cross
+ * compilers without remote execution.
+ */
+
+cdetect_bool_t
+cdetect_predefined(void)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    const char *command = 0;
-    int current;
+    cdetect_string_t source_file;
+    cdetect_string_t sourcecode;
+    cdetect_string_t command;
+    cdetect_string_t result = 0;
+    cdetect_string_t name = 0;
+    unsigned int version = 0;
 
-    cdetect_log("cdetect_check_compilation()\n");
+    if (cdetect_is_predefined_initialized)
+        return cdetect_is_predefined_success;
+    cdetect_is_predefined_initialized = CDETECT_TRUE;
 
-    /* Check from option */
-    if (cdetect_command_compile) {
-        command = cdetect_check_compilation_single(envar, cdetect_command_compile, 0);
+    if ((cdetect_command_compile == 0) || (cdetect_format_predefined == 0)) {
+        cdetect_log("cdetect_predefined() not supported by compiler\n");
+        return cdetect_is_predefined_success;
     }
-    /* FIXME: environment */
-    /* Check from built-in array */
-    if (command == 0) {
-        for (current = 0; compilers[current][0] != 0; ++current) {
-            command = cdetect_check_compilation_single(envar,
-                                                       compilers[current][0],
-                                                       compilers[current][1]);
-            if (command)
-                break;
+
+    source_file = cdetect_string_format("%sp%s", /* Name purposely mangled */
+                                        cdetect_file_execute,
+                                        cdetect_suffix_source);
+    sourcecode = cdetect_string_format("\n");
+
+    if (cdetect_file_overwrite(source_file->content, sourcecode)) {
+        command = cdetect_string_format(cdetect_format_predefined,
+                                        cdetect_command_compile,
+                                        cdetect_argument_cflags,
+                                        source_file->content);
+        if (cdetect_execute(command, &result, CDETECT_FALSE) && result) {
+            cdetect_predefined_parse(result);
+            cdetect_is_predefined_success = (cdetect_list_front(cdetect_predefined_map->first) != 0)
+                ? CDETECT_TRUE
+                : CDETECT_FALSE;
         }
+        cdetect_string_destroy(command);
     }
+    (void)cdetect_file_remove(source_file->content);
 
-    /* FIXME: move outside this function */
-    if (command == 0) {
-        cdetect_output("checking for working %s compiler... none\n", type);
-        if (cdetect_command_compile)
-            cdetect_output("The %'s compiler does not work.\n", cdetect_command_compile);
-        cdetect_output("Please run again with the --compiler option.\n");
-    } else {
-        cdetect_free(cdetect_command_compile);
-        cdetect_command_compile = cdetect_strdup(command);
-        success = CDETECT_TRUE;
-        cdetect_output("checking for working %s compiler... %s\n", type, cdetect_command_compile);
+    if (cdetect_is_predefined_success) {
+        if (cdetect_predefined_compiler(&name, &version)) {
+            cdetect_string_destroy(cdetect_compiler_name);
+            cdetect_compiler_name = name;
+            cdetect_compiler_version = version;
+            cdetect_is_predefined_compiler = CDETECT_TRUE;
+        }
+        if (cdetect_predefined_cpu(&name, &version)) {
+            cdetect_string_destroy(cdetect_cpu_name);
+            cdetect_cpu_name = name;
+            cdetect_cpu_version = version;
+            cdetect_is_predefined_cpu = CDETECT_TRUE;
+        }
     }
 
-    return success;
+    cdetect_string_destroy(result);
+    cdetect_string_destroy(sourcecode);
+    cdetect_string_destroy(source_file);
+
+    return cdetect_is_predefined_success;
 }
 
 /*
- * Check cross-compilation
+ * Detect compiler (using predefined macros if possible)
  */
 
 cdetect_bool_t
-cdetect_check_cross_compilation(void)
+cdetect_host_compiler(void)
 {
-    cdetect_bool_t success = CDETECT_FALSE;
-    const char *source = "int main(void) { return 0; }\n";
-
-    if (cdetect_command_remote) {
-
-        cdetect_log("cdetect_check_cross_compilation(%'s)\n",
-                    cdetect_command_remote);
-
-        success = (cdetect_bool_t)config_execute_source(source, "", "");
-        cdetect_report_bool("cross-compilation",
-                            (success == CDETECT_TRUE) ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
-    }
-    return success;
+    (void)cdetect_predefined();
+    if (cdetect_is_predefined_compiler)
+        return CDETECT_TRUE;
+    return cdetect_host();
 }
 
-/*************************************************************************
- *
- * Detect Host (using chost.c)
- *
- ************************************************************************/
-
 /*
- * Get host information
+ * Detect CPU (using predefined macros if possible)
  */
 
 cdetect_bool_t
-cdetect_host(void)
+cdetect_host_cpu(void)
 {
-    static cdetect_bool_t is_initialized = CDETECT_FALSE;
-    cdetect_bool_t success;
-    cdetect_string_t source_file;
-    cdetect_string_t execute_file;
-    cdetect_string_t compile_flags;
-    cdetect_string_t link_flags;
-    cdetect_string_t result = 0;
-    cdetect_string_t compiler_name = 0;
-    cdetect_string_t kernel_name = 0;
-    cdetect_string_t cpu_name = 0;
-
-    if (is_initialized)
+    (void)cdetect_predefined();
+    if (cdetect_is_predefined_cpu)
         return CDETECT_TRUE;
-    is_initialized = CDETECT_TRUE;
-
-    source_file = cdetect_string_format(CDETECT_CHOST_FILE);
-    execute_file = cdetect_string_format("%sb%s", /* Name purposely mangled */
-                                         cdetect_file_execute,
-                                         cdetect_suffix_execute);
-    compile_flags = cdetect_string_format("");
-    link_flags = cdetect_string_format("");
-
-    cdetect_output("compiling %s...\n", source_file->content);
-
-    success = cdetect_compile_file(source_file,
-                                   execute_file,
-                                   compile_flags,
-                                   link_flags,
-                                   0,
-                                   CDETECT_TRUE,
-                                   (cdetect_bool_t)(cdetect_command_remote != 0),
-                                   &result);
-
-    if (success && result) {
+    return cdetect_host();
+}
 
-        if (cdetect_string_scan(result, "### %^[^:]:%x %^[^:]:%x %^[^:]:%x",
-                                &compiler_name, &cdetect_compiler_version,
-                                &kernel_name, &cdetect_kernel_version,
-                                &cpu_name, &cdetect_cpu_version) == 6) {
+/**
+   Get value of predefined macro.
 
-            if (compiler_name->length > 0) {
-                cdetect_compiler_name = compiler_name;
-                compiler_name = 0;
-            }
+   The compiler is asked for its predefined macros once, and the answers are
+   served from memory afterwards.
 
-            if (kernel_name->length > 0) {
-                cdetect_kernel_name = kernel_name;
-                kernel_name = 0;
-            }
+   @code
+   if (config_predefined("__SIZEOF_INT128__"))
+       config_macro_define("HAVE_INT128", "1");
+   @endcode
 
-            if (cpu_name->length > 0) {
-                cdetect_cpu_name = cpu_name;
-                cpu_name = 0;
-            }
-        }
-        cdetect_string_destroy(cpu_name);
-        cdetect_string_destroy(kernel_name);
-        cdetect_string_destroy(compiler_name);
-    }
+   @param name Name of the macro.
+   @return The replacement text of the macro (which may be the empty string),
+   or the null pointer (0) if the macro is not predefined or the compiler
+   cannot list its predefined macros.
+*/
 
-    (void)cdetect_file_remove(execute_file->content);
+const char *
+config_predefined(const char *name)
+{
+    cdetect_log("config_predefined(name = %'s)\n", name);
 
-    cdetect_string_destroy(result);
-    cdetect_string_destroy(link_flags);
-    cdetect_string_destroy(compile_flags);
-    cdetect_string_destroy(execute_file);
-    cdetect_string_destroy(source_file);
+    if (!cdetect_predefined())
+        return 0;
 
-    return success;
+    return cdetect_predefined_value(name);
 }
 
 /**
@@ -5037,7 +10175,7 @@ cdetect_host(void)
 const char *
 config_compiler(void)
 {
-    if (!cdetect_host())
+    if (!cdetect_host_compiler())
         return 0;
 
     return cdetect_compiler_name ? cdetect_compiler_name->content : 0;
@@ -5063,7 +10201,7 @@ config_compiler(void)
 unsigned int
 config_compiler_version(void)
 {
-    if (!cdetect_host())
+    if (!cdetect_host_compiler())
         return 0;
 
     return cdetect_compiler_version;
@@ -5076,7 +10214,7 @@ config_compiler_check(void)
 {
     cdetect_log("config_compiler_check()\n");
 
-    if (!cdetect_host())
+    if (!cdetect_host_compiler())
         return 0;
 
     if (cdetect_compiler_name == 0) {
@@ -5093,6 +10231,7 @@ config_compiler_check(void)
         }
     }
 
+    cdetect_trace_check("compiler", (cdetect_compiler_name != 0) ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
     cdetect_is_compiler_checked = CDETECT_TRUE;
 
     return (cdetect_compiler_name != 0);
@@ -5156,84 +10295,528 @@ config_kernel_version(void)
     return cdetect_kernel_version;
 }
 
-/* FIXME: Documentation */
+/* FIXME: Documentation */
+
+int
+config_kernel_check(void)
+{
+    cdetect_log("config_kernel_check()\n");
+
+    if (!cdetect_host())
+        return 0;
+
+    if (cdetect_kernel_name == 0) {
+        cdetect_output("checking kernel... Unknown\n");
+    } else {
+        if (cdetect_kernel_version == 0) {
+            cdetect_output("checking kernel... %s\n", cdetect_kernel_name->content);
+        } else {
+            cdetect_output("checking kernel... %s %u.%u.%u\n",
+                           cdetect_kernel_name->content,
+                           (cdetect_kernel_version & 0xFF000000) >> 24,
+                           (cdetect_kernel_version & 0x00FF0000) >> 16,
+                           (cdetect_kernel_version & 0x0000FFFF));
+        }
+    }
+
+    cdetect_trace_check("kernel", (cdetect_kernel_name != 0) ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    cdetect_is_kernel_checked = CDETECT_TRUE;
+
+    return (cdetect_kernel_name != 0);
+}
+
+/* FIXME: Documentation */
+
+const char *
+config_cpu(void)
+{
+    if (!cdetect_host_cpu())
+        return 0;
+
+    return cdetect_cpu_name ? cdetect_cpu_name->content : 0;
+}
+
+/* FIXME: Documentation */
+
+unsigned int
+config_cpu_version(void)
+{
+    if (!cdetect_host_cpu())
+        return 0;
+
+    return cdetect_cpu_version;
+}
+
+/* FIXME: Documentation */
+
+int
+config_cpu_check(void)
+{
+    cdetect_log("config_cpu_check()\n");
+
+    if (!cdetect_host_cpu())
+        return 0;
+
+    if (cdetect_cpu_name == 0) {
+        cdetect_output("checking cpu... Unknown\n");
+    } else {
+        if (cdetect_cpu_version == 0) {
+            cdetect_output("checking cpu... %s\n", cdetect_cpu_name->content);
+        } else {
+            cdetect_output("checking cpu... %s %u.%u.%u\n",
+                           cdetect_cpu_name->content,
+                           (cdetect_cpu_version & 0xFF000000) >> 24,
+                           (cdetect_cpu_version & 0x00FF0000) >> 16,
+                           (cdetect_cpu_version & 0x0000FFFF));
+        }
+    }
+
+    cdetect_trace_check("cpu", (cdetect_cpu_name != 0) ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL);
+    cdetect_is_cpu_checked = CDETECT_TRUE;
+
+    return (cdetect_cpu_name != 0);
+}
+
+/*************************************************************************
+ *
+ * CPU Features
+ *
+ ************************************************************************/
+
+/*
+ * Probe a CPU feature
+ *
+ * The outcome is "0" if the compiler cannot target the feature, or "1"
+ * followed by "1" if this host supports the feature, or "0" if it does not
+ * or cannot tell, and the flags that are needed.
+ */
+
+cdetect_string_t
+cdetect_cpu_feature_probe(const char *feature[])
+{
+    cdetect_string_t result = 0;
+    cdetect_string_t sourcecode;
+    cdetect_string_t flags;
+    cdetect_string_t rest;
+    cdetect_string_t output = 0;
+    cdetect_bool_t is_compiled;
+    cdetect_bool_t is_executed;
+
+    sourcecode = cdetect_string_format("#include <%s>\nint main(void)\n{\n    volatile int input = 1;\n    %s\n}\n",
+                                       feature[CDETECT_CPU_FEATURE_HEADER],
+                                       feature[CDETECT_CPU_FEATURE_BODY]);
+
+    /* The compiler may target the feature without flags */
+    flags = cdetect_string_format("");
+    rest = cdetect_string_format("%s", feature[CDETECT_CPU_FEATURE_FLAGS]);
+    do {
+        is_compiled = cdetect_compile_source(sourcecode, flags, 0, 0,
+                                             CDETECT_FALSE, CDETECT_FALSE,
+                                             &output);
+        cdetect_string_destroy(output);
+        output = 0;
+        if (!is_compiled) {
+            cdetect_string_destroy(flags);
+            flags = rest;
+            rest = (flags) ? cdetect_string_split(flags, ',') : 0;
+        }
+    } while (!is_compiled && (flags != 0) && !cdetect_is_timed_out);
+
+    if (is_compiled) {
+        /* Illegal instructions stop the program on hosts without the feature */
+        is_executed = cdetect_compile_source(sourcecode, flags, 0, 0,
+                                             CDETECT_TRUE,
+                                             (cdetect_bool_t)(cdetect_command_remote != 0),
+                                             &output);
+        cdetect_string_destroy(output);
+        result = cdetect_string_format("1%c%^s", is_executed ? '1' : '0', flags);
+    } else if (!cdetect_is_timed_out) {
+        result = cdetect_string_format("0");
+    }
+
+    cdetect_string_destroy(rest);
+    cdetect_string_destroy(flags);
+    cdetect_string_destroy(sourcecode);
+    return result;
+}
+
+/**
+   Check the CPU features that the compiler can target.
+
+   The features are SIMD instruction set extensions (SSE2, SSE4_2, AVX,
+   AVX2, AVX512F, AVX512BW, AVX512DQ, AVX512VL, NEON, and SVE). A feature
+   is available if a program with its intrinsics can be compiled, either
+   by default or with a flag such as -mavx2. Features that depend on an
+   unavailable feature are not probed.
+
+   For each available feature, CDETECT_CPU_HAS_<feature> is defined, and
+   the tool variable CFLAGS_<feature> is set to the flags that are needed,
+   which may be empty. If the program also runs on this host (or on the
+   remote host with --remote), CDETECT_CPU_HOST_<feature> is defined as
+   well.
+
+   The outcomes are cached for each compiler and set of compile-time flags.
+
+   @return Number of features that the compiler can target.
+*/
+
+int
+config_cpu_features(void)
+{
+    int result = 0;
+    int i;
+    const char *fingerprint;
+    cdetect_report_t report;
+    cdetect_map_element_t element;
+    cdetect_map_t outcome_map;
+    cdetect_string_t key;
+    cdetect_string_t outcome;
+    cdetect_string_t message;
+    const char *requires;
+
+    cdetect_log("config_cpu_features()\n");
+
+    fingerprint = cdetect_compiler_fingerprint();
+    if (fingerprint == 0)
+        return 0;
+
+    /* Outcomes of this run decide which features are probed */
+    outcome_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                     (cdetect_map_destroy_t)cdetect_free);
+
+    for (i = 0; cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME] != 0; ++i) {
+
+        requires = cdetect_cpu_features[i][CDETECT_CPU_FEATURE_REQUIRES];
+        if (requires) {
+            element = cdetect_map_lookup(outcome_map, requires);
+            if ((element == 0) || (((const char *)element->data)[0] != '1'))
+                continue;
+        }
+
+        report = CDETECT_REPORT_NULL;
+        key = cdetect_string_format("%s%c%s",
+                                    fingerprint,
+                                    cdetect_cache_separator,
+                                    cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+        element = cdetect_map_lookup(cdetect_cpu_feature_map, key->content);
+        if (element && element->data) {
+            outcome = cdetect_string_format("%s", (const char *)element->data);
+            report = CDETECT_REPORT_CACHED;
+        } else {
+            outcome = cdetect_cpu_feature_probe(cdetect_cpu_features[i]);
+            if (outcome) {
+                (void)cdetect_map_remember(cdetect_cpu_feature_map, key->content, outcome->content);
+            } else {
+                /* Stopped probes are tried again */
+                outcome = cdetect_string_format("0");
+                report = CDETECT_REPORT_TIMEOUT;
+            }
+        }
+        (void)cdetect_map_remember(outcome_map,
+                                   cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME],
+                                   outcome->content);
+
+        if (outcome->content[0] == '1') {
+            report = (cdetect_report_t)(report | CDETECT_REPORT_FOUND);
+            ++result;
+            message = cdetect_string_format("CDETECT_CPU_HAS_%s", cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+            cdetect_macro_define(message->content, "1");
+            cdetect_string_destroy(message);
+            if (outcome->content[1] == '1') {
+                message = cdetect_string_format("CDETECT_CPU_HOST_%s", cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+                cdetect_macro_define(message->content, "1");
+                cdetect_string_destroy(message);
+            }
+            message = cdetect_string_format("CFLAGS_%s", cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+            cdetect_tool_define(message->content, &(outcome->content[2]));
+            cdetect_string_destroy(message);
+        }
+        message = cdetect_string_format("cpu feature %s", cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+        cdetect_report_bool(message->content, report);
+        cdetect_string_destroy(message);
+        if (outcome->content[0] == '1') {
+            message = cdetect_string_format("cpu feature %s on host", cdetect_cpu_features[i][CDETECT_CPU_FEATURE_NAME]);
+            cdetect_report_bool(message->content,
+                                (cdetect_report_t)((report & CDETECT_REPORT_CACHED) | ((outcome->content[1] == '1') ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL)));
+            cdetect_string_destroy(message);
+        }
+
+        cdetect_string_destroy(outcome);
+        cdetect_string_destroy(key);
+    }
+
+    cdetect_map_destroy(outcome_map);
+    return result;
+}
+
+/*************************************************************************
+ *
+ * Compiler Flags
+ *
+ ************************************************************************/
+
+/*
+ * Find flag in a line of compiler output
+ *
+ * The flag must not be followed by more characters of a longer flag.
+ */
+
+const char *
+cdetect_cflag_find(const char *line,
+                   const char *end,
+                   const char *flag)
+{
+    const char *position;
+    size_t length;
+    int next;
+
+    length = strlen(flag);
+    for (position = line; position + length <= end; ++position) {
+        if (strncmp(position, flag, length) == 0) {
+            next = (position + length < end) ? (int)((unsigned char)position[length]) : 0;
+            if (!(cdetect_is_alnum(next) || (next == '-') || (next == '=') || (next == '_')
+                  || (next == ',') || (next == '.') || (next == '+') || (next == ':')))
+                return position;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Reject the undecided flags that compiler output complains about
+ *
+ * Only the first flag in each line is blamed, because diagnostics such
+ * as "did you mean" suggest other flags after the offending one. Notes
+ * are skipped, because GCC mentions unknown -Wno-* flags in a note only
+ * when something else failed.
+ */
+
+int
+cdetect_cflag_attribute(const char *output,
+                        const char **flags,
+                        char *outcome,
+                        int count)
+{
+    const char *line;
+    const char *end;
+    const char *position;
+    const char *first;
+    int rejected = 0;
+    int blamed;
+    int i;
+
+    for (line = output; *line != 0; line = (*end != 0) ? end + 1 : end) {
+        end = strchr(line, '\n');
+        if (end == 0)
+            end = line + strlen(line);
+        if (cdetect_cflag_find(line, end, "note:"))
+            continue;
+
+        first = 0;
+        blamed = -1;
+        for (i = 0; i < count; ++i) {
+            if (outcome[i] == '?') {
+                position = cdetect_cflag_find(line, end, flags[i]);
+                if (position && ((first == 0) || (position < first))) {
+                    first = position;
+                    blamed = i;
+                }
+            }
+        }
+        if (blamed >= 0) {
+            outcome[blamed] = '0';
+            ++rejected;
+        }
+    }
+    return rejected;
+}
+
+/*
+ * Probe undecided flags
+ *
+ * All undecided flags ('?') are compiled together. Flags mentioned by a
+ * failed compilation are rejected ('0') and the rest compiled again.
+ * If a failure cannot be attributed, the flags are split into halves.
+ * Flags that were stopped by the timeout remain undecided.
+ */
 
-int
-config_kernel_check(void)
+void
+cdetect_cflag_probe(cdetect_string_t sourcecode,
+                    const char **flags,
+                    char *outcome,
+                    int count)
 {
-    cdetect_log("config_kernel_check()\n");
-
-    if (!cdetect_host())
-        return 0;
+    cdetect_bool_t success;
+    cdetect_string_t cflags;
+    cdetect_string_t output;
+    int pending;
+    int rejected;
+    int i;
 
-    if (cdetect_kernel_name == 0) {
-        cdetect_output("checking kernel... Unknown\n");
-    } else {
-        if (cdetect_kernel_version == 0) {
-            cdetect_output("checking kernel... %s\n", cdetect_kernel_name->content);
-        } else {
-            cdetect_output("checking kernel... %s %u.%u.%u\n",
-                           cdetect_kernel_name->content,
-                           (cdetect_kernel_version & 0xFF000000) >> 24,
-                           (cdetect_kernel_version & 0x00FF0000) >> 16,
-                           (cdetect_kernel_version & 0x0000FFFF));
+    for (;;) {
+        cflags = cdetect_string_format("%s", cdetect_format_warning_error);
+        pending = 0;
+        for (i = 0; i < count; ++i) {
+            if (outcome[i] == '?') {
+                (void)cdetect_string_append_char(cflags, ' ');
+                (void)cdetect_string_append(cflags, flags[i]);
+                ++pending;
+            }
+        }
+        if (pending == 0) {
+            cdetect_string_destroy(cflags);
+            break;
         }
-    }
 
-    cdetect_is_kernel_checked = CDETECT_TRUE;
+        output = 0;
+        success = cdetect_compile_source(sourcecode, cflags, 0, 0,
+                                         CDETECT_FALSE, CDETECT_FALSE,
+                                         &output);
+        cdetect_string_destroy(cflags);
 
-    return (cdetect_kernel_name != 0);
-}
+        rejected = 0;
+        if (!(success || cdetect_is_timed_out || cdetect_is_limit_exceeded) && output) {
+            rejected = cdetect_cflag_attribute(output->content, flags, outcome, count);
+        }
+        cdetect_string_destroy(output);
 
-/* FIXME: Documentation */
+        if (success) {
+            for (i = 0; i < count; ++i) {
+                if (outcome[i] == '?')
+                    outcome[i] = '1';
+            }
+            break;
+        } else if (cdetect_is_timed_out || cdetect_is_limit_exceeded) {
+            break;
+        } else if (rejected == 0) {
+            if (pending == 1) {
+                for (i = 0; i < count; ++i) {
+                    if (outcome[i] == '?')
+                        outcome[i] = '0';
+                }
+            } else {
+                cdetect_cflag_probe(sourcecode, flags, outcome, count / 2);
+                cdetect_cflag_probe(sourcecode, &flags[count / 2], &outcome[count / 2], count - count / 2);
+            }
+            break;
+        }
+    }
+}
 
-const char *
-config_cpu(void)
-{
-    if (!cdetect_host())
-        return 0;
+/**
+   Check which compile-time flags the compiler accepts.
 
-    return cdetect_cpu_name ? cdetect_cpu_name->content : 0;
-}
+   The candidate flags are separated by whitespace. They are compiled
+   together with warnings treated as errors (-Werror or /WX), so that
+   normally only one compilation is needed. Flags that are mentioned in
+   the diagnostics of a failed compilation are rejected, and the
+   remaining flags are tried again. Failures that cannot be attributed to
+   a flag are narrowed down by splitting the flags into halves.
 
-/* FIXME: Documentation */
+   The accepted flags are appended to the tool variable, which is defined
+   even if no flags are accepted.
 
-unsigned int
-config_cpu_version(void)
-{
-    if (!cdetect_host())
-        return 0;
+   The outcome of each flag is cached for each compiler and set of
+   compile-time flags.
 
-    return cdetect_cpu_version;
-}
+   @code
+   config_cflag_check("WARNFLAGS", "-Wall -Wextra -Wshadow -Wvla");
+   @endcode
 
-/* FIXME: Documentation */
+   @param variable Name of tool variable.
+   @param flags Candidate flags.
+   @return Number of accepted flags.
+*/
 
 int
-config_cpu_check(void)
+config_cflag_check(const char *variable,
+                   const char *flags)
 {
-    cdetect_log("config_cpu_check()\n");
+    int result = 0;
+    int count = 0;
+    int i;
+    const char *fingerprint;
+    const char **candidates;
+    char *outcome;
+    char *cached;
+    char *buffer;
+    char *position;
+    cdetect_string_t sourcecode;
+    cdetect_string_t value;
+    cdetect_string_t key;
+    cdetect_string_t message;
+    cdetect_map_element_t element;
 
-    if (!cdetect_host())
+    cdetect_log("config_cflag_check(variable = %'s, flags = %'s)\n",
+                variable, flags);
+
+    assert(variable != 0);
+
+    fingerprint = cdetect_compiler_fingerprint();
+    if ((flags == 0) || (fingerprint == 0))
         return 0;
 
-    if (cdetect_cpu_name == 0) {
-        cdetect_output("checking cpu... Unknown\n");
-    } else {
-        if (cdetect_cpu_version == 0) {
-            cdetect_output("checking cpu... %s\n", cdetect_cpu_name->content);
+    /* Split the flags in place */
+    buffer = cdetect_strdup(flags);
+    candidates = (const char **)cdetect_allocate((strlen(buffer) / 2 + 1) * sizeof(*candidates));
+    position = buffer;
+    for (;;) {
+        while (cdetect_is_space((int)((unsigned char)*position)))
+            *position++ = 0;
+        if (*position == 0)
+            break;
+        candidates[count++] = position;
+        while ((*position != 0) && !cdetect_is_space((int)((unsigned char)*position)))
+            ++position;
+    }
+    outcome = (char *)cdetect_allocate(count + 1);
+    cached = (char *)cdetect_allocate(count + 1);
+
+    for (i = 0; i < count; ++i) {
+        key = cdetect_string_format("%s%c%s", fingerprint, cdetect_cache_separator, candidates[i]);
+        element = cdetect_map_lookup(cdetect_cflag_map, key->content);
+        if (element && element->data) {
+            outcome[i] = ((const char *)element->data)[0];
+            cached[i] = '1';
         } else {
-            cdetect_output("checking cpu... %s %u.%u.%u\n",
-                           cdetect_cpu_name->content,
-                           (cdetect_cpu_version & 0xFF000000) >> 24,
-                           (cdetect_cpu_version & 0x00FF0000) >> 16,
-                           (cdetect_cpu_version & 0x0000FFFF));
+            outcome[i] = '?';
+            cached[i] = '0';
         }
+        cdetect_string_destroy(key);
     }
 
-    cdetect_is_cpu_checked = CDETECT_TRUE;
+    sourcecode = cdetect_string_format("int main(void)\n{\n    return 0;\n}\n");
+    cdetect_cflag_probe(sourcecode, candidates, outcome, count);
+    cdetect_string_destroy(sourcecode);
 
-    return (cdetect_cpu_name != 0);
+    value = cdetect_string_format("%s", config_tool_get(variable) ? config_tool_get(variable) : "");
+    for (i = 0; i < count; ++i) {
+        if ((cached[i] == '0') && (outcome[i] != '?')) {
+            key = cdetect_string_format("%s%c%s", fingerprint, cdetect_cache_separator, candidates[i]);
+            (void)cdetect_map_remember(cdetect_cflag_map, key->content, (outcome[i] == '1') ? "1" : "0");
+            cdetect_string_destroy(key);
+        }
+        if (outcome[i] == '1') {
+            if (value->length > 0)
+                (void)cdetect_string_append_char(value, ' ');
+            (void)cdetect_string_append(value, candidates[i]);
+            ++result;
+        }
+        message = cdetect_string_format("compiler flag %s", candidates[i]);
+        cdetect_report_bool(message->content,
+                            (cdetect_report_t)(((outcome[i] == '1') ? CDETECT_REPORT_FOUND : CDETECT_REPORT_NULL)
+                                               | ((cached[i] == '1') ? CDETECT_REPORT_CACHED : CDETECT_REPORT_NULL)
+                                               | ((outcome[i] == '?') ? CDETECT_REPORT_TIMEOUT : CDETECT_REPORT_NULL)));
+        cdetect_string_destroy(message);
+    }
+    cdetect_tool_define(variable, value->content);
+
+    cdetect_string_destroy(value);
+    cdetect_free(cached);
+    cdetect_free(outcome);
+    cdetect_free((void *)candidates);
+    cdetect_free(buffer);
+    return result;
 }
 
 /*************************************************************************
@@ -5611,7 +11194,7 @@ cdetect_cache_encode_map(cdetect_map_t map,
          current = cdetect_list_next(current)) {
 
         element = (cdetect_map_element_t)current->data;
-        if (element) {
+        if (element && !cdetect_timeout_lookup(type, element->key)) {
             message = cdetect_cache_encode(element, type);
             cdetect_file_write_after(cdetect_cache_file->path, "%^s\n", message);
             cdetect_string_destroy(message);
@@ -5632,9 +11215,16 @@ void cdetect_cache_save(void)
                                    CDETECT_VERSION_PATCH);
     cdetect_file_overwrite(cdetect_cache_file->path->content, output);
     cdetect_cache_encode_map(cdetect_header_map, cdetect_cache_identifier_header);
+    cdetect_cache_encode_map(cdetect_header_location_map, cdetect_cache_identifier_header_location);
     cdetect_cache_encode_map(cdetect_type_map, cdetect_cache_identifier_type);
     cdetect_cache_encode_map(cdetect_function_map, cdetect_cache_identifier_function);
     cdetect_cache_encode_map(cdetect_library_map, cdetect_cache_identifier_library);
+    cdetect_cache_encode_map(cdetect_host_map, cdetect_cache_identifier_host);
+    cdetect_cache_encode_map(cdetect_cpu_feature_map, cdetect_cache_identifier_cpu_feature);
+    cdetect_cache_encode_map(cdetect_cflag_map, cdetect_cache_identifier_cflag);
+    cdetect_cache_encode_map(cdetect_integer_map, cdetect_cache_identifier_integer);
+    cdetect_cache_encode_map(cdetect_compiler_map, cdetect_cache_identifier_compiler);
+    cdetect_cache_encode_map(cdetect_run_map, cdetect_cache_identifier_run);
     cdetect_string_destroy(output);
 }
 
@@ -5674,6 +11264,20 @@ void cdetect_cache_decode(cdetect_string_t line)
             cdetect_map_remember(cdetect_library_map, key->content, value->content);
         } else if (cdetect_strequal(type->content, cdetect_cache_identifier_type)) {
             cdetect_map_remember(cdetect_type_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_host)) {
+            cdetect_map_remember(cdetect_host_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_cpu_feature)) {
+            cdetect_map_remember(cdetect_cpu_feature_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_cflag)) {
+            cdetect_map_remember(cdetect_cflag_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_integer)) {
+            cdetect_map_remember(cdetect_integer_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_compiler)) {
+            cdetect_map_remember(cdetect_compiler_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_header_location)) {
+            cdetect_map_remember(cdetect_header_location_map, key->content, value->content);
+        } else if (cdetect_strequal(type->content, cdetect_cache_identifier_run)) {
+            cdetect_map_remember(cdetect_run_map, key->content, value->content);
         } else {
             cdetect_log("Unknown cache format: %'^s\n", line);
         }
@@ -5747,34 +11351,362 @@ config_cache_register(const char *target)
 /* FIXME: '@' variable [ '=' default ] '@' */
 /* FIXME: Explain that multiple calls adds files */
 
-int
-config_build_register(const char *source,
-                      const char *target)
+int
+config_build_register(const char *source,
+                      const char *target)
+{
+    assert(cdetect_build_map != 0);
+
+    if (source && target) {
+        if (cdetect_map_remember(cdetect_build_map, source, target))
+            return CDETECT_TRUE;
+    }
+    return CDETECT_FALSE;
+}
+
+/**
+   Register an input file of the configuration.
+
+   A run is only considered up to date if its input files are unchanged.
+   The configure program and the templates registered with
+   config_build_register are always input files.
+
+   @param filename Name of input file.
+   @return Boolean indicating success or failure.
+*/
+
+int
+config_depend_register(const char *filename)
+{
+    assert(cdetect_depend_map != 0);
+
+    if (filename) {
+        if (cdetect_map_remember(cdetect_depend_map, filename, 0))
+            return CDETECT_TRUE;
+    }
+    return CDETECT_FALSE;
+}
+
+/**
+   Register a deadline for compilations and executions.
+
+   Each command started by a check is stopped, together with the commands it
+   has started, if it has not finished within the deadline. Checks that are
+   stopped are reported as timed out, and are not cached.
+
+   @param seconds Number of seconds, or zero (0) for no deadline.
+   @return Previous deadline.
+*/
+
+unsigned int
+config_timeout_register(unsigned int seconds)
+{
+    unsigned int previous = cdetect_timeout;
+
+    cdetect_timeout = seconds;
+    return previous;
+}
+
+/**
+   Register resource limits for executed test programs.
+
+   The limits are applied to test programs that are executed locally on
+   systems that support setrlimit(). A program that uses too much processor
+   time, or writes a too large file, is stopped and reported as exceeding
+   its limit. Limits on memory and processes make allocations and process
+   creation fail within the program.
+
+   @param memory Megabytes of address space.
+   @param cpu Seconds of processor time.
+   @param processes Number of processes, counted for the whole user.
+   @param file_size Megabytes per written file.
+
+   Zero (0) means no limit.
+*/
+
+void
+config_execute_limit_register(unsigned long memory,
+                              unsigned long cpu,
+                              unsigned long processes,
+                              unsigned long file_size)
+{
+    cdetect_limit_memory = memory;
+    cdetect_limit_cpu = cpu;
+    cdetect_limit_processes = processes;
+    cdetect_limit_file_size = file_size;
+}
+
+int
+config_work_directory_register(const char *base)
+{
+    cdetect_string_destroy(cdetect_work_directory);
+    cdetect_work_directory = cdetect_string_format("%s", base);
+    /* FIXME: Modify work files */
+    return (cdetect_work_directory != 0);
+}
+
+int
+config_copyright_notice(const char *notice)
+{
+    cdetect_string_destroy(cdetect_copyright_notice);
+    cdetect_copyright_notice = cdetect_string_format("%s", notice);
+    return (cdetect_copyright_notice != 0);
+}
+
+/*************************************************************************
+ *
+ * Variant Files
+ *
+ ************************************************************************/
+
+/*
+ * Insert the name of a variant before the extension of a file name
+ *
+ * "config.h" becomes "config.<variant>.h", and "Makefile" becomes
+ * "Makefile.<variant>".
+ */
+
+cdetect_string_t
+cdetect_variant_file(const char *filename,
+                     const char *variant)
+{
+    cdetect_string_t result;
+    const char *base;
+    const char *extension;
+
+    base = strrchr(filename, cdetect_path_separator);
+    base = (base) ? base + 1 : filename;
+    extension = strrchr(base, '.');
+    if ((extension == 0) || (extension == base)) {
+        return cdetect_string_format("%s.%s", filename, variant);
+    }
+
+    result = cdetect_string_create();
+    (void)cdetect_string_append_range(result, filename, 0, (size_t)(extension - filename));
+    (void)cdetect_string_append_char(result, '.');
+    (void)cdetect_string_append(result, variant);
+    (void)cdetect_string_append(result, extension);
+    return result;
+}
+
+/*************************************************************************
+ *
+ * Run Fingerprint
+ *
+ ************************************************************************/
+
+/*
+ * A run is summarized by a fingerprint of the configure program, its
+ * options, the relevant environment variables, and the compiler. The
+ * fingerprint, the compiler, and the hash values of all templates and
+ * generated files are stored in the cache. If none of them has changed,
+ * the next run has nothing to do.
+ */
+
+const char *cdetect_run_key_fingerprint = "fingerprint";
+const char *cdetect_run_key_compiler = "compiler";
+const char *cdetect_run_key_file = "file:";
+
+/*
+ * Calculate the part of the fingerprint that is known before the checks
+ */
+
+cdetect_bool_t
+cdetect_run_prepare(int argc, char *argv[])
+{
+    cdetect_string_t stamp;
+    unsigned int hash;
+    int i;
+
+    if ((argc < 1) || (argv[0] == 0))
+        return CDETECT_FALSE;
+
+    /* Without the stamp of the program its changes cannot be detected */
+    stamp = cdetect_file_stamp(argv[0]);
+    if (stamp == 0)
+        return CDETECT_FALSE;
+
+    hash = cdetect_hash_string(stamp->content, (unsigned int)CDETECT_VERSION);
+    for (i = 1; i < argc; ++i) {
+        hash = cdetect_hash_string(argv[i], hash);
+    }
+    hash = cdetect_hash_string(getenv("CC"), hash);
+    hash = cdetect_hash_string(getenv("CFLAGS"), hash);
+    hash = cdetect_hash_string(getenv("PATH"), hash);
+
+    cdetect_run_base = hash;
+    cdetect_is_run_prepared = CDETECT_TRUE;
+
+    cdetect_string_destroy(stamp);
+
+    return CDETECT_TRUE;
+}
+
+/*
+ * Complete the fingerprint with the compiler
+ *
+ * Returns the null pointer (0) if the compiler cannot be found.
+ */
+
+cdetect_string_t
+cdetect_run_fingerprint(const char *compiler)
+{
+    cdetect_string_t result = 0;
+    cdetect_string_t executable;
+    cdetect_string_t remainder;
+    cdetect_string_t stamp;
+
+    /* Does not handle quoted spaces in path */
+    executable = cdetect_string_format("%s", compiler);
+    remainder = cdetect_string_split(executable, ' ');
+    stamp = cdetect_file_stamp(executable->content);
+    if (stamp) {
+        result = cdetect_string_format("%x",
+                                       cdetect_hash_string(stamp->content,
+                                                           cdetect_hash_string(compiler, cdetect_run_base)));
+    }
+    cdetect_string_destroy(stamp);
+    cdetect_string_destroy(remainder);
+    cdetect_string_destroy(executable);
+
+    return result;
+}
+
+/*
+ * Check if the previous run is still up to date
+ */
+
+cdetect_bool_t
+cdetect_run_check(void)
+{
+    cdetect_bool_t success = CDETECT_FALSE;
+    cdetect_map_element_t fingerprint;
+    cdetect_map_element_t compiler;
+    cdetect_map_element_t element;
+    cdetect_string_t current;
+    cdetect_list_t position;
+    size_t length;
+
+    if (!cdetect_is_run_prepared)
+        return CDETECT_FALSE;
+
+    fingerprint = cdetect_map_lookup(cdetect_run_map, cdetect_run_key_fingerprint);
+    compiler = cdetect_map_lookup(cdetect_run_map, cdetect_run_key_compiler);
+    if (fingerprint && fingerprint->data && compiler && compiler->data) {
+        current = cdetect_run_fingerprint((const char *)compiler->data);
+        success = (cdetect_bool_t)(current && cdetect_strequal(current->content,
+                                                               (const char *)fingerprint->data));
+        cdetect_string_destroy(current);
+    }
+
+    length = strlen(cdetect_run_key_file);
+    for (position = cdetect_list_front(cdetect_run_map->first);
+         success && (position != 0);
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && cdetect_strequal_max(element->key, length, cdetect_run_key_file)) {
+            current = cdetect_file_hash(&element->key[length]);
+            success = (cdetect_bool_t)(current && element->data &&
+                                       cdetect_strequal(current->content,
+                                                        (const char *)element->data));
+            if (!success) {
+                cdetect_log("cdetect_run_check() %'s changed\n", &element->key[length]);
+            }
+            cdetect_string_destroy(current);
+        }
+    }
+
+    /* Installed or removed headers invalidate the run */
+    for (position = cdetect_list_front(cdetect_header_map->first);
+         success && (position != 0);
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && element->data) {
+            success = (cdetect_bool_t)!cdetect_header_is_stale(element->key,
+                                                                cdetect_strequal((const char *)element->data, "1"));
+        }
+    }
+    return success;
+}
+
+/*
+ * Remember a file of this run
+ */
+
+void
+cdetect_run_remember_file(const char *filename)
 {
-    assert(cdetect_build_map != 0);
+    cdetect_string_t key;
+    cdetect_string_t hash;
 
-    if (source && target) {
-        if (cdetect_map_remember(cdetect_build_map, source, target))
-            return CDETECT_TRUE;
+    hash = cdetect_file_hash(filename);
+    if (hash) {
+        key = cdetect_string_format("%s%s", cdetect_run_key_file, filename);
+        (void)cdetect_map_remember(cdetect_run_map, key->content, hash->content);
+        cdetect_string_destroy(key);
+        cdetect_string_destroy(hash);
     }
-    return CDETECT_FALSE;
 }
 
-int
-config_work_directory_register(const char *base)
-{
-    cdetect_string_destroy(cdetect_work_directory);
-    cdetect_work_directory = cdetect_string_format("%s", base);
-    /* FIXME: Modify work files */
-    return (cdetect_work_directory != 0);
-}
+/*
+ * Remember the fingerprint and files of this run
+ *
+ * Must be called after all files have been generated.
+ */
 
-int
-config_copyright_notice(const char *notice)
+void
+cdetect_run_remember(void)
 {
-    cdetect_string_destroy(cdetect_copyright_notice);
-    cdetect_copyright_notice = cdetect_string_format("%s", notice);
-    return (cdetect_copyright_notice != 0);
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t fingerprint = 0;
+    cdetect_string_t name;
+
+    /* Forget the previous run */
+    cdetect_map_destroy(cdetect_run_map);
+    cdetect_run_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                         (cdetect_map_destroy_t)cdetect_free);
+
+    /* Results that timed out must be checked again */
+    if (cdetect_is_run_prepared && cdetect_command_compile && !cdetect_timeout_exist()) {
+        fingerprint = cdetect_run_fingerprint(cdetect_command_compile);
+    }
+    if (fingerprint == 0)
+        return;
+
+    (void)cdetect_map_remember(cdetect_run_map, cdetect_run_key_fingerprint, fingerprint->content);
+    (void)cdetect_map_remember(cdetect_run_map, cdetect_run_key_compiler, cdetect_command_compile);
+    if (cdetect_include_file) {
+        cdetect_run_remember_file(cdetect_include_file->content);
+        for (position = cdetect_list_front(cdetect_variant_map->first);
+             position != 0;
+             position = cdetect_list_next(position)) {
+            element = (cdetect_map_element_t)position->data;
+            if (element) {
+                name = cdetect_variant_file(cdetect_include_file->content, element->key);
+                cdetect_run_remember_file(name->content);
+                cdetect_string_destroy(name);
+            }
+        }
+    }
+    for (position = cdetect_list_front(cdetect_build_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element) {
+            cdetect_run_remember_file(element->key);
+            cdetect_run_remember_file((const char *)element->data);
+        }
+    }
+    for (position = cdetect_list_front(cdetect_depend_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element) {
+            cdetect_run_remember_file(element->key);
+        }
+    }
+    cdetect_string_destroy(fingerprint);
 }
 
 /*************************************************************************
@@ -6115,6 +12047,69 @@ cdetect_option_remote(const char *name, const char *argument)
     return CDETECT_TRUE;
 }
 
+cdetect_bool_t
+cdetect_option_remote_session(const char *name, const char *argument)
+{
+    (void)name;
+    (void)argument;
+
+    cdetect_is_remote_session = CDETECT_TRUE;
+
+    return CDETECT_TRUE;
+}
+
+cdetect_bool_t
+cdetect_option_timeout(const char *name, const char *argument)
+{
+    (void)name;
+
+    cdetect_timeout = (unsigned int)strtoul(argument, 0, 10);
+
+    return CDETECT_TRUE;
+}
+
+cdetect_bool_t
+cdetect_option_limits(const char *name, const char *argument)
+{
+    unsigned long values[4];
+    const char *current = argument;
+    char *end;
+    int i;
+
+    (void)name;
+
+    /* Memory, processor time, processes, file size */
+    for (i = 0; i < 4; ++i) {
+        values[i] = strtoul(current, &end, 10);
+        current = (*end == ',') ? end + 1 : end;
+    }
+    config_execute_limit_register(values[0], values[1], values[2], values[3]);
+
+    return CDETECT_TRUE;
+}
+
+cdetect_bool_t
+cdetect_option_trace(const char *name, const char *argument)
+{
+    (void)name;
+
+    cdetect_string_destroy(cdetect_trace_file);
+    cdetect_trace_file = cdetect_string_format("%s", argument);
+
+    return CDETECT_TRUE;
+}
+
+cdetect_bool_t
+cdetect_option_profile(const char *name, const char *argument)
+{
+    (void)name;
+    (void)argument;
+
+    cdetect_is_profile = CDETECT_TRUE;
+
+    return CDETECT_TRUE;
+}
+
 cdetect_bool_t
 cdetect_option_refresh(const char *name, const char *argument)
 {
@@ -6133,7 +12128,9 @@ cdetect_option_refresh(const char *name, const char *argument)
 void
 cdetect_load_files(void)
 {
+    cdetect_trace_begin("phase", "cache load");
     cdetect_cache_load();
+    cdetect_trace_end(0);
 }
 
 /*
@@ -6143,9 +12140,388 @@ cdetect_load_files(void)
 void
 cdetect_save_files(void)
 {
-    cdetect_cache_save();
+    cdetect_trace_begin("phase", "header save");
     cdetect_header_save();
+    cdetect_trace_end(0);
+    cdetect_trace_begin("phase", "substitution");
     cdetect_substitute_all_files();
+    cdetect_trace_end(0);
+    /* The cache holds the fingerprint of the generated files */
+    cdetect_run_remember();
+    cdetect_trace_begin("phase", "cache save");
+    cdetect_cache_save();
+    cdetect_trace_end(0);
+}
+
+/*************************************************************************
+ *
+ * Variants
+ *
+ ************************************************************************/
+
+/*
+ * Detect one variant and save its outputs
+ *
+ * The results of the variant are kept apart from those of the run, which
+ * are restored afterwards. The compiler detection and the tool index are
+ * shared with the run, but the compiler fingerprint covers the flags of
+ * the variant. Returns the outcome of the detection function.
+ */
+
+#define CDETECT_VARIANT_MAPS 14
+
+cdetect_bool_t
+cdetect_variant_detect(const char *variant,
+                       const char *cflags,
+                       config_variant_detect_t detect,
+                       void *data)
+{
+    cdetect_map_t *maps[CDETECT_VARIANT_MAPS];
+    cdetect_map_t saved[CDETECT_VARIANT_MAPS];
+    cdetect_map_t build;
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t include_file;
+    cdetect_file_t cache_file;
+    cdetect_string_t name;
+    cdetect_string_t fingerprint;
+    char *argument_cflags;
+    cdetect_bool_t is_run_prepared;
+    cdetect_bool_t success;
+    int i;
+
+    maps[0] = &cdetect_macro_map;
+    maps[1] = &cdetect_function_map;
+    maps[2] = &cdetect_header_map;
+    maps[3] = &cdetect_type_map;
+    maps[4] = &cdetect_library_map;
+    maps[5] = &cdetect_integer_map;
+    maps[6] = &cdetect_compile_map;
+    maps[7] = &cdetect_run_map;
+    maps[8] = &cdetect_header_location_map;
+    maps[9] = &cdetect_timeout_map;
+    maps[10] = &cdetect_build_map;
+    maps[11] = &cdetect_host_map;
+    maps[12] = &cdetect_cpu_feature_map;
+    maps[13] = &cdetect_cflag_map;
+    for (i = 0; i < CDETECT_VARIANT_MAPS; ++i) {
+        saved[i] = *maps[i];
+        *maps[i] = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                      (cdetect_map_destroy_t)cdetect_free);
+    }
+    cdetect_map_destroy(cdetect_header_directory_map);
+    cdetect_header_directory_map = 0;
+
+    include_file = cdetect_include_file;
+    cache_file = cdetect_cache_file;
+    argument_cflags = cdetect_argument_cflags;
+    fingerprint = cdetect_compiler_fingerprint_value;
+    is_run_prepared = cdetect_is_run_prepared;
+
+    cdetect_include_file = (include_file) ? cdetect_variant_file(include_file->content, variant) : 0;
+    cdetect_cache_file = cdetect_file_create();
+    name = cdetect_variant_file(cache_file->path->content, variant);
+    cdetect_file_append(cdetect_cache_file, name->content);
+    cdetect_string_destroy(name);
+    name = cdetect_string_format("%s %s", argument_cflags ? argument_cflags : "", cflags);
+    cdetect_argument_cflags = cdetect_strdup(name->content);
+    cdetect_string_destroy(name);
+    cdetect_compiler_fingerprint_value = 0;
+    /* The fingerprint of the run covers the variants */
+    cdetect_is_run_prepared = CDETECT_FALSE;
+
+    cdetect_log("cdetect_variant_detect(%'s, %'s)\n", variant, cdetect_argument_cflags);
+
+    cdetect_load_files();
+    success = (cdetect_bool_t)(detect(variant, data) != 0);
+    (void)config_execute_flush();
+
+    /* Build files registered by the variant get its name */
+    build = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                               (cdetect_map_destroy_t)cdetect_free);
+    for (position = cdetect_list_front(cdetect_build_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && element->data) {
+            name = cdetect_variant_file((const char *)element->data, variant);
+            (void)cdetect_map_remember(build, element->key, name->content);
+            cdetect_string_destroy(name);
+        }
+    }
+    cdetect_map_destroy(cdetect_build_map);
+    cdetect_build_map = build;
+
+    if (!(cdetect_is_usage || cdetect_is_nested || cdetect_is_dryrun)) {
+        cdetect_save_files();
+    }
+
+    for (i = 0; i < CDETECT_VARIANT_MAPS; ++i) {
+        cdetect_map_destroy(*maps[i]);
+        *maps[i] = saved[i];
+    }
+    cdetect_map_destroy(cdetect_header_directory_map);
+    cdetect_header_directory_map = 0;
+
+    cdetect_string_destroy(cdetect_include_file);
+    cdetect_include_file = include_file;
+    cdetect_file_destroy(cdetect_cache_file);
+    cdetect_cache_file = cache_file;
+    cdetect_free(cdetect_argument_cflags);
+    cdetect_argument_cflags = argument_cflags;
+    cdetect_string_destroy(cdetect_compiler_fingerprint_value);
+    cdetect_compiler_fingerprint_value = fingerprint;
+    cdetect_is_run_prepared = is_run_prepared;
+
+    return success;
+}
+
+/**
+   Register a variant.
+
+   A variant is a named set of compile-time flags, such as "-m32" or
+   "-fsanitize=address", that is detected by config_variant_run.
+
+   @param name Name of the variant, which is used in the names of its
+   output files.
+   @param cflags Compile-time flags of the variant.
+   @return Boolean indicating success or failure.
+
+   @sa config_variant_run
+*/
+
+int
+config_variant_register(const char *name,
+                        const char *cflags)
+{
+    if ((name == 0) || (name[0] == 0))
+        return CDETECT_FALSE;
+
+    return (cdetect_map_remember(cdetect_variant_map, name, cflags ? cflags : "") != 0);
+}
+
+/**
+   Detect all registered variants.
+
+   The detection function is called once for each variant, with the name
+   of the variant and @p data, and returns non-zero if the variant was
+   detected. Each variant is checked with its own compile-time flags added
+   to the global ones. Every variant writes its
+   own outputs: the name of the variant is inserted before the extension
+   of the header file (config.<variant>.h), of the cache, and of the build
+   files registered by the detection function.
+
+   The variants share the compiler detection and the tool index of the
+   run, and are detected concurrently on systems that can fork processes,
+   unless a remote session has already been started.
+   Results of checks outside of the detection function do not appear in
+   the outputs of the variants.
+
+   @param detect Detection function.
+   @param data User data passed to the detection function.
+   @return Number of variants that were detected.
+
+   @sa config_variant_register
+*/
+
+int
+config_variant_run(config_variant_detect_t detect,
+                   void *data)
+{
+    int result = 0;
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_string_t output;
+    cdetect_string_t name;
+    cdetect_bool_t success;
+    long *process;
+    int *channel;
+    int count;
+
+    process = (long *)cdetect_allocate((cdetect_variant_map->count + 1) * sizeof(*process));
+    channel = (int *)cdetect_allocate((cdetect_variant_map->count + 1) * sizeof(*channel));
+
+    count = 0;
+    for (position = cdetect_list_front(cdetect_variant_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element == 0)
+            continue;
+        /* A remote session cannot be shared between processes */
+        process[count] = (cdetect_session_input == -1) ? cdetect_process_fork(&channel[count]) : -1;
+        if (process[count] == 0) {
+            /* Child process reports through the channel */
+            (void)dup2(channel[count], 1);
+            name = cdetect_string_format("%sv%d", cdetect_file_execute, count);
+            cdetect_file_execute = name->content;
+            name = cdetect_string_format("%s.txt", cdetect_file_execute);
+            cdetect_file_redirection = name->content;
+            success = cdetect_variant_detect(element->key, (const char *)element->data, detect, data);
+            cdetect_session_stop();
+            cdetect_process_exit(channel[count], success ? 0 : 1);
+        }
+        ++count;
+    }
+
+    count = 0;
+    for (position = cdetect_list_front(cdetect_variant_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element == 0)
+            continue;
+        cdetect_output("variant %s\n", element->key);
+        if (process[count] > 0) {
+            output = cdetect_process_read(channel[count]);
+            cdetect_output("%^s", output);
+            cdetect_string_destroy(output);
+            if (cdetect_process_wait(process[count]) == 0) {
+                ++result;
+            } else {
+                cdetect_output("variant %s failed\n", element->key);
+            }
+        } else {
+            /* Not forked, so detect it here */
+            if (cdetect_variant_detect(element->key, (const char *)element->data, detect, data)) {
+                ++result;
+            } else {
+                cdetect_output("variant %s failed\n", element->key);
+            }
+        }
+        ++count;
+    }
+
+    cdetect_free(channel);
+    cdetect_free(process);
+#else
+    for (position = cdetect_list_front(cdetect_variant_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element) {
+            cdetect_output("variant %s\n", element->key);
+            if (cdetect_variant_detect(element->key, (const char *)element->data, detect, data)) {
+                ++result;
+            } else {
+                cdetect_output("variant %s failed\n", element->key);
+            }
+        }
+    }
+#endif
+    return result;
+}
+
+/*************************************************************************
+ *
+ * Contexts
+ *
+ ************************************************************************/
+
+/*
+ * Set the initial values of a context that are not zero
+ */
+
+void
+cdetect_context_initialize(cdetect_context_t self)
+{
+    if (self->is_initialized)
+        return;
+
+    self->is_initialized = CDETECT_TRUE;
+    self->file_execute = cdetect_file_execute_default;
+    self->file_redirection = cdetect_file_redirection_default;
+    self->session_input = -1;
+    self->session_output = -1;
+}
+
+/**
+   Create a detection context.
+
+   A context holds all the state of a detection. Detections in different
+   contexts are independent of each other, and can run in separate threads
+   of the same process. Each context uses its own temporary files, but the
+   header, cache and build files must be registered with distinct names.
+
+   Contexts must be created and destroyed by one thread at a time.
+
+   Remote sessions and commands with a deadline change the signal handling
+   of the whole process, and are counted for all contexts together, so
+   contexts that use them must not run in separate threads at the same time.
+
+   @return New context, or zero (0) if there is not enough memory.
+
+   @sa config_context_select
+   @sa config_context_destroy
+*/
+
+config_context_t
+config_context_create(void)
+{
+    cdetect_context_t self;
+
+    self = (cdetect_context_t)cdetect_allocate(sizeof(*self));
+    if (self) {
+        (void)memset(self, 0, sizeof(*self));
+        cdetect_context_initialize(self);
+        ++cdetect_context_count;
+        self->file_execute_name = cdetect_string_format("%sc%u",
+                                                        cdetect_file_execute_default,
+                                                        cdetect_context_count);
+        self->file_redirection_name = cdetect_string_format("cdetmpc%u.txt",
+                                                            cdetect_context_count);
+        self->file_execute = self->file_execute_name->content;
+        self->file_redirection = self->file_redirection_name->content;
+        (void)cdetect_clock(); /* Start the clock before any thread uses it */
+    }
+    return self;
+}
+
+/**
+   Destroy a detection context.
+
+   The detection in the context must have been ended with config_end. If the
+   context is selected by the calling thread, the default context is selected
+   instead.
+
+   @param context Context created by config_context_create.
+*/
+
+void
+config_context_destroy(config_context_t context)
+{
+    if ((context == 0) || (context == &cdetect_context_default))
+        return;
+
+    if (cdetect_context_current == context) {
+        cdetect_context_current = &cdetect_context_default;
+    }
+    cdetect_string_destroy(context->file_redirection_name);
+    cdetect_string_destroy(context->file_execute_name);
+    cdetect_free(context);
+}
+
+/**
+   Select the detection context of the calling thread.
+
+   All config_ functions called by the thread afterwards operate on the
+   selected context. Each thread starts with the default context, which is
+   also used by programs that never select a context. A context must only
+   be selected by one thread at a time.
+
+   @param context Context created by config_context_create, or zero (0) for
+   the default context.
+   @return Previously selected context.
+*/
+
+config_context_t
+config_context_select(config_context_t context)
+{
+    cdetect_context_t previous = cdetect_context_current;
+
+    cdetect_context_current = (context) ? context : &cdetect_context_default;
+    return previous;
 }
 
 /*
@@ -6155,6 +12531,8 @@ cdetect_save_files(void)
 void
 cdetect_global_create(void)
 {
+    cdetect_context_initialize(cdetect_context_current);
+
     cdetect_option_map = cdetect_map_create(0, (cdetect_map_destroy_t)cdetect_option_destroy);
     cdetect_option_value_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
                                                   (cdetect_map_destroy_t)cdetect_free);
@@ -6169,11 +12547,43 @@ cdetect_global_create(void)
                                           (cdetect_map_destroy_t)cdetect_free);
     cdetect_library_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
                                              (cdetect_map_destroy_t)cdetect_free);
+    cdetect_host_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                          (cdetect_map_destroy_t)cdetect_free);
+    cdetect_cpu_feature_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                                 (cdetect_map_destroy_t)cdetect_free);
+    cdetect_cflag_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                           (cdetect_map_destroy_t)cdetect_free);
+    cdetect_predefined_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                                (cdetect_map_destroy_t)cdetect_free);
+    cdetect_integer_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                             (cdetect_map_destroy_t)cdetect_free);
+    cdetect_compiler_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                              (cdetect_map_destroy_t)cdetect_free);
 
     cdetect_tool_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
                                           (cdetect_map_destroy_t)cdetect_free);
+    cdetect_path_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                          (cdetect_map_destroy_t)cdetect_free);
+    cdetect_compile_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                             (cdetect_map_destroy_t)cdetect_free);
+    cdetect_run_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                         (cdetect_map_destroy_t)cdetect_free);
+    cdetect_header_location_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                                     (cdetect_map_destroy_t)cdetect_free);
+    cdetect_timeout_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                             (cdetect_map_destroy_t)cdetect_free);
+    cdetect_variant_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                             (cdetect_map_destroy_t)cdetect_free);
     cdetect_build_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
                                            (cdetect_map_destroy_t)cdetect_free);
+    cdetect_depend_map = cdetect_map_create((cdetect_map_create_t)cdetect_strdup,
+                                            (cdetect_map_destroy_t)cdetect_free);
+    cdetect_execute_queue = cdetect_list_create();
+    cdetect_trace_stack = cdetect_stack_create();
+    cdetect_profile_phase_map = cdetect_map_create(0, (cdetect_map_destroy_t)cdetect_free);
+    cdetect_profile_probe_map = cdetect_map_create(0, (cdetect_map_destroy_t)cdetect_free);
+    cdetect_profile_checks = cdetect_list_create();
+    (void)cdetect_clock(); /* Start of run */
 }
 
 /*
@@ -6191,7 +12601,23 @@ cdetect_global_destroy(void)
     cdetect_string_destroy(cdetect_cpu_name);
     cdetect_string_destroy(cdetect_kernel_name);
     cdetect_string_destroy(cdetect_compiler_name);
-
+    cdetect_string_destroy(cdetect_compiler_fingerprint_value);
+
+    while (!cdetect_stack_empty(cdetect_trace_stack)) {
+        cdetect_trace_end(0);
+    }
+    cdetect_stack_destroy(cdetect_trace_stack);
+    while (!cdetect_list_empty(cdetect_profile_checks)) {
+        cdetect_profile_check_destroy((cdetect_profile_check_t)cdetect_stack_pop(cdetect_profile_checks));
+    }
+    cdetect_list_destroy(cdetect_profile_checks);
+    cdetect_string_destroy(cdetect_profile_source);
+    cdetect_map_destroy(cdetect_profile_probe_map);
+    cdetect_map_destroy(cdetect_profile_phase_map);
+    cdetect_string_destroy(cdetect_trace_events);
+    cdetect_string_destroy(cdetect_trace_file);
+    cdetect_list_destroy(cdetect_execute_queue);
+    cdetect_map_destroy(cdetect_depend_map);
     cdetect_map_destroy(cdetect_build_map);
     cdetect_string_destroy(cdetect_copyright_notice);
     cdetect_file_destroy(cdetect_cache_file);
@@ -6202,8 +12628,22 @@ cdetect_global_destroy(void)
     cdetect_string_destroy(cdetect_library_format);
     cdetect_string_destroy(cdetect_type_format);
 
+    cdetect_map_destroy(cdetect_header_directory_map);
+    cdetect_header_directory_map = 0;
+    cdetect_map_destroy(cdetect_variant_map);
+    cdetect_map_destroy(cdetect_timeout_map);
+    cdetect_map_destroy(cdetect_header_location_map);
+    cdetect_map_destroy(cdetect_run_map);
+    cdetect_map_destroy(cdetect_compile_map);
+    cdetect_map_destroy(cdetect_path_map);
     cdetect_map_destroy(cdetect_tool_map);
 
+    cdetect_map_destroy(cdetect_compiler_map);
+    cdetect_map_destroy(cdetect_integer_map);
+    cdetect_map_destroy(cdetect_predefined_map);
+    cdetect_map_destroy(cdetect_cflag_map);
+    cdetect_map_destroy(cdetect_cpu_feature_map);
+    cdetect_map_destroy(cdetect_host_map);
     cdetect_map_destroy(cdetect_library_map);
     cdetect_map_destroy(cdetect_type_map);
     cdetect_map_destroy(cdetect_header_map);
@@ -6214,6 +12654,20 @@ cdetect_global_destroy(void)
     cdetect_map_destroy(cdetect_option_map);
 }
 
+/*
+ * Run as a helper program of another run
+ *
+ * Nothing is output, no options are registered, and no files are created.
+ * Must be called before config_begin.
+ */
+
+void
+cdetect_nested(void)
+{
+    cdetect_is_silent = CDETECT_TRUE;
+    cdetect_is_nested = CDETECT_TRUE;
+}
+
 /**
    Begin detection.
 
@@ -6222,7 +12676,7 @@ cdetect_global_destroy(void)
 
    A cDetect program must be constructed according to the following template:
    @code
-   #include "cdetect.c"
+   #include "cdetect/cdetect.c"
 
    int main(int argc, char *argv[])
    {
@@ -6260,6 +12714,11 @@ config_begin(void)
         cdetect_option_register("compiler", "c", "", 0, "Use argument as compiler", cdetect_option_compiler);
         cdetect_option_register("cflags", 0, "", 0, "Use argument as compile-time flags", cdetect_option_cflags);
         cdetect_option_register("remote", 0, "", 0, "Redirect execution to <argument>", cdetect_option_remote);
+        cdetect_option_register("remote-session", 0, 0, 0, "Keep one remote connection for all executions", cdetect_option_remote_session);
+        cdetect_option_register("timeout", 0, "", 0, "Stop each compilation and execution after <argument> seconds", cdetect_option_timeout);
+        cdetect_option_register("limits", 0, "", 0, "Limit executed programs to <memory MB>,<cpu seconds>,<processes>,<file MB>", cdetect_option_limits);
+        cdetect_option_register("trace", 0, "", 0, "Write timing of checks to <argument> (Chrome trace format)", cdetect_option_trace);
+        cdetect_option_register("profile", 0, 0, 0, "Output a timing summary at the end", cdetect_option_profile);
     }
 
     config_header_register("config.h");
@@ -6283,12 +12742,17 @@ config_begin(void)
 void
 config_end(void)
 {
+    (void)config_execute_flush();
+    cdetect_session_stop();
+
     /* Make sure CFLAGS variable exists */
     config_tool_get("CFLAGS") || config_tool_define("CFLAGS", "");
 
-    if (!(cdetect_is_usage || cdetect_is_nested || cdetect_is_dryrun)) {
+    if (!(cdetect_is_usage || cdetect_is_nested || cdetect_is_dryrun || cdetect_is_uptodate)) {
         cdetect_save_files();
     }
+    cdetect_trace_save();
+    cdetect_profile_report();
     cdetect_global_destroy();
 }
 
@@ -6312,6 +12776,11 @@ config_abort(void)
    User-defined command-line options must have been registered before this
    function is called.
 
+   False is also returned if nothing has changed since the previous run:
+   neither the configure program, its options, the environment variables
+   CC, CFLAGS and PATH, the compiler, nor any template or generated file.
+   In that case @c config_end leaves all files untouched.
+
    @sa config_option_register
    @sa config_option_register_group
 */
@@ -6319,13 +12788,27 @@ config_abort(void)
 int
 config_options(int argc, char *argv[])
 {
-    if (cdetect_parse_options(argc, argv) && cdetect_initialize()) {
+    if (cdetect_parse_options(argc, argv)) {
 
+        /* Cached results are needed to find the compiler */
         cdetect_load_files();
 
-        return (int)CDETECT_TRUE;
+        if (!(cdetect_is_nested || cdetect_is_dryrun) &&
+            cdetect_run_prepare(argc, argv) &&
+            cdetect_run_check()) {
+            cdetect_output_version();
+            cdetect_output("configuration is up to date\n");
+            cdetect_is_uptodate = CDETECT_TRUE;
+            return (int)CDETECT_FALSE;
+        }
+
+        if (cdetect_initialize()) {
+            return (int)CDETECT_TRUE;
+        }
     }
     return (int)CDETECT_FALSE;
 }
 
+#endif /* !CDETECT_USE_LIBRARY */
+
 #endif /* CDETECT_C_INCLUDE_GUARD */
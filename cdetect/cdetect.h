@@ -0,0 +1,301 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*************************************************************************
+ *
+ * http://cdetect.sourceforge.net/
+ *
+ * Copyright (C) 2005-2010 Bjorn Reese <breese@users.sourceforge.net>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES OF
+ * MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS AND
+ * CONTRIBUTORS ACCEPT NO RESPONSIBILITY IN ANY CONCEIVABLE MANNER.
+ *
+ ************************************************************************/
+
+#ifndef CDETECT_H_INCLUDE_GUARD
+#define CDETECT_H_INCLUDE_GUARD
+
+/** @file cdetect.h
+
+@brief Declares the interface of cdetect.c.
+
+cdetect.c is normally included into the configure program. It can also be
+compiled once into an object file, which is linked with configure programs
+that are compiled with CDETECT_USE_LIBRARY defined. cdetect.c then only
+includes this file.
+*/
+
+#include <stddef.h>
+
+#define CDETECT_VERSION_MAJOR 0
+#define CDETECT_VERSION_MINOR 2
+#define CDETECT_VERSION_PATCH 2
+
+#define CDETECT_MKVER(v,r,p) (((v) << 24) + ((r) << 16) + (p))
+
+#define CDETECT_VERSION CDETECT_MKVER(CDETECT_VERSION_MAJOR, CDETECT_VERSION_MINOR, CDETECT_VERSION_PATCH)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/*************************************************************************
+ *
+ * Types
+ *
+ ************************************************************************/
+
+typedef struct cdetect_glob *config_pattern_t;
+typedef struct cdetect_context *config_context_t;
+
+typedef int (*config_tool_check_filter_t)(const char *, void *);
+typedef int (*config_variant_detect_t)(const char *, void *);
+typedef void (*config_execute_callback_t)(void *, int, const char *);
+
+/*************************************************************************
+ *
+ * Shared with chost.c
+ *
+ ************************************************************************/
+
+typedef enum {
+    CDETECT_FALSE = 0,
+    CDETECT_TRUE = 1
+} cdetect_bool_t;
+
+/*
+ * Dynamic string
+ */
+
+typedef struct cdetect_string
+{
+    char *content;
+    size_t length;
+    size_t allocated;
+} * cdetect_string_t;
+
+cdetect_string_t cdetect_string_format(const char *format, ...);
+int cdetect_string_scan(cdetect_string_t self, const char *format, ...);
+void cdetect_string_destroy(cdetect_string_t self);
+cdetect_bool_t cdetect_execute(cdetect_string_t command,
+                               cdetect_string_t *result,
+                               cdetect_bool_t is_remote);
+void cdetect_nested(void);
+
+/*************************************************************************
+ *
+ * Begin and End
+ *
+ ************************************************************************/
+
+void config_begin(void);
+void config_end(void);
+int config_abort(void);
+int config_options(int argc, char *argv[]);
+unsigned int config_version(unsigned int major,
+                            unsigned int minor,
+                            unsigned int patch);
+
+/*************************************************************************
+ *
+ * Contexts
+ *
+ ************************************************************************/
+
+config_context_t config_context_create(void);
+void config_context_destroy(config_context_t context);
+config_context_t config_context_select(config_context_t context);
+
+/*************************************************************************
+ *
+ * Strings
+ *
+ ************************************************************************/
+
+int config_equal(const char *first, const char *second);
+int config_match(const char *string, const char *pattern);
+config_pattern_t config_pattern_compile(const char *pattern);
+int config_pattern_match(config_pattern_t pattern, const char *string);
+void config_pattern_destroy(config_pattern_t pattern);
+
+/*************************************************************************
+ *
+ * Reports
+ *
+ ************************************************************************/
+
+int config_report(const char *format, ...);
+void config_report_bool(const char *message, int found);
+void config_report_string(const char *message, const char *value);
+
+/*************************************************************************
+ *
+ * Compilation and Execution
+ *
+ ************************************************************************/
+
+int config_compile_source(const char *source, const char *cflags);
+int config_file_create(const char *filename, const char *message);
+int config_file_remove(const char *filename);
+int config_file_exist_format(const char *format, ...);
+int config_file_compile(const char *filename, const char *cflags);
+int config_execute_source(const char *source,
+                          const char *cflags,
+                          const char *args);
+int config_execute_source_timeout(const char *source,
+                                  const char *cflags,
+                                  const char *args,
+                                  unsigned int seconds);
+int config_timeout_expired(void);
+int config_execute_command(const char *command, ...);
+int config_execute_source_queue(const char *source,
+                                const char *cflags,
+                                const char *args,
+                                config_execute_callback_t callback,
+                                void *closure);
+int config_execute_flush(void);
+
+/*************************************************************************
+ *
+ * Macros
+ *
+ ************************************************************************/
+
+int config_macro_define(const char *macro, const char *value);
+int config_macro_define_format(const char *macro, const char *format, ...);
+
+/*************************************************************************
+ *
+ * Functions and Libraries
+ *
+ ************************************************************************/
+
+int config_library_register_format(const char *format);
+void config_function_define(const char *function,
+                            const char *library,
+                            int found);
+int config_function_check_library(const char *function, const char *library);
+int config_function_check(const char *function);
+int config_function_register_format(const char *format);
+
+/*************************************************************************
+ *
+ * Headers
+ *
+ ************************************************************************/
+
+void config_header_define(const char *header, int found);
+int config_header_check(const char *header);
+int config_header_check_depend(const char *header, const char *dependencies);
+int config_header_check_first_of(const char *headers);
+int config_header_register(const char *target);
+int config_header_register_format(const char *format);
+
+/*************************************************************************
+ *
+ * Types
+ *
+ ************************************************************************/
+
+void config_type_define(const char *type, const char *header, int found);
+int config_type_check_header(const char *type, const char *header);
+int config_type_check_first_of(const char *type, const char *headers);
+int config_type_check(const char *type);
+int config_type_register_format(const char *format);
+int config_compute_int(const char *expression,
+                       const char *headers,
+                       long *value);
+
+/*************************************************************************
+ *
+ * Tools
+ *
+ ************************************************************************/
+
+int config_tool_define(const char *tool, const char *value);
+int config_tool_define_bool(const char *tool, int value);
+int config_tool_define_format(const char *tool, const char *format, ...);
+int config_tool_define_command(const char *tool, const char *command, ...);
+const char *config_tool_get(const char *tool);
+const char *config_tool_check_filter(const char *variable,
+                                     const char *tool,
+                                     config_tool_check_filter_t filter,
+                                     void *closure);
+const char *config_tool_check(const char *variable, const char *tool);
+
+/*************************************************************************
+ *
+ * Host
+ *
+ ************************************************************************/
+
+const char *config_predefined(const char *name);
+const char *config_compiler(void);
+unsigned int config_compiler_version(void);
+int config_compiler_check(void);
+const char *config_kernel(void);
+unsigned int config_kernel_version(void);
+int config_kernel_check(void);
+const char *config_cpu(void);
+unsigned int config_cpu_version(void);
+int config_cpu_check(void);
+int config_cpu_features(void);
+
+/*************************************************************************
+ *
+ * Compiler Flags
+ *
+ ************************************************************************/
+
+int config_cflag_check(const char *variable, const char *flags);
+
+/*************************************************************************
+ *
+ * Options
+ *
+ ************************************************************************/
+
+const char *config_option_get(const char *long_name);
+int config_option_set(const char *long_name, const char *value);
+int config_option_register_group(const char *group);
+int config_option_register(const char *long_name,
+                           const char *short_name,
+                           const char *default_value,
+                           const char *default_argument,
+                           const char *help);
+
+/*************************************************************************
+ *
+ * Settings
+ *
+ ************************************************************************/
+
+int config_cache_register(const char *target);
+int config_build_register(const char *source, const char *target);
+int config_depend_register(const char *filename);
+unsigned int config_timeout_register(unsigned int seconds);
+void config_execute_limit_register(unsigned long memory,
+                                   unsigned long cpu,
+                                   unsigned long processes,
+                                   unsigned long file_size);
+int config_work_directory_register(const char *base);
+int config_copyright_notice(const char *notice);
+
+/*************************************************************************
+ *
+ * Variants
+ *
+ ************************************************************************/
+
+int config_variant_register(const char *name, const char *cflags);
+int config_variant_run(config_variant_detect_t detect, void *data);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CDETECT_H_INCLUDE_GUARD */
@@ -629,8 +629,7 @@ int main(int argc, char *argv[])
     cdetect_string_t cpu_name = 0;
     unsigned int cpu_version;
 
-    cdetect_is_silent = CDETECT_TRUE;
-    cdetect_is_nested = CDETECT_TRUE;
+    cdetect_nested();
   
     config_begin();
 
@@ -0,0 +1,619 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil -*- */
+/*************************************************************************
+ *
+ * http://cdetect.sourceforge.net/
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED ``AS IS'' AND WITHOUT ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, WITHOUT LIMITATION, THE IMPLIED WARRANTIES OF
+ * MERCHANTIBILITY AND FITNESS FOR A PARTICULAR PURPOSE. THE AUTHORS AND
+ * CONTRIBUTORS ACCEPT NO RESPONSIBILITY IN ANY CONCEIVABLE MANNER.
+ *
+ ************************************************************************/
+
+/*************************************************************************
+ *
+ * Spec file driver
+ *
+ * Performs the checks listed in a spec file, so that a project does not
+ * need to compile its own configure program. The driver is built once:
+ *
+ *   cc -I. -o cdriver cdetect/driver.c
+ *
+ * and reads config.spec, or the file given with --spec=FILE. Each line of
+ * the spec file holds one directive; '#' starts a comment.
+ *
+ * Declarations:
+ *
+ *   output FILE                 Generated header file (default config.h)
+ *   cache FILE                  Cache file (default cachect.txt)
+ *   format KIND FORMAT          Macro format of header, function, library
+ *                               or type checks (e.g. HAVE_%s)
+ *   group TEXT                  Group of the following options
+ *   option NAME DEFAULT TEXT    Option with a mandatory argument, which is
+ *                               also defined as tool variable NAME
+ *   template SOURCE TARGET      Template to substitute
+ *
+ * Checks:
+ *
+ *   header HEADER ...           Headers
+ *   function FUNCTION ...       Functions
+ *   library LIBRARY FUNCTION ...  Functions in a library
+ *   type TYPE [in HEADER]       Type, optionally declared in a header. The
+ *                               type may have several words (unsigned long)
+ *   tool VARIABLE TOOL ...      First of the tools found in PATH
+ *   define MACRO [VALUE]        Macro in the generated header file
+ *
+ * The driver uses the internals of cdetect.c, so it must be built without
+ * CDETECT_USE_LIBRARY.
+ *
+ * Declarations are made before the command-line options are handled,
+ * and checks afterwards, in the order of the spec file. As all checks are
+ * known up front, the compilations of the checks are first done by the
+ * number of concurrent jobs given with --jobs, and the checks then reuse
+ * these outcomes in order.
+ *
+ ************************************************************************/
+
+#include "cdetect.c"
+
+typedef struct driver_line {
+    unsigned int number;
+    int count;
+    char **word;
+} *driver_line_t;
+
+const char *driver_spec_default = "config.spec";
+const char *driver_jobs_default = "4";
+
+/*************************************************************************
+ *
+ * Spec File
+ *
+ ************************************************************************/
+
+/*
+ * Split a line into words
+ */
+
+driver_line_t
+driver_line_create(unsigned int number,
+                   const char *text)
+{
+    driver_line_t self;
+    size_t length;
+    size_t i;
+
+    self = (driver_line_t)cdetect_allocate(sizeof(*self));
+    if (self) {
+        self->number = number;
+        self->count = 0;
+        self->word = (char **)cdetect_allocate((strlen(text) / 2 + 1) * sizeof(*self->word));
+        i = strspn(text, " \t");
+        while (text[i] != 0) {
+            length = strcspn(&text[i], " \t");
+            self->word[self->count] = (char *)cdetect_allocate(length + 1);
+            cdetect_strcopy(self->word[self->count], &text[i], length);
+            ++self->count;
+            i += length;
+            i += strspn(&text[i], " \t");
+        }
+    }
+    return self;
+}
+
+void
+driver_line_destroy(driver_line_t self)
+{
+    int i;
+
+    if (self) {
+        for (i = 0; i < self->count; ++i) {
+            cdetect_free(self->word[i]);
+        }
+        cdetect_free(self->word);
+        cdetect_free(self);
+    }
+}
+
+/*
+ * Join the words of a line from @p first up to, but excluding, @p end
+ */
+
+cdetect_string_t
+driver_line_range(driver_line_t self,
+                  int first,
+                  int end)
+{
+    cdetect_string_t result;
+    int i;
+
+    result = cdetect_string_create();
+    (void)cdetect_string_append(result, "");
+    for (i = first; i < end; ++i) {
+        if (i > first) {
+            (void)cdetect_string_append_char(result, ' ');
+        }
+        (void)cdetect_string_append(result, self->word[i]);
+    }
+    return result;
+}
+
+/*
+ * Join the words of a line, starting with @p first
+ */
+
+cdetect_string_t
+driver_line_rest(driver_line_t self,
+                 int first)
+{
+    return driver_line_range(self, first, self->count);
+}
+
+/*
+ * Read the directives of a spec file
+ */
+
+cdetect_list_t
+driver_spec_read(const char *filename)
+{
+    cdetect_list_t result;
+    cdetect_list_t last;
+    cdetect_string_t input;
+    cdetect_string_t rest;
+    driver_line_t line;
+    unsigned int number = 0;
+    char *comment;
+
+    if (!cdetect_file_read(filename, &input)) {
+        cdetect_fatal("Cannot read spec file %'s\n", filename);
+    }
+
+    result = last = cdetect_list_create();
+    while (input) {
+        rest = cdetect_string_split(input, '\n');
+        ++number;
+        comment = strchr(input->content, '#');
+        if (comment) {
+            *comment = 0;
+        }
+        cdetect_string_trim(input, "\r");
+        line = driver_line_create(number, input->content);
+        if (line && (line->count > 0)) {
+            cdetect_list_insert(last, line);
+            last = last->next;
+        } else {
+            driver_line_destroy(line);
+        }
+        cdetect_string_destroy(input);
+        input = rest;
+    }
+    return result;
+}
+
+void
+driver_spec_destroy(cdetect_list_t lines)
+{
+    cdetect_list_t position;
+
+    for (position = cdetect_list_front(lines);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        driver_line_destroy((driver_line_t)position->data);
+    }
+    cdetect_list_destroy(lines);
+}
+
+/*
+ * Find the name of the spec file on the command-line
+ *
+ * The spec file declares the options, so it must be read before the
+ * options are handled.
+ */
+
+const char *
+driver_spec_name(int argc, char *argv[])
+{
+    const char *result = driver_spec_default;
+    const char *option = "--spec";
+    size_t length = strlen(option);
+    int i;
+
+    for (i = 1; i < argc; ++i) {
+        if (cdetect_strequal(argv[i], option) && (i + 1 < argc)) {
+            result = argv[++i];
+        } else if ((strlen(argv[i]) > length) &&
+                   cdetect_strequal_max(argv[i], length, option) &&
+                   (argv[i][length] == '=')) {
+            result = &argv[i][length + 1];
+        }
+    }
+    return result;
+}
+
+/*************************************************************************
+ *
+ * Directives
+ *
+ ************************************************************************/
+
+void
+driver_invalid(driver_line_t line)
+{
+    cdetect_fatal("Invalid directive %'s in line %u of spec file\n",
+                  line->word[0], line->number);
+}
+
+/*
+ * Find the word "in" that precedes the header of a type check
+ *
+ * Returns the number of words if there is no header.
+ */
+
+int
+driver_type_end(driver_line_t line)
+{
+    int i;
+
+    for (i = 1; (i < line->count) && !cdetect_strequal(line->word[i], "in"); ++i)
+        continue;
+    return i;
+}
+
+/*
+ * Is the line a check
+ *
+ * Checks are validated before any of them is performed, so that a spec
+ * file with errors has no effect.
+ */
+
+cdetect_bool_t
+driver_is_check(driver_line_t line)
+{
+    const char *keyword = line->word[0];
+    int end;
+    int i;
+
+    if (cdetect_strequal(keyword, "header") ||
+        cdetect_strequal(keyword, "function")) {
+
+    } else if (cdetect_strequal(keyword, "library") ||
+               cdetect_strequal(keyword, "tool")) {
+        if (line->count < 3)
+            driver_invalid(line);
+
+    } else if (cdetect_strequal(keyword, "type")) {
+        /* A word that looks like a header must follow "in" */
+        end = driver_type_end(line);
+        for (i = 1; i < end; ++i) {
+            if (strpbrk(line->word[i], "./<>\"") != 0)
+                driver_invalid(line);
+        }
+        if ((end == 1) || ((end < line->count) && (end + 2 != line->count)))
+            driver_invalid(line);
+
+    } else if (cdetect_strequal(keyword, "define")) {
+        if ((line->count < 2) || (line->count > 3))
+            driver_invalid(line);
+
+    } else {
+        return CDETECT_FALSE;
+    }
+    return CDETECT_TRUE;
+}
+
+/*
+ * Make a declaration
+ *
+ * Returns false if the line is not a declaration.
+ */
+
+cdetect_bool_t
+driver_declare(driver_line_t line)
+{
+    const char *keyword = line->word[0];
+    cdetect_string_t rest;
+
+    if (cdetect_strequal(keyword, "output")) {
+        if (line->count != 2)
+            driver_invalid(line);
+        config_header_register(line->word[1]);
+
+    } else if (cdetect_strequal(keyword, "cache")) {
+        if (line->count != 2)
+            driver_invalid(line);
+        config_cache_register(line->word[1]);
+
+    } else if (cdetect_strequal(keyword, "format")) {
+        if (line->count != 3)
+            driver_invalid(line);
+        if (cdetect_strequal(line->word[1], "header")) {
+            config_header_register_format(line->word[2]);
+        } else if (cdetect_strequal(line->word[1], "function")) {
+            config_function_register_format(line->word[2]);
+        } else if (cdetect_strequal(line->word[1], "library")) {
+            config_library_register_format(line->word[2]);
+        } else if (cdetect_strequal(line->word[1], "type")) {
+            config_type_register_format(line->word[2]);
+        } else {
+            driver_invalid(line);
+        }
+
+    } else if (cdetect_strequal(keyword, "group")) {
+        rest = driver_line_rest(line, 1);
+        config_option_register_group(rest->content);
+        cdetect_string_destroy(rest);
+
+    } else if (cdetect_strequal(keyword, "option")) {
+        if (line->count < 3)
+            driver_invalid(line);
+        rest = driver_line_rest(line, 3);
+        config_option_register(line->word[1], 0, line->word[2], 0, rest->content);
+        cdetect_string_destroy(rest);
+
+    } else if (cdetect_strequal(keyword, "template")) {
+        if (line->count != 3)
+            driver_invalid(line);
+        config_build_register(line->word[1], line->word[2]);
+
+    } else {
+        return CDETECT_FALSE;
+    }
+    return CDETECT_TRUE;
+}
+
+/*
+ * Perform the checks of a line
+ *
+ * Checks are numbered across lines by @p counter, and only those whose
+ * number modulo @p jobs is @p job are performed. Checks that do not
+ * compile are skipped when @p is_prefetch is set.
+ */
+
+void
+driver_check(driver_line_t line,
+             unsigned int *counter,
+             int job,
+             int jobs,
+             cdetect_bool_t is_prefetch)
+{
+    const char *keyword = line->word[0];
+    cdetect_bool_t is_found;
+    cdetect_string_t type;
+    int i;
+
+#define DRIVER_IS_MINE() ((int)((*counter)++ % (unsigned int)jobs) == job)
+
+    if (cdetect_strequal(keyword, "header")) {
+        for (i = 1; i < line->count; ++i) {
+            if (DRIVER_IS_MINE())
+                config_header_check(line->word[i]);
+        }
+
+    } else if (cdetect_strequal(keyword, "function")) {
+        for (i = 1; i < line->count; ++i) {
+            if (DRIVER_IS_MINE())
+                config_function_check(line->word[i]);
+        }
+
+    } else if (cdetect_strequal(keyword, "library")) {
+        for (i = 2; i < line->count; ++i) {
+            if (DRIVER_IS_MINE())
+                config_function_check_library(line->word[i], line->word[1]);
+        }
+
+    } else if (cdetect_strequal(keyword, "type")) {
+        if (DRIVER_IS_MINE()) {
+            i = driver_type_end(line);
+            type = driver_line_range(line, 1, i);
+            if (i < line->count) {
+                config_type_check_header(type->content, line->word[i + 1]);
+            } else {
+                config_type_check(type->content);
+            }
+            cdetect_string_destroy(type);
+        }
+
+    } else if (is_prefetch) {
+        /* Only compilations are done in advance */
+
+    } else if (cdetect_strequal(keyword, "tool")) {
+        is_found = CDETECT_FALSE;
+        for (i = 2; (i < line->count) && !is_found; ++i) {
+            is_found = (config_tool_check(line->word[1], line->word[i]) != 0);
+        }
+
+    } else if (cdetect_strequal(keyword, "define")) {
+        config_macro_define(line->word[1], (line->count == 3) ? line->word[2] : "1");
+
+    } else if (cdetect_strequal(keyword, "option")) {
+        config_tool_define(line->word[1], config_option_get(line->word[1]));
+    }
+
+#undef DRIVER_IS_MINE
+}
+
+/*************************************************************************
+ *
+ * Concurrent Compilations
+ *
+ ************************************************************************/
+
+/*
+ * Write outcomes of compilations, one per line
+ *
+ * The key of an outcome is a hash, so only the outcome is escaped.
+ */
+
+void
+driver_prefetch_write(void)
+{
+    cdetect_map_element_t element;
+    cdetect_list_t position;
+    cdetect_string_t value;
+
+    for (position = cdetect_list_front(cdetect_compile_map->first);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        element = (cdetect_map_element_t)position->data;
+        if (element && element->data) {
+            value = cdetect_string_escape((const char *)element->data,
+                                          '\n',
+                                          cdetect_cache_escape);
+            (void)printf("%s%c%s\n", element->key, cdetect_cache_separator, value->content);
+            cdetect_string_destroy(value);
+        }
+    }
+}
+
+/*
+ * Remember outcomes of compilations written by a job
+ */
+
+void
+driver_prefetch_read(cdetect_string_t input)
+{
+    cdetect_string_t rest;
+    cdetect_string_t escaped_value;
+    cdetect_string_t value;
+
+    while (input) {
+        rest = cdetect_string_split(input, '\n');
+        escaped_value = cdetect_string_split(input, cdetect_cache_separator);
+        if (escaped_value) {
+            if (cdetect_map_lookup(cdetect_compile_map, input->content) == 0) {
+                value = cdetect_string_unescape(escaped_value->content,
+                                                cdetect_cache_escape);
+                (void)cdetect_map_remember(cdetect_compile_map, input->content, value->content);
+                cdetect_string_destroy(value);
+            }
+            cdetect_string_destroy(escaped_value);
+        }
+        cdetect_string_destroy(input);
+        input = rest;
+    }
+}
+
+/*
+ * Do the compilations of all checks with concurrent jobs
+ *
+ * Each job performs its share of the checks silently and reports the
+ * outcomes of its compilations, which are reused when the checks are
+ * performed in order.
+ */
+
+void
+driver_prefetch(cdetect_list_t lines,
+                int jobs)
+{
+#if defined(CDETECT_HEADER_SYS_WAIT_H)
+    cdetect_list_t position;
+    cdetect_string_t name;
+    cdetect_string_t output;
+    unsigned int counter;
+    long *process;
+    int *channel;
+    int job;
+
+    /* A remote session cannot be shared between processes */
+    if ((jobs < 2) || cdetect_command_remote || (cdetect_command_compile == 0))
+        return;
+
+    cdetect_trace_begin("phase", "prefetch");
+
+    process = (long *)cdetect_allocate(jobs * sizeof(*process));
+    channel = (int *)cdetect_allocate(jobs * sizeof(*channel));
+
+    for (job = 0; job < jobs; ++job) {
+        process[job] = cdetect_process_fork(&channel[job]);
+        if (process[job] == 0) {
+            (void)dup2(channel[job], 1);
+            cdetect_is_silent = CDETECT_TRUE;
+            name = cdetect_string_format("%sj%d", cdetect_file_execute, job);
+            cdetect_file_execute = name->content;
+            name = cdetect_string_format("%s.txt", cdetect_file_execute);
+            cdetect_file_redirection = name->content;
+
+            counter = 0;
+            for (position = cdetect_list_front(lines);
+                 position != 0;
+                 position = cdetect_list_next(position)) {
+                driver_check((driver_line_t)position->data, &counter, job, jobs, CDETECT_TRUE);
+            }
+            driver_prefetch_write();
+            cdetect_process_exit(channel[job], 0);
+        }
+    }
+
+    for (job = 0; job < jobs; ++job) {
+        if (process[job] > 0) {
+            output = cdetect_process_read(channel[job]);
+            if (cdetect_process_wait(process[job]) == 0) {
+                driver_prefetch_read(output);
+            } else {
+                cdetect_string_destroy(output);
+            }
+        }
+    }
+
+    cdetect_free(channel);
+    cdetect_free(process);
+
+    cdetect_trace_end(0);
+#else
+    (void)lines;
+    (void)jobs;
+#endif
+}
+
+/*************************************************************************
+ *
+ * Main
+ *
+ ************************************************************************/
+
+int main(int argc, char *argv[])
+{
+    cdetect_list_t lines;
+    cdetect_list_t position;
+    const char *spec;
+    unsigned int counter;
+
+    config_begin();
+
+    config_option_register("spec", 0, driver_spec_default, 0, "Read checks from <argument>");
+    config_option_register("jobs", "j", driver_jobs_default, 0, "Number of concurrent compilations");
+
+    spec = driver_spec_name(argc, argv);
+    lines = driver_spec_read(spec);
+    config_depend_register(spec);
+
+    for (position = cdetect_list_front(lines);
+         position != 0;
+         position = cdetect_list_next(position)) {
+        if (!(driver_declare((driver_line_t)position->data) ||
+              driver_is_check((driver_line_t)position->data))) {
+            driver_invalid((driver_line_t)position->data);
+        }
+    }
+
+    if (config_options(argc, argv)) {
+
+        driver_prefetch(lines, atoi(config_option_get("jobs")));
+
+        counter = 0;
+        for (position = cdetect_list_front(lines);
+             position != 0;
+             position = cdetect_list_next(position)) {
+            driver_check((driver_line_t)position->data, &counter, 0, 1, CDETECT_FALSE);
+        }
+    }
+    config_end();
+
+    driver_spec_destroy(lines);
+
+    return 0;
+}
@@ -22,6 +22,19 @@ set COMPILER=cl.exe
 set UPDATE=no
 set ISUPDATED=no
 set CFLAGS=/nologo
+set SPEC=
+set ENGINE=cdetect.obj
+set LIBRARY=yes
+set ISENGINE=no
+
+rem Without a configure program the checks are read from a spec file
+if not exist %SOURCE% if exist config.spec (
+    set SOURCE=cdetect\driver.c
+    set COMMAND=cdriver.exe
+    set DEPEND=cdriver.exe cdetect\*.c
+    set SPEC=--spec=config.spec
+    set LIBRARY=no
+)
 
 if x%1==x--debug (
     set CFLAGS=%CFLAGS% /Zi
@@ -34,6 +47,17 @@ set ARGUMENTS=%ARGUMENTS% %1
 shift /1
 if not x%1==x goto argloop
 
+rem Build cDetect engine if needed
+if %LIBRARY%==yes (
+    if exist %ENGINE% (
+        for /f %%f in ('dir /b /o-d %ENGINE% cdetect\cdetect.c cdetect\cdetect.h') do call :EngineIfNew %%f
+    ) else (
+        call :EngineIfNew cdetect.c
+    )
+)
+if not exist %ENGINE% set LIBRARY=no
+if %LIBRARY%==yes set DEPEND=%DEPEND% %ENGINE%
+
 rem Determine dependencies
 if exist %COMMAND% (
     for /f %%f in ('dir /b /o-d %DEPEND%') do call :UpdateIfNew %%f
@@ -45,12 +69,13 @@ rem Build cDetect executable if needed
 if %UPDATE% == yes (
     echo Updating %COMMAND%
     del %COMMAND%
-    %COMPILER% %CFLAGS% %SOURCE%
+    if %LIBRARY%==yes call :LinkEngine
+    if not exist %COMMAND% %COMPILER% %CFLAGS% %SOURCE% /Fe%COMMAND%
 )
 
 rem Execute cDetect if it exists
 if exist %COMMAND% (
-    %COMMAND% %ARGUMENTS%
+    %COMMAND% %SPEC% %ARGUMENTS%
 ) else (
     echo Error: %COMMAND% not found
     exit /b 1
@@ -64,3 +89,22 @@ if %ISUPDATED%==yes goto :eof
 if not x%1==x%COMMAND% set UPDATE=yes
 set ISUPDATED=yes
 goto :eof
+
+:LinkEngine
+%COMPILER% %CFLAGS% /DCDETECT_USE_LIBRARY %SOURCE% %ENGINE% /Fe%COMMAND% >%COMMAND%.log 2>&1
+if exist %COMMAND% (
+    del %COMMAND%.log
+) else (
+    echo Cannot link %COMMAND% with %ENGINE% (see %COMMAND%.log^), compiling all of cDetect
+)
+goto :eof
+
+:EngineIfNew
+if %ISENGINE%==yes goto :eof
+if not x%1==x%ENGINE% (
+    echo Updating %ENGINE%
+    if exist %ENGINE% del %ENGINE%
+    %COMPILER% %CFLAGS% /c /DCDETECT_ENGINE_OBJECT=\"%ENGINE%\" cdetect\cdetect.c /Fo%ENGINE%
+)
+set ISENGINE=yes
+goto :eof
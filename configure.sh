@@ -20,6 +20,11 @@ SOURCE="config.c"
 DEPEND="${SOURCE} cdetect/*.c"
 COMMAND="config"
 
+# The engine is compiled once and linked with the configure program
+ENGINE="cdetect.o"
+ENGINE_DEPEND="cdetect/cdetect.c cdetect/cdetect.h"
+LIBRARY=1
+
 UPDATE=0
 
 # FIXME: fails if $0 does not contain /
@@ -29,6 +34,15 @@ if [ "x${MYDIR}" = "x" ]; then
 fi
 MYCFLAGS="-I${MYDIR}"
 
+# Without a configure program the checks are read from a spec file
+if [ ! -f "${MYDIR}/${SOURCE}" ] && [ -f "${MYDIR}/config.spec" ]; then
+    SOURCE="cdetect/driver.c"
+    DEPEND="cdetect/*.c"
+    COMMAND="cdriver"
+    SPEC="--spec=${MYDIR}/config.spec"
+    LIBRARY=0
+fi
+
 # Extract options for this script only
 if [ "x$1" = "x--debug" ]; then
     shift
@@ -78,6 +92,20 @@ if [ "x${COMPILER}" = "x" ]; then
     fi
 fi
 
+# Build cDetect engine if needed
+if [ ${LIBRARY} -ne 0 ]; then
+    if [ ! -f ${ENGINE} ] || [ "x`ls -t ${ENGINE} ${ENGINE_DEPEND} 2>/dev/null | head -1`" != "x${ENGINE}" ]; then
+	echo "Updating ${ENGINE}"
+	rm -f ${ENGINE}
+	${COMPILER} ${MYCFLAGS} ${CFLAGS} -DCDETECT_ENGINE_OBJECT=\"${ENGINE}\" -c ${MYDIR}/cdetect/cdetect.c -o ${ENGINE}
+    fi
+    if [ -f ${ENGINE} ]; then
+	DEPEND="${DEPEND} ${ENGINE}"
+    else
+	LIBRARY=0
+    fi
+fi
+
 # Determine dependencies
 if [ -x ${COMMAND} ]; then
     if [ "x`ls -t ${COMMAND} ${DEPEND} 2>/dev/null | head -1`" != "x${COMMAND}" ]; then
@@ -91,15 +119,26 @@ fi
 if [ ${UPDATE} -ne 0 ]; then
     echo "Updating ${COMMAND}"
     rm -f ${COMMAND}
-    ${COMPILER} ${MYCFLAGS} ${CFLAGS} ${MYDIR}/${SOURCE} -o ${COMMAND}
-    if [ $? -ne 0 ]; then
-	exit 1
+    if [ ${LIBRARY} -ne 0 ]; then
+	# Programs that use internals of cDetect must include all of it
+	${COMPILER} ${MYCFLAGS} ${CFLAGS} -DCDETECT_USE_LIBRARY ${MYDIR}/${SOURCE} ${ENGINE} -o ${COMMAND} 2>${COMMAND}.log
+	if [ -x ${COMMAND} ]; then
+	    rm -f ${COMMAND}.log
+	else
+	    echo "Cannot link ${COMMAND} with ${ENGINE} (see ${COMMAND}.log), compiling all of cDetect"
+	fi
+    fi
+    if [ ! -x ${COMMAND} ]; then
+	${COMPILER} ${MYCFLAGS} ${CFLAGS} ${MYDIR}/${SOURCE} -o ${COMMAND}
+	if [ $? -ne 0 ]; then
+	    exit 1
+	fi
     fi
 fi
 
 # Execute cDetect if it exists
 if [ -x ${COMMAND} ]; then
-    ./${COMMAND} ${ARGUMENTS}
+    ./${COMMAND} ${SPEC} ${ARGUMENTS}
 else
     echo "Error: ${COMMAND} not found"
     exit 1